@@ -49,6 +49,7 @@
 AI::AI( Mission &mission ) : mission(mission) {
   player = &mission.GetPlayer();
   map = &mission.GetMap();
+  prof = AIProfiler::Get();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -67,17 +68,30 @@ void AI::Play( void ) {
                                  1, 3 + player->Units(0), NULL,
                                  WIN_CENTER, view );
 
-  IdentifyObjectives();
+  if ( prof ) prof->StartTurn( mission.GetTurn(), player->ID(), player->Units(0) );
+
+  {
+    ProfileScope ps( prof, AIProfiler::PHASE_IDENTIFY );
+    IdentifyObjectives();
+  }
   progress->Advance( 1 );
-  AssignObjectives();
+  {
+    ProfileScope ps( prof, AIProfiler::PHASE_ASSIGN );
+    AssignObjectives();
+  }
 
   for ( AIObj *obj = static_cast<AIObj *>( objectives.Head() );
         obj; obj = static_cast<AIObj *>( obj->Next() ) )
     ProcessObjective( *obj );
 
   progress->Advance( 1 );
-  BuildReinforcements();
+  {
+    ProfileScope ps( prof, AIProfiler::PHASE_BUILD );
+    BuildReinforcements();
+  }
   view->CloseWindow( progress );
+
+  if ( prof ) prof->EndTurn();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -323,7 +337,7 @@ void AI::BuildReinforcements( void ) const {
 
         for ( int i = 0; i < 32; ++i ) {
           if ( blueprints & (1 << i) ) {
-            type = mission.GetUnitSet().GetUnitInfo( i );
+            type = mission.GetUnitInfo( i );
             if ( crystals >= type->Cost() ) {
               unsigned short val = type->Firepower(U_AIR) * amul +
                                    type->Firepower(U_GROUND) * gmul +
@@ -377,7 +391,10 @@ void AI::ProcessObjective( AIObj &obj ) {
     Unit *u = n->unit;
 
     if ( u->IsReady() ) {
-      Gam->SelectUnit( u );
+      {
+        ProfileScope ps( prof, AIProfiler::PHASE_SELECT );
+        Gam->SelectUnit( u );
+      }
       CommandUnit( u, obj );
     }
   }
@@ -429,23 +446,31 @@ void AI::CommandUnit( Unit *u, AIObj &obj ) {
   progress->Advance( 1 );
 
   // maybe we need an overhaul?
-  if ( (obj.priority < AI_PRI_CRITICAL) ||
-       (u->GroupSize() >= MAX_GROUP_SIZE / 2) ||
-       !CommandUnitRepair( u ) ) {
+  bool repair = false;
+  if ( (obj.priority >= AI_PRI_CRITICAL) &&
+       (u->GroupSize() < MAX_GROUP_SIZE / 2) ) {
+    ProfileScope ps( prof, AIProfiler::PHASE_REPAIR );
+    repair = CommandUnitRepair( u );
+  }
 
+  if ( !repair ) {
     switch ( obj.type ) {
-      case AI_OBJ_DEFEND:
+      case AI_OBJ_DEFEND: {
+        ProfileScope ps( prof, AIProfiler::PHASE_DEFEND );
         CommandUnitDefend( u, obj );
-        break;
-      case AI_OBJ_CONQUER:
+        break; }
+      case AI_OBJ_CONQUER: {
+        ProfileScope ps( prof, AIProfiler::PHASE_CONQUER );
         CommandUnitConquer( u, obj );
-        break;
-      case AI_OBJ_ATTACK:
+        break; }
+      case AI_OBJ_ATTACK: {
+        ProfileScope ps( prof, AIProfiler::PHASE_ATTACK );
         CommandUnitAttack( u, obj );
-        break;
-      case AI_OBJ_TRANSPORT:
+        break; }
+      case AI_OBJ_TRANSPORT: {
+        ProfileScope ps( prof, AIProfiler::PHASE_TRANSPORT );
         CommandUnitTransport( u, obj );
-        break;
+        break; }
     }
   }
 }
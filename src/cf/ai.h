@@ -25,6 +25,7 @@
 
 #include "mission.h"
 #include "path.h"
+#include "profile.h"
 #include "extwindow.h"
 
 class AI {
@@ -100,6 +101,7 @@ private:
   Mission &mission;
   Map *map;
   ProgressWindow *progress;
+  AIProfiler *prof;       // NULL if profiling is disabled
 };
 
 
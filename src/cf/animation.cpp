@@ -0,0 +1,382 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2007 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// animation.cpp
+////////////////////////////////////////////////////////////////////////
+
+#include "animation.h"
+#include "unit.h"
+#include "globals.h"
+#include "misc.h"
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Animator::Add
+// DESCRIPTION: Schedule an animation for the next call to Run(). The
+//              animator takes ownership of the animation.
+// PARAMETERS : anim  - animation
+//              delay - time (ms) to wait after Run() has been called
+//                      before starting the animation (default 0)
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Animator::Add( Animation *anim, unsigned long delay /* = 0 */ ) {
+  Entry e;
+  e.anim = anim;
+  e.start = delay;
+  anims.push_back( e );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Animator::Remove
+// DESCRIPTION: Delete a scheduled animation.
+// PARAMETERS : i - index of the animation
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Animator::Remove( unsigned int i ) {
+  delete anims[i].anim;
+  anims.erase( anims.begin() + i );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Animator::Clear
+// DESCRIPTION: Delete all scheduled animations without running them.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Animator::Clear( void ) {
+  for ( vector<Entry>::iterator it = anims.begin(); it != anims.end(); ++it )
+    delete it->anim;
+  anims.clear();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Animator::Run
+// DESCRIPTION: Play all scheduled animations and wait until the last
+//              one has finished. Each frame first restores the area
+//              painted during the previous frame, then paints all
+//              running animations, and finally updates the display
+//              once. Between frames the animator sleeps so that at
+//              most ANIM_FPS frames per second are produced.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Animator::Run( void ) {
+  const Rect wrect( 0, 0, win->Width(), win->Height() );
+  const unsigned long frame = 1000 / ANIM_FPS;
+  unsigned long end = 0;
+  Rect area( 0, 0, 0, 0 );
+
+  for ( vector<Entry>::iterator it = anims.begin(); it != anims.end(); ++it ) {
+    Rect b( it->anim->Bounds() );
+    b.Clip( wrect );
+    area.Union( b );
+    end = MAX( end, it->start + it->anim->Duration() );
+  }
+
+  if ( area.IsEmpty() ) {
+    Clear();
+    return;
+  }
+
+  // save the background; the surface is only replaced if it is too small
+  if ( (bg.Width() < area.w) || (bg.Height() < area.h) ) {
+    if ( bg.Create( MAX(area.w, bg.Width()), MAX(area.h, bg.Height()),
+                    DISPLAY_BPP, 0 ) ) {
+      Clear();
+      return;
+    }
+  }
+  win->Blit( &bg, area, 0, 0 );
+
+  Rect last( 0, 0, 0, 0 );  // area painted during the previous frame
+  Uint32 first = SDL_GetTicks(), next = first;
+
+  while ( !anims.empty() ) {
+    unsigned long now = SDL_GetTicks() - first;
+    if ( now > end ) now = end;
+
+    Rect upd( last );
+    if ( !last.IsEmpty() )
+      bg.Blit( win, Rect( last.x - area.x, last.y - area.y, last.w, last.h ),
+               last.x, last.y );
+    last = Rect( 0, 0, 0, 0 );
+
+    for ( unsigned int i = 0; i < anims.size(); ) {
+      Entry &e = anims[i];
+
+      if ( now < e.start ) {
+        ++i;
+        continue;
+      }
+
+      Animation *anim = e.anim;
+      unsigned long t = MIN( now - e.start, anim->Duration() );
+      bool done = (t == anim->Duration());
+
+      if ( done && anim->Transient() ) {
+        // its area has already been restored
+        Remove( i );
+        continue;
+      }
+
+      // animations may paint outside their bounds (e.g. the map view
+      // repainting after the cursor has been shown again), but only
+      // the saved area can be restored
+      Rect r( anim->Frame( win, t ) );
+      r.Clip( wrect );
+      upd.Union( r );
+      r.Clip( area );
+
+      if ( done ) {
+        // keep the final frame, even if another animation later
+        // restores the background here
+        if ( !r.IsEmpty() ) win->Blit( &bg, r, r.x - area.x, r.y - area.y );
+        Remove( i );
+      } else {
+        last.Union( r );
+        ++i;
+      }
+    }
+
+    if ( !upd.IsEmpty() ) win->Show( upd );
+
+    if ( !anims.empty() ) {
+      Uint32 ticks = SDL_GetTicks();
+      next += frame;
+      if ( next > ticks ) SDL_Delay( next - ticks );
+      else next = ticks;    // we're late; don't try to catch up
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : HexMoveAnimation::HexMoveAnimation
+// DESCRIPTION: Smoothly move a hex image (usually a unit or cursor)
+//              from one hex to another (adjacent) one.
+// PARAMETERS : mv    - map view
+//              img   - map tile identifier for the hex image
+//              set   - tile set containing the image; the image is
+//                      shown at the zoom level of the map view
+//              hex1  - source hex position
+//              hex2  - destination hex position
+//              speed - total time (ms) for the animation
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+HexMoveAnimation::HexMoveAnimation( MapView *mv, unsigned short img,
+                  const TileSet &set, const Point &hex1, const Point &hex2,
+                  unsigned short speed ) :
+    Animation( speed, true ), tiles(*set.Zoomed( mv->Zoom() )), img(img),
+    psrc(mv->Hex2Pixel( hex1 )), pdst(mv->Hex2Pixel( hex2 )) {
+  area.x = MIN( psrc.x, pdst.x );
+  area.y = MIN( psrc.y, pdst.y );
+  area.w = tiles.TileWidth() + ABS(psrc.x-pdst.x);
+  area.h = tiles.TileHeight() + ABS(psrc.y-pdst.y);
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : HexMoveAnimation::Frame
+// DESCRIPTION: Paint the image at its position for the given time.
+// PARAMETERS : dest - destination surface
+//              t    - time since start of the animation (ms)
+// RETURNS    : painted area
+////////////////////////////////////////////////////////////////////////
+
+Rect HexMoveAnimation::Frame( Surface *dest, unsigned long t ) {
+  short cx, cy;
+
+  // don't modify the following two lines; some versions of gcc
+  // (e.g. 2.95.3) seem to produce bogus code when all the calculations
+  // are done in one line
+  cx = (short)((pdst.x - psrc.x) * (long)t);
+  cy = (short)((pdst.y - psrc.y) * (long)t);
+
+  Rect r( psrc.x + cx / (long)duration, psrc.y + cy / (long)duration,
+          tiles.TileWidth(), tiles.TileHeight() );
+  tiles.DrawTile( img, dest, r.x, r.y, area );
+  r.Clip( area );
+  return r;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : HexFadeAnimation::HexFadeAnimation
+// DESCRIPTION: Fade a hex image in or out.
+// PARAMETERS : mv   - map view
+//              img  - tile identifier for the hex image
+//              hex  - destination hex position
+//              in   - whether to fade in or out
+//              unit - if TRUE paint a unit image, otherwise the
+//                     respective terrain
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+HexFadeAnimation::HexFadeAnimation( MapView *mv, unsigned short img,
+                  const Point &hex, bool in, bool unit ) :
+    Animation( 4 * ANIM_SPEED_UNIT, false ), mv(mv),
+    terrain(mv->GetMap()->HexImage( hex )), blocker(NULL), in(in) {
+  Point pos = mv->Hex2Pixel( hex );
+  area = Rect( pos.x, pos.y, mv->TileWidth(), mv->TileHeight() );
+
+  tile.Create( mv->TileWidth(), mv->TileHeight(), DISPLAY_BPP, SDL_HWSURFACE );
+  tile.SetAlpha( SDL_ALPHA_TRANSPARENT, SDL_SRCALPHA );
+  tile.SetColorKey( Color(CF_COLOR_WHITE) );
+  tile.DisplayFormat();
+  tile.Flood( Color(CF_COLOR_WHITE) );
+
+  if ( unit ) mv->DrawUnit( img, &tile, 0, 0, tile );
+  else {
+    mv->DrawTerrain( img, &tile, 0, 0, tile );
+    blocker = mv->GetMap()->GetUnit( hex );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : HexFadeAnimation::Frame
+// DESCRIPTION: Paint the hex with the image at the opacity for the
+//              given time.
+// PARAMETERS : dest - destination surface
+//              t    - time since start of the animation (ms)
+// RETURNS    : painted area
+////////////////////////////////////////////////////////////////////////
+
+Rect HexFadeAnimation::Frame( Surface *dest, unsigned long t ) {
+  int alpha = SDL_ALPHA_OPAQUE * t / duration;
+  if ( !in ) alpha = SDL_ALPHA_OPAQUE - alpha;
+
+  tile.SetAlpha( alpha, SDL_SRCALPHA );
+  mv->DrawTerrain( terrain, dest, area.x, area.y, area );
+  tile.Blit( dest, tile, area.x, area.y );
+  if ( blocker )
+    mv->DrawUnit( blocker->Image(), dest, area.x, area.y, area );
+  return area;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : HexFlashAnimation::HexFlashAnimation
+// DESCRIPTION: Make the unit at the target hex flash with white.
+// PARAMETERS : mv    - map view
+//              hex   - destination hex position
+//              times - desired number of times
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+HexFlashAnimation::HexFlashAnimation( MapView *mv, const Point &hex,
+                   unsigned short times ) :
+    Animation( times * ANIM_SPEED_UNIT * 3 / 2, false ), mv(mv),
+    img(mv->GetMap()->GetUnit( hex )->Image()),
+    delay(ANIM_SPEED_UNIT / 2), steps(-1) {
+  Point pos = mv->Hex2Pixel( hex );
+  area = Rect( pos.x, pos.y, mv->TileWidth(), mv->TileHeight() );
+  show_cursor = mv->CursorEnabled() && (mv->Cursor() == hex);
+
+  tile.Create( mv->TileWidth(), mv->TileHeight(), DISPLAY_BPP, 0 );
+  tile.SetAlpha( SDL_ALPHA_OPAQUE, SDL_SRCALPHA );
+  tile.SetColorKey( Color(CF_COLOR_WHITE) );
+  tile.DisplayFormat();
+
+  whitetile.Create( mv->TileWidth(), mv->TileHeight(), DISPLAY_BPP, 0 );
+  whitetile.SetAlpha( SDL_ALPHA_OPAQUE / 4, SDL_SRCALPHA );
+  whitetile.DisplayFormat();
+  whitetile.Flood( Color(CF_COLOR_WHITE) );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : HexFlashAnimation::PaintTile
+// DESCRIPTION: Prepare the unit image with the requested amount of
+//              white. Each step adds another translucent white layer.
+//              Layers are only added if possible to avoid repainting
+//              the whole tile for every frame.
+// PARAMETERS : steps - number of white layers
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void HexFlashAnimation::PaintTile( unsigned short steps ) {
+  if ( steps < this->steps ) this->steps = -1;
+
+  if ( this->steps == -1 ) {
+    tile.Flood( Color(CF_COLOR_WHITE) );
+    mv->DrawUnit( img, &tile, 0, 0, tile );
+    this->steps = 0;
+  }
+
+  for ( ; this->steps < steps; ++this->steps )
+    whitetile.Blit( &tile, whitetile, 0, 0 );
+
+  if ( show_cursor )
+    mv->DrawTerrain( mv->GetCursorImage(), &tile, 0, 0, tile );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : HexFlashAnimation::Frame
+// DESCRIPTION: Paint the unit for the given time. Each flash consists
+//              of three phases of equal length. During the first one
+//              the unit turns white, during the second one it stays
+//              white, and in the last one it is shown normally.
+// PARAMETERS : dest - destination surface
+//              t    - time since start of the animation (ms)
+// RETURNS    : painted area
+////////////////////////////////////////////////////////////////////////
+
+Rect HexFlashAnimation::Frame( Surface *dest, unsigned long t ) {
+  unsigned long phase = t % (3 * delay);
+
+  // the map already shows the unit in its normal state
+  if ( (t == duration) || (phase >= 2 * delay) ) return Rect( 0, 0, 0, 0 );
+
+  PaintTile( MIN( phase, delay - 1UL ) / ANIM_FLASH_STEP + 1 );
+  tile.Blit( dest, tile, area.x, area.y );
+  return area;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : CursorBlinkAnimation::CursorBlinkAnimation
+// DESCRIPTION: Enable the (hidden) cursor after some time.
+// PARAMETERS : mv    - map view
+//              delay - time (ms) until the cursor is shown
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+CursorBlinkAnimation::CursorBlinkAnimation( MapView *mv, unsigned long delay ) :
+    Animation( delay, false ), mv(mv), cursor(mv->Cursor()) {
+  Point pos = mv->Hex2Pixel( cursor );
+  area = Rect( pos.x, pos.y, mv->TileWidth(), mv->TileHeight() );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : CursorBlinkAnimation::Frame
+// DESCRIPTION: Show the cursor when the time has come.
+// PARAMETERS : dest - destination surface (unused, the map view
+//                     paints to its own surface)
+//              t    - time since start of the animation (ms)
+// RETURNS    : painted area
+////////////////////////////////////////////////////////////////////////
+
+Rect CursorBlinkAnimation::Frame( Surface *dest, unsigned long t ) {
+  if ( t < duration ) return Rect( 0, 0, 0, 0 );
+
+  mv->EnableCursor();
+  return mv->UpdateHex( cursor );
+}
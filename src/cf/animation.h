@@ -0,0 +1,158 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2007 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// animation.h - frame-paced map animations
+////////////////////////////////////////////////////////////////////////
+
+#ifndef _INCLUDE_ANIMATION_H
+#define _INCLUDE_ANIMATION_H
+
+#include <vector>
+using namespace std;
+
+#include "window.h"
+#include "mapview.h"
+
+#define ANIM_SPEED_UNIT		150  // time it takes for a unit to move one hex (ms)
+#define ANIM_SPEED_CURSOR	40   // speed when moving cursor
+
+#define ANIM_FPS          50  // maximum frame rate for map animations
+#define ANIM_FLASH_STEP   25  // time between two flash intensity steps (ms)
+
+// A single sprite animation. Frame() is called by the Animator with
+// the time elapsed since the animation was started and must paint the
+// complete state for that point in time. The area returned by
+// Bounds() is restored before every frame, so an animation never needs
+// to erase its previous frame.
+class Animation {
+public:
+  Animation( unsigned long duration, bool transient ) :
+             duration(duration), transient(transient) {}
+  virtual ~Animation( void ) {}
+
+  unsigned long Duration( void ) const { return duration; }
+  bool Transient( void ) const { return transient; }
+
+  virtual Rect Bounds( void ) const = 0;
+  virtual Rect Frame( Surface *dest, unsigned long t ) = 0;
+
+protected:
+  unsigned long duration;
+  bool transient;     // if TRUE remove the last frame when finished
+};
+
+// Runs any number of animations concurrently. All animations are
+// painted into the window and then copied to the display with a
+// single update per frame. The animator sleeps between frames instead
+// of polling the clock.
+class Animator {
+public:
+  Animator( Window *win ) : win(win) {}
+  ~Animator( void ) { Clear(); }
+
+  void Add( Animation *anim, unsigned long delay = 0 );
+  void Run( void );
+  void Clear( void );
+
+private:
+  struct Entry {
+    Animation *anim;
+    unsigned long start;
+  };
+
+  void Remove( unsigned int i );
+
+  Window *win;
+  Surface bg;             // background of the animated area, reused
+  vector<Entry> anims;
+};
+
+
+// move a unit or cursor image from one hex to a neighbouring one
+class HexMoveAnimation : public Animation {
+public:
+  HexMoveAnimation( MapView *mv, unsigned short img, const TileSet &set,
+                    const Point &hex1, const Point &hex2,
+                    unsigned short speed );
+
+  Rect Bounds( void ) const { return area; }
+  Rect Frame( Surface *dest, unsigned long t );
+
+private:
+  const TileSet &tiles;
+  unsigned short img;
+  Point psrc;
+  Point pdst;
+  Rect area;
+};
+
+// fade a unit or terrain image in or out
+class HexFadeAnimation : public Animation {
+public:
+  HexFadeAnimation( MapView *mv, unsigned short img, const Point &hex,
+                    bool in, bool unit );
+
+  Rect Bounds( void ) const { return area; }
+  Rect Frame( Surface *dest, unsigned long t );
+
+private:
+  MapView *mv;
+  Surface tile;
+  Rect area;
+  unsigned short terrain;
+  const Unit *blocker;
+  bool in;
+};
+
+// make the unit on a hex flash with white
+class HexFlashAnimation : public Animation {
+public:
+  HexFlashAnimation( MapView *mv, const Point &hex, unsigned short times );
+
+  Rect Bounds( void ) const { return area; }
+  Rect Frame( Surface *dest, unsigned long t );
+
+private:
+  void PaintTile( unsigned short steps );
+
+  MapView *mv;
+  Surface tile;
+  Surface whitetile;
+  Rect area;
+  unsigned short img;
+  unsigned short delay;
+  short steps;            // number of white layers currently on the tile
+  bool show_cursor;
+};
+
+// show the cursor again after some time
+class CursorBlinkAnimation : public Animation {
+public:
+  CursorBlinkAnimation( MapView *mv, unsigned long delay );
+
+  Rect Bounds( void ) const { return area; }
+  Rect Frame( Surface *dest, unsigned long t );
+
+private:
+  MapView *mv;
+  Point cursor;
+  Rect area;
+};
+
+#endif	/* _INCLUDE_ANIMATION_H */
@@ -0,0 +1,191 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// autosave.cpp
+////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <iostream>
+
+#ifdef WIN32
+# include <windows.h>
+#endif
+
+#include "autosave.h"
+#include "mission.h"
+#include "fileio.h"
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : post_failure
+// DESCRIPTION: Tell the main loop that a file could not be written.
+//              SDL_PushEvent() may be called from any thread.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+static void post_failure( void ) {
+  SDL_Event event;
+  event.type = SDL_USEREVENT;
+  event.user.code = AUTOSAVE_FAILED;
+  event.user.data1 = event.user.data2 = 0;
+  SDL_PushEvent( &event );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AutoSaver::AutoSaver
+// DESCRIPTION: Create a new background writer.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+AutoSaver::AutoSaver( void ) :
+  thread(0), running(false), pending(0) {
+  lock = SDL_CreateMutex();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AutoSaver::~AutoSaver
+// DESCRIPTION: Finish all pending requests and destroy the writer.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+AutoSaver::~AutoSaver( void ) {
+  Wait();
+  if ( lock ) SDL_DestroyMutex( lock );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AutoSaver::Start
+// DESCRIPTION: Queue a serialized mission for writing. This returns
+//              immediately unless no thread could be created, in which
+//              case the file is written synchronously.
+// PARAMETERS : data - mission data; the saver takes ownership
+//              file - destination file name
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void AutoSaver::Start( ChunkWriter *data, const string &file ) {
+  if ( lock ) {
+    SDL_mutexP( lock );
+
+    delete pending;             // superseded by this one
+    pending = data;
+    pending_file = file;
+
+    if ( !running ) {
+      // reap the previous thread; it has already left its loop
+      if ( thread ) SDL_WaitThread( thread, NULL );
+
+      thread = SDL_CreateThread( Run, this );
+      running = (thread != 0);
+    }
+
+    if ( running ) data = 0;
+    else pending = 0;
+
+    SDL_mutexV( lock );
+  }
+
+  if ( data ) {
+    // no thread available; do it ourselves
+    if ( WriteFile( *data, file ) ) post_failure();
+    delete data;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AutoSaver::Wait
+// DESCRIPTION: Block until all queued requests have been written.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void AutoSaver::Wait( void ) {
+  if ( thread ) {
+    SDL_WaitThread( thread, NULL );
+    thread = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AutoSaver::Run
+// DESCRIPTION: Thread function. Write queued requests until there are
+//              none left. Errors are reported to the main loop by
+//              posting an SDL_USEREVENT with code AUTOSAVE_FAILED.
+// PARAMETERS : saver - AutoSaver object
+// RETURNS    : 0
+////////////////////////////////////////////////////////////////////////
+
+int AutoSaver::Run( void *saver ) {
+  AutoSaver *as = static_cast<AutoSaver *>(saver);
+
+  while ( true ) {
+    SDL_mutexP( as->lock );
+    ChunkWriter *data = as->pending;
+    string file( as->pending_file );
+    as->pending = 0;
+    if ( !data ) as->running = false;
+    SDL_mutexV( as->lock );
+
+    if ( !data ) break;
+
+    if ( WriteFile( *data, file ) ) post_failure();
+    delete data;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AutoSaver::WriteFile
+// DESCRIPTION: Write a mission to a temporary file and move it to its
+//              final location when done.
+// PARAMETERS : data - mission data
+//              file - destination file name
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int AutoSaver::WriteFile( const ChunkWriter &data, const string &file ) {
+  string tmp( file + ".tmp" );
+  File out( tmp );
+  int rc = -1;
+
+  if ( out.Open( "wb", false ) ) {
+    rc = Mission::Write( out, data );
+    out.Close();
+
+    if ( rc == 0 ) {
+#if defined WIN32 && !defined _WIN32_WCE
+      if ( !MoveFileExA( tmp.c_str(), file.c_str(), MOVEFILE_REPLACE_EXISTING ) )
+        rc = -1;
+#else
+# ifdef _WIN32_WCE
+      // no way to replace a file in one go
+      remove( file.c_str() );
+# endif
+      rc = rename( tmp.c_str(), file.c_str() );
+#endif
+    }
+
+    if ( rc ) remove( tmp.c_str() );
+  }
+
+  if ( rc ) cerr << "Error: Could not write " << file << endl;
+  return rc;
+}
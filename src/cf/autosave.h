@@ -0,0 +1,64 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// autosave.h - write saved games in the background
+////////////////////////////////////////////////////////////////////////
+
+#ifndef _INCLUDE_AUTOSAVE_H
+#define _INCLUDE_AUTOSAVE_H
+
+#include <string>
+using namespace std;
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "chunkfile.h"
+
+#define AUTOSAVE_FILE    "autosave.sav"
+
+// code of the SDL_USEREVENT posted when writing a file failed
+#define AUTOSAVE_FAILED  0x4153
+
+// Compresses and writes serialized missions in a separate thread. The
+// file is first written under a temporary name and then renamed, so an
+// existing save is never left in a broken state. If a new request
+// arrives while the thread is still busy it is queued. Only the most
+// recent request is kept in that case.
+class AutoSaver {
+public:
+  AutoSaver( void );
+  ~AutoSaver( void );
+
+  void Start( ChunkWriter *data, const string &file );
+  void Wait( void );
+
+private:
+  static int Run( void *saver );
+  static int WriteFile( const ChunkWriter &data, const string &file );
+
+  SDL_mutex *lock;
+  SDL_Thread *thread;
+  bool running;           // thread is active
+
+  ChunkWriter *pending;   // next request
+  string pending_file;
+};
+
+#endif	/* _INCLUDE_AUTOSAVE_H */
@@ -281,7 +281,7 @@ void Event::Execute( View *view ) {
     MapObject *mo = mis->GetMap().GetMapObject( p );
 
     if ( mo ) {
-      const UnitType *type = mis->GetUnitSet().GetUnitInfo(e_data[0]);
+      const UnitType *type = mis->GetUnitInfo(e_data[0]);
       show_msg = (mo->Owner() == e_player)
         && ((mo->IsUnit() && static_cast<Unit *>(mo)->IsTransport())
              || !mo->IsUnit())
@@ -73,6 +73,13 @@ enum {
 };
 
 #ifndef DISABLE_NETWORK
+// the first byte of every packet sent during the game tells the
+// peer what to expect
+enum {
+  NET_MSG_ACTIONS = 0,  // actions completed during the current turn
+  NET_MSG_END_TURN      // remaining actions of the turn
+};
+
 class NetworkProgressWindow : public ProgressWindow {
 public:
   NetworkProgressWindow( unsigned short w, unsigned short h,
@@ -82,17 +89,25 @@ public:
 
 private:
   bool cancelled;
+  Uint32 last;
 };
 
 NetworkProgressWindow::NetworkProgressWindow( unsigned short w,
                        unsigned short h, const char *msg, View *view ) :
        ProgressWindow( 0, 0, w, h, 0, 100, msg,
-                       WIN_CENTER|WIN_PROG_ABORT, view ), cancelled(false) {}
+                       WIN_CENTER|WIN_PROG_ABORT, view ), cancelled(false),
+                       last(SDL_GetTicks()) {}
 
 bool NetworkProgressWindow::Cancelled( void ) {
   if ( !cancelled ) {
-    if ( Get() < 100 ) Advance( 1 );
-    else Set( 0 );
+    // we may get called at irregular intervals, so advance the
+    // progress bar by time
+    Uint32 now = SDL_GetTicks();
+    if ( now - last >= 200 ) {
+      if ( Get() < 100 ) Advance( 1 );
+      else Set( 0 );
+      last = now;
+    }
 
     bool cancel = ProgressWindow::Cancelled();
 
@@ -121,7 +136,8 @@ bool NetworkProgressWindow::Cancelled( void ) {
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
 
-Game::Game( View *view ) : mission(0), mwin(0), unit(0), shader(0), view(view) {
+Game::Game( View *view ) : mission(0), mwin(0), unit(0), shader(0), view(view),
+           recorder(0), playback(0), playback_turn(0) {
   InitKeys();
 
 #ifndef DISABLE_NETWORK
@@ -137,9 +153,17 @@ Game::Game( View *view ) : mission(0), mwin(0), unit(0), shader(0), view(view) {
 ////////////////////////////////////////////////////////////////////////
 
 Game::~Game( void ) {
-  if ( mwin ) view->CloseWindow( mwin );
+  if ( mwin ) {
+    if ( mission ) {
+      mission->GetMap().RemoveObserver( mwin->GetMapView() );
+      mission->GetMap().RemoveObserver( mwin->GetOverview() );
+    }
+    view->CloseWindow( mwin );
+  }
   delete mission;
   delete shader;
+  delete recorder;
+  delete playback;
 
 #ifndef DISABLE_NETWORK
   delete peer;
@@ -178,6 +202,8 @@ void Game::InitWindows( void ) {
     mwin = new MapWindow( 0, 0, view->Width(), view->Height(), 0, view );
     if ( CFOptions.GetDamageIndicator() ) mwin->GetMapView()->EnableUnitStats();
     mwin->GetMapView()->SetMap( &mission->GetMap() );  // attach map to map window
+    mission->GetMap().AddObserver( mwin->GetMapView() );
+    mission->GetMap().AddObserver( mwin->GetOverview() );
     shader = new MoveShader( &mission->GetMap(), mission->GetUnits(),
                              mwin->GetMapView()->GetFogBuffer() );
     ExecPreStartEvents();
@@ -324,6 +350,29 @@ int Game::Save( const char *filename ) {
   return 0;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Game::AutoSave
+// DESCRIPTION: Save the current game to the autosave file. The game is
+//              only serialized here. Compressing and writing the data
+//              is done in the background, and errors are reported via
+//              an SDL_USEREVENT (see AutoSaver).
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Game::AutoSave( void ) {
+  ChunkWriter *data = new ChunkWriter;
+
+  unsigned short mflags = mission->GetFlags();
+  mission->SetFlags( mflags|GI_SAVEFILE );
+  mission->Save( *data );
+  mission->SetFlags( mflags );
+
+  string fname( get_save_dir() );
+  fname.append( AUTOSAVE_FILE );
+  saver.Start( data, fname );
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Game::Load
 // DESCRIPTION: Load a game from a mission file (start a new game) or
@@ -333,8 +382,8 @@ int Game::Save( const char *filename ) {
 ////////////////////////////////////////////////////////////////////////
 
 int Game::Load( const char *filename ) {
-  File file( filename );
-  if ( !file.Open( "rb" ) ) return -1;
+  MemoryBuffer file( filename );
+  if ( !file.Open() ) return -1;
 
   int rc = Load( file );
   if ( rc != -1 ) {
@@ -401,6 +450,42 @@ int Game::Load( MemBuffer &buffer ) {
   return rc;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Game::LoadRecording
+// DESCRIPTION: Load a game recording for playback. Both players are
+//              controlled by the recording until it ends. After that
+//              the game continues as a hot seat or computer game.
+// PARAMETERS : file - recording file name
+//              turn - turn to start showing the game at; earlier turns
+//                     are executed without being displayed
+// RETURNS    : 0 on success, -1 otherwise
+////////////////////////////////////////////////////////////////////////
+
+int Game::LoadRecording( const char *file, unsigned short turn ) {
+  MemoryBuffer keyframe;
+
+  playback = new GameRecording( file );
+  if ( playback->Open() || playback->Seek( turn, keyframe ) ||
+       Load( keyframe ) ) {
+    cerr << "Error loading " << file << endl;
+    delete playback;
+    playback = NULL;
+    return -1;
+  }
+
+  // there is nobody to send the turns to
+  unsigned short flags = mission->GetFlags();
+  if ( flags & (GI_PBEM|GI_NETWORK) ) {
+    mission->SetFlags( flags & ~(GI_PBEM|GI_NETWORK) );
+    CFOptions.SetGameType( GTYPE_HOTSEAT );
+  }
+
+  mission->GetPlayer(PLAYER_ONE).SetRemote( true );
+  mission->GetPlayer(PLAYER_TWO).SetRemote( true );
+  playback_turn = turn;
+  return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Game::SwitchMap
 // DESCRIPTION: Dump the current map and move on to another one.
@@ -422,6 +507,8 @@ int Game::SwitchMap( const char *sequel ) {
   unsigned char handicap = mission->GetHandicap();
 
   // remove current game data
+  mission->GetMap().RemoveObserver( mwin->GetMapView() );
+  mission->GetMap().RemoveObserver( mwin->GetOverview() );
   delete shader;
   shader = NULL;
   delete mission;
@@ -436,6 +523,17 @@ int Game::SwitchMap( const char *sequel ) {
     mission->GetPlayer(PLAYER_ONE).SetType( p1type );
     mission->GetPlayer(PLAYER_TWO).SetType( p2type );
     mission->SetHandicap( handicap );
+
+    // keep recording or playing back the campaign
+    if ( recorder ) recorder->NewMission();
+    if ( playback ) {
+      if ( playback->NextMission() ) EndPlayback();
+      else {
+        mission->GetPlayer(PLAYER_ONE).SetRemote( true );
+        mission->GetPlayer(PLAYER_TWO).SetRemote( true );
+        playback_turn = 0;
+      }
+    }
   }
   return rc;
 }
@@ -483,16 +581,29 @@ GUI_Status Game::StartTurn( void ) {
   undo.Disable();
 
   if ( mission->GetPhase() == TURN_START ) {
-    // replay
+    if ( player.IsInteractive() ) AutoSave();
+
+    if ( !recorder && !playback && CFOptions.GetRecordFile() )
+      recorder = new GameRecorder( CFOptions.GetRecordFile() );
+    if ( recorder && recorder->TurnStart( *mission ) ) {
+      // don't try again
+      delete recorder;
+      recorder = NULL;
+      CFOptions.SetRecordFile( NULL );
+    }
+
+    // replay; turns of a network peer have already been shown
+    // while they were received
     History *history = mission->GetHistory();
     if ( history ) {
-      if ( player.IsInteractive() ) history->Replay( mwin );
+      if ( player.IsInteractive() && !mission->GetOtherPlayer(player).IsRemote() )
+        history->Replay( mwin );
       mission->SetHistory( NULL );
       delete history;
     }
 
-    // begin new turn
-    if ( mission->GetOtherPlayer(player).IsHuman() ) {
+    // begin new turn; recordings need the history of every turn
+    if ( mission->GetOtherPlayer(player).IsHuman() || recorder ) {
       history = new History();
       history->StartRecording( mission->GetUnits() );
       mission->SetHistory( history );
@@ -506,6 +617,14 @@ GUI_Status Game::StartTurn( void ) {
     mv->SetCursorImage( IMG_CURSOR_IDLE );
   }
 
+  if ( playback ) {
+    if ( PlaybackTurn() == 0 ) return EndTurn();
+
+    // the recording ends here, so continue as a normal game
+    EndPlayback();
+    return StartTurn();
+  }
+
   if ( !player.IsHuman() ) {
     CheckEvents();
     AI ai( *mission );
@@ -514,29 +633,15 @@ GUI_Status Game::StartTurn( void ) {
 
 #ifndef DISABLE_NETWORK
   } else if ( player.IsRemote() ) {
-    // show message while waiting
-    NetworkProgressWindow *pw = new NetworkProgressWindow(
-        view->Width() * 2 / 3, view->SmallFont()->Height() + 20,
-        MSG(MSG_NET_WAITING), view );
-    DynBuffer *updates = peer->Receive( pw );
-    if ( updates ) {
-      History remote;
-      remote.Load( *updates, *mission );
-
-      CheckEvents();
-      Execute( remote );
-    } else {
-      if ( pw->Cancelled() ) {
-        // user aborted, so no error
-        return GUI_RESTART;
-      } else {
-        HandleNetworkError();
-        return GUI_OK;
-      }
+    int err = ReceiveTurn();
+    if ( err == 1 ) {
+      // user aborted, so no error
+      return GUI_RESTART;
+    } else if ( err ) {
+      HandleNetworkError();
+      return GUI_OK;
     }
 
-    view->CloseWindow( pw );
-
     // make some noise so the local player know it's his turn now
     Audio::PlaySfx( Audio::SND_GUI_ASK, 0 );
 
@@ -743,6 +848,8 @@ GUI_Status Game::EndTurn( void ) {
   GUI_Status rc = GUI_OK;
   List &battles = mission->GetBattles();
 
+  if ( mission->GetPlayer().IsInteractive() ) AutoSave();
+
   if ( unit ) DeselectUnit();
   mwin->GetMapView()->DisableCursor();
   mwin->GetPanel()->Update(NULL);
@@ -764,8 +871,19 @@ GUI_Status Game::EndTurn( void ) {
   // destroyed units may have triggered events...
   rc = CheckEvents();
 
+  if ( recorder && recorder->TurnEnd( *mission, mission->GetHistory() ) ) {
+    delete recorder;
+    recorder = NULL;
+    CFOptions.SetRecordFile( NULL );
+  }
+
   // check for mission completion
   if ( !HaveWinner() ) {
+#ifndef DISABLE_NETWORK
+    // spectators never send anything
+    bool local = !mission->GetPlayer().IsRemote();
+#endif
+
     // set new player
     Player &p = mission->NextPlayer();
     if ( p.ID() == PLAYER_ONE ) mission->NextTurn();
@@ -799,6 +917,9 @@ GUI_Status Game::EndTurn( void ) {
       filebuf.append( last_file_name );
       filebuf.append( ".sav" );
 
+      // keep a copy in case the user aborts the file requester
+      AutoSave();
+
       int err = Save( filebuf.c_str() );
       if ( err ) {
         NoteWindow *nw = new NoteWindow( MSG(MSG_ERROR), MSG(MSG_ERR_SAVE), WIN_CLOSE_ESC, view );
@@ -807,13 +928,15 @@ GUI_Status Game::EndTurn( void ) {
     } else {
 
 #ifndef DISABLE_NETWORK
-      if ( p.IsRemote() ) {
+      if ( local && p.IsRemote() && !playback ) {
         // send data to peer
         History *history = mission->GetHistory();
 
         if ( history ) {
-          DynBuffer buf;
-          history->Save( buf, true );
+          DynBuffer &buf = peer->GetSendBuffer();
+          buf.Write8( NET_MSG_END_TURN );
+          history->Save( buf, *mission,
+                 History::HIST_SAVE_NETWORK|History::HIST_SAVE_UNSENT );
           if ( !peer->Send( buf ) ) {
             HandleNetworkError();
             return GUI_OK;
@@ -1017,8 +1140,7 @@ Unit *Game::MoveUnit( Unit *u, const Point &dest ) {
 
     shader->ShadeMap( u );
     if ( mv->CursorEnabled() ) mwin->GetPanel()->Update( u );
-    mwin->Draw();
-    mwin->Show();
+    mwin->Show( mv->Repair() );
     CheckEvents();
   }
   return u;
@@ -1187,8 +1309,7 @@ void Game::SelectUnit( Unit *u ) {
       Audio::PlaySfx( Audio::SND_GAM_SELECT, 0 );
       mv->EnableFog();
       shader->ShadeMap( unit );
-      mwin->Draw();
-      mwin->Show();
+      mwin->Show( mv->Repair() );
 
       mv->SetCursorImage( IMG_CURSOR_SELECT );
       SetCursor( u->Position() );
@@ -1213,8 +1334,7 @@ void Game::DeselectUnit( bool display /* = true */ ) {
 
     mv->DisableFog();
     if ( display ) {
-      mwin->Draw();
-      mwin->Show();
+      mwin->Show( mv->Repair() );
 
       SetCursor( unit->Position() );
     }
@@ -1269,8 +1389,7 @@ void Game::EnterSpecialMode( unsigned char mode ) {
 
     mv->EnableFog();
     mss.ShadeMap( unit );
-    mwin->Draw();
-    mwin->Show();
+    mwin->Show( mv->Repair() );
 
     mv->SetCursorImage( IMG_CURSOR_SPECIAL );
     SetCursor( unit->Position() );
@@ -1400,6 +1519,12 @@ GUI_Status Game::HandleEvent( const SDL_Event &event ) {
     case SDLK_LEFT: case SDLK_RIGHT: case SDLK_UP: case SDLK_DOWN:
       MoveCommand( key );
       break;
+    case SDLK_PLUS: case SDLK_KP_PLUS:
+      ZoomCommand( -1 );
+      break;
+    case SDLK_MINUS: case SDLK_KP_MINUS:
+      ZoomCommand( 1 );
+      break;
     case SDLK_ESCAPE:
       if ( unit ) {
         DeselectUnit();
@@ -1416,7 +1541,7 @@ GUI_Status Game::HandleEvent( const SDL_Event &event ) {
       rc = EndTurn();
       break;
     case -KEYBIND_SHOW_MAP:
-      new TacticalWindow( mv, *mission, view );
+      new TacticalWindow( mwin, *mission, view );
       break;
     case -KEYBIND_GAME_MENU:
       GameMenu();
@@ -1598,6 +1723,22 @@ void Game::ScrollCommand( int key ) {
   SetCursor( pos );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Game::ZoomCommand
+// DESCRIPTION: Zoom the map display in or out.
+// PARAMETERS : step - number of zoom levels to go out (positive) or
+//                     in (negative)
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Game::ZoomCommand( int step ) {
+  MapView *mv = mwin->GetMapView();
+  int level = mv->Zoom() + step;
+
+  if ( (level >= 0) && (level < TILE_ZOOM_LEVELS) && !mv->SetZoom( level ) )
+    mwin->Show( *mv );
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Game::HandleLMB
 // DESCRIPTION: React to user pressing the left mouse button.
@@ -1649,7 +1790,7 @@ void Game::ContainerContent( UnitContainer *c ) {
 
 void Game::UnitInfo( Unit *unit ) {
   if ( unit->Owner() == &mission->GetPlayer() )
-    new UnitInfoWindow( unit->Type()->ID(), mission->GetMap(), view );
+    new UnitInfoWindow( unit->Type(), mission->GetMap(), view );
   else new NoteWindow( unit->Name(), MSG(MSG_ERR_NO_ACCESS), WIN_CLOSE_ESC, view );
 }
 
@@ -1878,6 +2019,67 @@ void Game::Execute( const History &history ) {
   mission->GetBattles().Clear();
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Game::PlaybackTurn
+// DESCRIPTION: Execute the current turn from a game recording. Turns
+//              from the one requested in LoadRecording() on are shown
+//              as turn replays first.
+// PARAMETERS : -
+// RETURNS    : 0 on success, -1 if the recording does not contain the
+//              current turn
+////////////////////////////////////////////////////////////////////////
+
+int Game::PlaybackTurn( void ) {
+  Player &player = mission->GetPlayer();
+  unsigned short turn;
+  unsigned char pid;
+  MemoryBuffer buf;
+
+  if ( !playback->NextTurn( turn, pid ) ||
+       (turn != mission->GetTurn()) || (pid != player.ID()) ||
+       playback->GetTurn( buf ) )
+    return -1;
+
+  if ( turn >= playback_turn ) {
+    string turnmsg( MSG(MSG_TURN) );
+    turnmsg += ' ';
+    turnmsg.append( StringUtil::tostring(turn) );
+
+    NoteWindow *nw = new NoteWindow( player.Name(), turnmsg, WIN_FONT_BIG|WIN_CENTER, view );
+    nw->EventLoop();
+    view->CloseWindow( nw );
+
+    // the replay uses up the unit copies, so we need
+    // a separate history for execution
+    History show;
+    if ( show.Load( buf, *mission ) > 0 ) show.Replay( mwin );
+    if ( playback->GetTurn( buf ) ) return -1;
+  }
+
+  History recorded;
+  if ( recorded.Load( buf, *mission ) < 0 ) return -1;
+
+  CheckEvents();
+  Execute( recorded );
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Game::EndPlayback
+// DESCRIPTION: Stop playing a recording and hand control to the
+//              players.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Game::EndPlayback( void ) {
+  delete playback;
+  playback = NULL;
+
+  mission->GetPlayer(PLAYER_ONE).SetRemote( false );
+  mission->GetPlayer(PLAYER_TWO).SetRemote( false );
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Game::GameMenu
 // DESCRIPTION: Pop up a MenuWindow with general game options like
@@ -1968,6 +2170,98 @@ void Game::HandleNetworkError( void ) {
   dw->SetButtonID( 1, G_BUTTON_SHUTDOWN );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Game::StreamActions
+// DESCRIPTION: In network games, send all actions the local player has
+//              completed since the last call to the peer so that it
+//              can follow the turn as it happens. Movement which may
+//              still be undone is held back. This should be called
+//              whenever the player has done something.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Game::StreamActions( void ) {
+#ifndef DISABLE_NETWORK
+  if ( !peer || !peer->Connected() || playback || !mission ||
+       (mission->GetPhase() != TURN_IN_PROGRESS) ) return;
+
+  Player &p = mission->GetPlayer();
+  History *history = mission->GetHistory();
+  if ( !p.IsInteractive() || !history || !history->Unsent( undo.GetUnit() ) )
+    return;
+
+  DynBuffer &buf = peer->GetSendBuffer();
+  buf.Write8( NET_MSG_ACTIONS );
+  history->Save( buf, *mission,
+                 History::HIST_SAVE_NETWORK|History::HIST_SAVE_UNSENT,
+                 undo.GetUnit() );
+  if ( !peer->Send( buf ) ) {
+    // don't try again
+    peer->Close();
+    HandleNetworkError();
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Game::ReceiveTurn
+// DESCRIPTION: Wait for the remote player to finish the turn. Actions
+//              are executed and shown on the map as soon as they
+//              arrive, so when the end of the turn is signalled
+//              there is usually little left to do.
+// PARAMETERS : -
+// RETURNS    : 0 on success, 1 if the user aborted, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int Game::ReceiveTurn( void ) {
+#ifndef DISABLE_NETWORK
+  MapView *mv = mwin->GetMapView();
+  bool done = false;
+
+  if ( !mv->Enabled() ) {
+    mv->Enable();
+    mwin->Draw();
+    mwin->Show();
+  }
+
+  CheckEvents();
+
+  // show message while waiting, along with the average turn
+  // handoff latency once we know it
+  const NetLatency &lat = peer->GetLatency();
+  string msg( MSG(MSG_NET_WAITING) );
+  if ( lat.count > 0 )
+    msg = StringUtil::strprintf( MSG(MSG_NET_WAITING_LATENCY),
+                                 (int)(lat.total / lat.count) );
+
+  NetworkProgressWindow *pw = new NetworkProgressWindow(
+      view->Width() * 2 / 3, view->SmallFont()->Height() + 20,
+      msg.c_str(), view );
+
+  while ( !done ) {
+    DynBuffer *updates = peer->Receive( pw );
+    if ( !updates ) return pw->Cancelled() ? 1 : -1;
+
+    done = (updates->Read8() == NET_MSG_END_TURN);
+
+    History remote;
+    if ( remote.Load( *updates, *mission ) < 0 ) return -1;
+
+    Execute( remote );
+
+    // Execute() doesn't care about the display
+    mwin->Draw();
+    mwin->Show();
+  }
+
+  view->CloseWindow( pw );
+  return 0;
+#else
+  return -1;
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Game::Shutdown
 // DESCRIPTION: This method should be called when the current game ends,
@@ -2003,7 +2297,7 @@ GUI_Status Game::WidgetActivated( Widget *button, Window *win ) {
     break;
   case G_BUTTON_MAP:
     view->CloseWindow( win );
-    new TacticalWindow( mwin->GetMapView(), *mission, view );
+    new TacticalWindow( mwin, *mission, view );
     break;
   case G_BUTTON_BRIEFING:
     view->CloseWindow( win );
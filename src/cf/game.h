@@ -30,6 +30,8 @@
 #include "path.h"
 #include "options.h"
 #include "network.h"
+#include "autosave.h"
+#include "recorder.h"
 #include "globals.h"
 
 #define PROGRAMNAME "Crimson Fields"
@@ -66,6 +68,7 @@ public:
 
   int Load( MemBuffer &buffer );
   int Load( const char *file );
+  int LoadRecording( const char *file, unsigned short turn );
   int Save( MemBuffer &buffer ) { return mission->Save( buffer ); }
   int Save( const char *file );
 
@@ -92,18 +95,23 @@ public:
 #ifndef DISABLE_NETWORK
   void SetNetworkConnection( TCPConnection *c ) { peer = c; }
 #endif
+  void StreamActions( void );
 
 private:
   string CreateSaveFileName( const char *filename ) const;
+  void AutoSave( void );
   void ClearMine( Transport *sweeper, Unit *mine );
   bool HaveWinner( void );
   GUI_Status CheckEvents( void );
   void ExecPreStartEvents( void );
   void Execute( const History &history );
+  int PlaybackTurn( void );
+  void EndPlayback( void );
 
   void MoveCommand( int key );
   void SelectCommand( const Point &hex );
   void ScrollCommand( int key );
+  void ZoomCommand( int step );
   void HandleLMB( const Point &hex );
   void EnterSpecialMode( unsigned char mode );
   void SelectNextUnit( void );
@@ -122,6 +130,7 @@ private:
   void UnitMenu( Unit *unit );
   int SwitchMap( const char *mission );
   void HandleNetworkError( void );
+  int ReceiveTurn( void );
 
   bool SetPlayerPassword( Player *player ) const;
   bool CheckPassword( const char *title, const char *msg, const char *pw, short retry ) const;
@@ -141,6 +150,10 @@ private:
   UndoCache undo;
 
   string last_file_name; // remember save file names
+  AutoSaver saver;       // writes autosaves in the background
+  GameRecorder *recorder;
+  GameRecording *playback;
+  unsigned short playback_turn;  // first turn to show during playback
   Unit *g_tmp_prv_unit;
 
 #ifndef DISABLE_NETWORK
@@ -20,6 +20,8 @@
 // history.cpp
 ////////////////////////////////////////////////////////////////////////
 
+#include <iostream>
+
 #include "history.h"
 #include "game.h"
 #include "options.h"
@@ -27,42 +29,184 @@
 
 extern Options CFOptions;
 
+// In the compact history format (see History::Save()) each data field
+// of an event is stored as a variable length number. Unit IDs and map
+// coordinates are stored as the difference to the previous value of
+// the same kind, all other fields as they are. Unused fields are
+// omitted.
+enum {
+  HF_NONE = 0,    // field unused, always -1
+  HF_VALUE,
+  HF_UNIT,
+  HF_X,
+  HF_Y,
+  HF_COUNT
+};
+
+static const unsigned char hist_fields[][4] = {
+  { HF_UNIT,  HF_VALUE, HF_NONE,  HF_NONE  },   // HIST_MOVE
+  { HF_UNIT,  HF_X,     HF_Y,     HF_NONE  },   // HIST_ATTACK
+  { HF_UNIT,  HF_UNIT,  HF_VALUE, HF_VALUE },   // HIST_COMBAT
+  { HF_VALUE, HF_X,     HF_Y,     HF_NONE  },   // HIST_TILE
+  { HF_VALUE, HF_X,     HF_Y,     HF_NONE  },   // HIST_TILE_INTERNAL
+  { HF_VALUE, HF_VALUE, HF_VALUE, HF_NONE  },   // HIST_MSG
+  { HF_UNIT,  HF_VALUE, HF_NONE,  HF_NONE  },   // HIST_UNIT
+  { HF_UNIT,  HF_VALUE, HF_NONE,  HF_NONE  },   // HIST_TRANSPORT_CRYSTALS
+  { HF_UNIT,  HF_UNIT,  HF_NONE,  HF_NONE  }    // HIST_TRANSPORT_UNIT
+};
+
+#define HIST_NUM_TYPES (sizeof(hist_fields) / sizeof(hist_fields[0]))
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : HistEvent::Load
-// DESCRIPTION: Load an event from a file.
+// DESCRIPTION: Load the data fields of an event from a file. The
+//              event type must have been set.
 // PARAMETERS : file - file descriptor
+//              last - previous values for delta coding, indexed by
+//                     field kind (see hist_fields)
 // RETURNS    : -1 on error, 0 otherwise
 ////////////////////////////////////////////////////////////////////////
 
-int HistEvent::Load( MemBuffer &file ) {
-  type = file.Read8();
-  for ( int i = 0; i < 4; ++i ) data[i] = file.Read16();
+int HistEvent::Load( MemBuffer &file, short *last ) {
+  if ( type >= HIST_NUM_TYPES ) return -1;
+
+  for ( int i = 0; i < 4; ++i ) {
+    unsigned char kind = hist_fields[type][i];
+
+    if ( kind == HF_NONE ) data[i] = -1;
+    else {
+      data[i] = last[kind] + file.ReadSVar();
+      if ( kind != HF_VALUE ) last[kind] = data[i];
+    }
+  }
   return 0;
 }
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : HistEvent::Save
-// DESCRIPTION: Save an event to a file.
+// DESCRIPTION: Save the data fields of an event to a file. The type
+//              is not saved.
 // PARAMETERS : file - file descriptor
+//              last - previous values for delta coding, indexed by
+//                     field kind (see hist_fields)
 // RETURNS    : 0 on success, non-0 otherwise
 ////////////////////////////////////////////////////////////////////////
 
-int HistEvent::Save( MemBuffer &file ) const {
-  file.Write8( type );
-  for ( int i = 0; i < 4; ++i ) file.Write16( data[i] );
+int HistEvent::Save( MemBuffer &file, short *last ) const {
+  for ( int i = 0; i < 4; ++i ) {
+    unsigned char kind = hist_fields[type][i];
+
+    if ( kind != HF_NONE ) {
+      file.WriteSVar( data[i] - last[kind] );
+      if ( kind != HF_VALUE ) last[kind] = data[i];
+    }
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : HistEvent::LoadLegacy
+// DESCRIPTION: Load an event stored with fixed-width fields (saved
+//              games created by older versions).
+// PARAMETERS : file - file descriptor
+// RETURNS    : -1 on error, 0 otherwise
+////////////////////////////////////////////////////////////////////////
+
+int HistEvent::LoadLegacy( MemBuffer &file ) {
+  type = file.Read8();
+  for ( int i = 0; i < 4; ++i ) data[i] = file.Read16();
   return 0;
 }
 
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : History::Load
-// DESCRIPTION: Load a History from a file.
+// DESCRIPTION: Load a History from a file. Unit copies which were saved
+//              as differences are reconstructed from the units of the
+//              mission, so the mission must have been loaded already.
 // PARAMETERS : file    - open file descriptor
 //              mission - current mission
 // RETURNS    : -1 on error, number of events loaded otherwise
 ////////////////////////////////////////////////////////////////////////
 
 short History::Load( MemBuffer &file, Mission &mission ) {
+  unsigned short num_events = file.ReadVar();
+
+  if ( num_events > 0 ) {
+    unsigned short num_units, i = 0;
+    short last[HF_COUNT] = { 0 };
+    num_units = file.ReadVar();
+
+    while ( i < num_events ) {
+      HistEvent *he = new HistEvent();
+      he->type = file.Read8();
+
+      if ( he->type == HIST_MOVE ) {
+        // a unit moving several hexes
+        short id = last[HF_UNIT] + file.ReadSVar();
+        unsigned short steps = file.ReadVar();
+        unsigned char dirs = 0;
+
+        last[HF_UNIT] = id;
+
+        for ( unsigned short j = 0; j < steps; ++j ) {
+          if ( (j & 1) == 0 ) dirs = file.Read8();
+          if ( j > 0 ) he = new HistEvent();
+          he->type = HIST_MOVE;
+          he->data[0] = id;
+          he->data[1] = (j & 1) ? (dirs >> 4) : (dirs & 0x0F);
+          he->data[2] = he->data[3] = -1;
+          events.AddTail( he );
+        }
+        i += steps;
+        if ( steps == 0 ) delete he;
+      } else {
+        if ( he->Load( file, last ) ) {
+          delete he;
+          cerr << "Error: Unknown history event" << endl;
+          return -1;
+        }
+        events.AddTail( he );
+        ++i;
+      }
+    }
+
+    unsigned short id = 0;
+    for ( i = 0; i < num_units; ++i ) {
+      long tag = file.ReadSVar();
+      bool delta = (tag & 1) != 0;
+      Unit *u;
+
+      id += (tag - delta) / 2;
+
+      if ( delta ) {
+        Unit *ref = mission.GetUnit( id );
+        if ( !ref ) {
+          cerr << "Error: Turn history refers to unknown unit " << id << endl;
+          return -1;
+        }
+        u = new Unit( *ref );
+        u->SetFlags( U_DUMMY );
+        u->LoadDelta( file );
+      } else
+        u = mission.LoadUnit( file, true );
+
+      if ( u ) units.AddTail( u );
+    }
+  }
+  return num_events;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : History::LoadLegacy
+// DESCRIPTION: Load a History from a saved game created by an older
+//              version.
+// PARAMETERS : file    - open file descriptor
+//              mission - current mission
+// RETURNS    : -1 on error, number of events loaded otherwise
+////////////////////////////////////////////////////////////////////////
+
+short History::LoadLegacy( MemBuffer &file, Mission &mission ) {
   unsigned short num_events = file.Read16();
 
   if ( num_events > 0 ) {
@@ -71,7 +215,7 @@ short History::Load( MemBuffer &file, Mission &mission ) {
 
     for ( i = 0; i < num_events; ++i ) {
       HistEvent *he = new HistEvent();
-      he->Load( file );
+      he->LoadLegacy( file );
       events.AddTail( he );
     }
 
@@ -86,51 +230,160 @@ short History::Load( MemBuffer &file, Mission &mission ) {
 ////////////////////////////////////////////////////////////////////////
 // NAME       : History::Save
 // DESCRIPTION: Save a history to file.
+//
+//              Events are delta coded (see hist_fields), and
+//              consecutive moves of the same unit are merged into a
+//              single record, storing two directions per byte.
+//              The unit copies taken at the start of the turn are
+//              saved as differences to the units the reader will
+//              already know: in saved games these are the units of the
+//              mission itself, in network games the units the peer had
+//              when we started our turn, i.e. the copies themselves.
+//              Only units which are unknown to the reader are saved in
+//              full.
 // PARAMETERS : file    - open file descriptor
-//              network - do some special processing if saving for
-//                        sending over the wire in a network game
+//              mission - current mission
+//              flags   - HIST_SAVE_NETWORK to do some special processing
+//                        if saving for sending over the wire in a
+//                        network game or for a recording,
+//                        HIST_SAVE_UNSENT to skip all events which have
+//                        been saved with this flag before
+//              hold    - if not NULL, don't save the movement of this
+//                        unit yet because it may still be undone
+//                        (default NULL)
 // RETURNS    : 0 on success, -1 on error
 ////////////////////////////////////////////////////////////////////////
 
-int History::Save( MemBuffer &file, bool network /* = false */ ) const {
-  unsigned short num;
-
-  if ( network ) {
-    num = 0;
-    for ( HistEvent *he = static_cast<HistEvent *>( events.Head() );
-          he; he = static_cast<HistEvent *>( he->Next() ) ) {
-      // don't resend any events
-      if ( !he->processed ) {
-        if ( he->type == HIST_MOVE ||
-             (he->type == HIST_UNIT && he->data[1] != HIST_UEVENT_DESTROY) ||
-             he->type == HIST_ATTACK || he->type == HIST_COMBAT ||
-             he->type == HIST_TRANSPORT_CRYSTALS || he->type == HIST_TRANSPORT_UNIT )
-          ++num;
-        else
-          he->processed = true;
-      }
+int History::Save( MemBuffer &file, const Mission &mission,
+                   unsigned short flags /* = 0 */,
+                   const Unit *hold /* = NULL */ ) const {
+  bool network = (flags & HIST_SAVE_NETWORK) != 0;
+  unsigned short num = 0;
+  HistEvent *he;
 
-    }
-  } else num = events.CountNodes();
+  for ( he = static_cast<HistEvent *>( events.Head() );
+        he; he = static_cast<HistEvent *>( he->Next() ) ) {
+    if ( Include( *he, flags, hold ) ) ++num;
+  }
 
-  file.Write16( num );
+  file.WriteVar( num );
   if ( num == 0 ) return 0;
 
-  file.Write16( units.CountNodes() );
+  file.WriteVar( units.CountNodes() );
 
   // save events
-  for ( HistEvent *he = static_cast<HistEvent *>( events.Head() );
-        he; he = static_cast<HistEvent *>( he->Next() ) )
-    if ( !network || !he->processed )
-      he->Save( file );
+  short last[HF_COUNT] = { 0 };
+  he = static_cast<HistEvent *>( events.Head() );
+  while ( he ) {
+    if ( !Include( *he, flags, hold ) ) {
+      he = static_cast<HistEvent *>( he->Next() );
+    } else if ( he->type == HIST_MOVE ) {
+      // collect all steps of this unit
+      short id = he->data[0];
+      unsigned short steps = 0;
+      HistEvent *end;
+
+      for ( end = he; end && (end->type == HIST_MOVE) &&
+            (end->data[0] == id) && Include( *end, flags, hold );
+            end = static_cast<HistEvent *>( end->Next() ) )
+        ++steps;
+
+      file.Write8( HIST_MOVE );
+      file.WriteSVar( id - last[HF_UNIT] );
+      file.WriteVar( steps );
+      last[HF_UNIT] = id;
+
+      for ( unsigned short j = 0; j < steps; j += 2 ) {
+        unsigned char dirs = he->data[1] & 0x0F;
+        if ( flags & HIST_SAVE_UNSENT ) he->processed = true;
+        he = static_cast<HistEvent *>( he->Next() );
+        if ( j + 1 < steps ) {
+          dirs |= (he->data[1] & 0x0F) << 4;
+          if ( flags & HIST_SAVE_UNSENT ) he->processed = true;
+          he = static_cast<HistEvent *>( he->Next() );
+        }
+        file.Write8( dirs );
+      }
+    } else {
+      file.Write8( he->type );
+      he->Save( file, last );
+      if ( flags & HIST_SAVE_UNSENT ) he->processed = true;
+      he = static_cast<HistEvent *>( he->Next() );
+    }
+  }
 
   // save units
+  unsigned short id = 0;
   for ( Unit *u = static_cast<Unit *>( units.Head() );
-        u; u = static_cast<Unit *>( u->Next() ) )
-    u->Save( file );
+        u; u = static_cast<Unit *>( u->Next() ) ) {
+    const Unit *ref;
+
+    if ( network ) ref = u->IsBusy() ? NULL : u;
+    else {
+      ref = mission.GetUnit( u->ID() );
+      if ( ref && ((ref->Type() != u->Type()) || (ref->Owner() != u->Owner())) )
+        ref = NULL;
+    }
+
+    file.WriteSVar( ((long)u->ID() - id) * 2 + (ref ? 1 : 0) );
+    id = u->ID();
+
+    if ( ref ) {
+      Unit base( *ref );
+      base.SetFlags( U_DUMMY );
+      u->SaveDelta( file, base );
+    } else
+      u->Save( file );
+  }
   return 0;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : History::Include
+// DESCRIPTION: Check whether an event must be saved.
+// PARAMETERS : he    - event to check
+//              flags - save flags (see History::Save())
+//              hold  - unit whose movement must not be saved (may be
+//                      NULL)
+// RETURNS    : TRUE if the event is to be saved, FALSE otherwise
+////////////////////////////////////////////////////////////////////////
+
+bool History::Include( const HistEvent &he, unsigned short flags,
+                       const Unit *hold ) const {
+  if ( (flags & HIST_SAVE_UNSENT) && he.processed ) return false;
+
+  // the peer only needs the events it can't figure out by itself
+  if ( (flags & HIST_SAVE_NETWORK) &&
+       !(he.type == HIST_MOVE ||
+         (he.type == HIST_UNIT && he.data[1] != HIST_UEVENT_DESTROY) ||
+         he.type == HIST_ATTACK || he.type == HIST_COMBAT ||
+         he.type == HIST_TRANSPORT_CRYSTALS || he.type == HIST_TRANSPORT_UNIT) )
+    return false;
+
+  // these are the events removed by UndoMove()
+  return !hold || (he.data[0] != hold->ID()) ||
+         ((he.type != HIST_MOVE) && (he.type != HIST_TRANSPORT_CRYSTALS) &&
+          (he.type != HIST_TRANSPORT_UNIT));
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : History::Unsent
+// DESCRIPTION: Check whether there are any events which have not been
+//              sent to the peer yet (see History::Save()).
+// PARAMETERS : hold - unit whose movement is not to be sent yet (may
+//                     be NULL)
+// RETURNS    : TRUE if there are unsent events, FALSE otherwise
+////////////////////////////////////////////////////////////////////////
+
+bool History::Unsent( const Unit *hold ) const {
+  for ( HistEvent *he = static_cast<HistEvent *>( events.Tail() );
+        he; he = static_cast<HistEvent *>( he->Prev() ) ) {
+    if ( Include( *he, HIST_SAVE_NETWORK|HIST_SAVE_UNSENT, hold ) )
+      return true;
+  }
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : History::StartRecording
 // DESCRIPTION: Create a new (empty) History from the current game.
@@ -151,7 +404,12 @@ void History::StartRecording( List &list ) {
 ////////////////////////////////////////////////////////////////////////
 // NAME       : History::Replay
 // DESCRIPTION: Play all events that have been stored during the last
-//              turn.
+//              turn. For quick replays everything except combat and
+//              messages is applied in batch mode, i.e. directly to the
+//              map and the units without any animation, and the
+//              display is only updated when necessary. If the user
+//              aborts a normal replay the remaining events are
+//              fast-forwarded the same way.
 // PARAMETERS : mapwin - pointer to MapWindow
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
@@ -173,6 +431,9 @@ void History::Replay( MapWindow *mapwin ) {
     List units_bak;
     BeginReplay( units_bak, map );
 
+    damaged.assign( map->Width() * map->Height(), false );
+    damage.clear();
+
     if ( quick ) delay = 0;
     else {
       unsigned short count = events.CountNodes();
@@ -195,33 +456,49 @@ void History::Replay( MapWindow *mapwin ) {
               0, count, NULL, WIN_PROG_ABORT|WIN_PROG_DEFAULT, view );
     }
 
-    while ( he && !abort ) {
+    batch = quick;
+
+    while ( he ) {
 
       if ( he->type == HIST_MOVE )
         ReplayMoveEvent( *he, mapwin );
-      else if ( he->type == HIST_COMBAT )
-        ReplayCombatEvent( *he, mapwin );
-      else if ( he->type == HIST_MSG )
+      else if ( he->type == HIST_COMBAT ) {
+        if ( abort ) ApplyCombatEvent( *he );
+        else {
+          // the combat window needs an up-to-date map
+          RepairDamage( mapwin );
+          ReplayCombatEvent( *he, mapwin );
+        }
+      } else if ( he->type == HIST_MSG ) {
+        RepairDamage( mapwin );
         ReplayMessageEvent( *he, view );
-      else if ( he->type == HIST_TILE )
+      } else if ( he->type == HIST_TILE )
         ReplayTileEvent( *he, mapwin );
       else if ( he->type == HIST_UNIT )
         ReplayUnitEvent( *he, mapwin );
 
-      else if ( !quick ) {
+      else if ( !batch ) {
         // these events are skipped completely for quick replays
         if ( he->type == HIST_ATTACK )
           ReplayAttackEvent( *he, mapwin );
       }
 
-      if ( !quick ) {
+      if ( progwin ) {
         progwin->Advance( 1 );
-        abort = progwin->Cancelled();
+        if ( progwin->Cancelled() ) {
+          // skip to the end of the turn
+          view->CloseWindow( progwin );
+          progwin = NULL;
+          batch = abort = true;
+        }
       }
 
       he = static_cast<HistEvent *>( he->Next() );
     }
 
+    RepairDamage( mapwin );
+    batch = false;
+
     EndReplay( units_bak, map );
     if ( progwin ) view->CloseWindow( progwin );
   }
@@ -229,7 +506,7 @@ void History::Replay( MapWindow *mapwin ) {
 
   if ( replay && !abort ) SDL_Delay( delay * 2 );
   else if ( !quick ) {
-    // if replay has been stopped or disabled we still need to revert
+    // if replay has been disabled we still need to revert
     // all changes to the map and display the cached messages
     while ( he ) {
       if ( he->type == HIST_TILE ) map->SetHexType( he->data[1], he->data[2], he->data[0] );
@@ -528,22 +805,34 @@ void History::ReplayMoveEvent( const HistEvent &event, MapWindow *mapwin ) {
       lastunit = u;
       lastpos = u->Position();
 
-      SDL_Delay( delay );
+      if ( !batch ) SDL_Delay( delay );
     }
 
-    mapwin->DisplayHex( u->Position() );
+    if ( !batch ) mapwin->DisplayHex( u->Position() );
 
     if ( u->IsSheltered() ) {
       if ( map->GetUnit( u->Position() ) ) u->UnsetFlags( U_SHELTERED );
       else map->GetBuilding( u->Position() )->RemoveUnit( u );
     } else {
       map->SetUnit( NULL, u->Position() );
-      mv->UpdateHex( u->Position() );
+      if ( batch ) Damage( u->Position() );
+      else mv->UpdateHex( u->Position() );
     }
 
-    Gam->MoveUnit( u, (Direction)event.data[1] );
-    map->SetUnit( u, u->Position() );
-    if ( mv->Enabled() ) mapwin->Show( mv->UpdateHex( u->Position() ) );
+    if ( batch ) {
+      Point dest;
+      Direction dir = (Direction)event.data[1];
+      if ( !map->Dir2Hex( u->Position(), dir, dest ) ) {
+        u->Face( dir );
+        u->SetPosition( dest.x, dest.y );
+      }
+      map->SetUnit( u, u->Position() );
+      Damage( u->Position() );
+    } else {
+      Gam->MoveUnit( u, (Direction)event.data[1] );
+      map->SetUnit( u, u->Position() );
+      if ( mv->Enabled() ) mapwin->Show( mv->UpdateHex( u->Position() ) );
+    }
   }
 }
 
@@ -620,7 +909,8 @@ void History::ReplayTileEvent( const HistEvent &event, MapWindow *mapwin ) {
   Map *map = mv->GetMap();
   Point pos( event.data[1], event.data[2] );
 
-  if ( mv->Enabled() ) {
+  if ( batch ) Damage( pos );
+  else if ( mv->Enabled() ) {
     const TerrainType *tt = Gam->GetMission()->GetTerrainSet().GetTerrainInfo( event.data[0] );
     mapwin->DisplayHex( pos );
     SDL_Delay( delay );
@@ -655,6 +945,73 @@ void History::ReplayCombatEvent( const HistEvent &event, MapWindow *mapwin ) {
   Gam->ResolveBattle( &cmb, &casualties );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : History::ApplyCombatEvent
+// DESCRIPTION: Apply the results of a fight without showing it.
+// PARAMETERS : event - combat event
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void History::ApplyCombatEvent( const HistEvent &event ) {
+  Mission *mission = Gam->GetMission();
+  Unit *att = mission->GetUnit( event.data[0] );
+  Unit *def = mission->GetUnit( event.data[1] );
+
+  if ( !att || !def || !att->IsAlive() || !def->IsAlive() ) return;
+
+  Map &map = mission->GetMap();
+  Point apos( att->Position() ), dpos( def->Position() );
+  Combat cmb( att, def );
+  cmb.CalcResults( event.data[3], event.data[2] );
+
+  if ( !att->IsAlive() ) map.SetUnit( NULL, apos );
+  if ( !def->IsAlive() ) map.SetUnit( NULL, dpos );
+  Damage( apos );
+  Damage( dpos );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : History::Damage
+// DESCRIPTION: Mark a hex for redrawing at the end of a batch of
+//              events.
+// PARAMETERS : hex - changed hex
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void History::Damage( const Point &hex ) {
+  int idx = Gam->GetMission()->GetMap().Hex2Index( hex );
+
+  if ( !damaged[idx] ) {
+    damaged[idx] = true;
+    damage.push_back( hex );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : History::RepairDamage
+// DESCRIPTION: Redraw all hexes changed since the last update and
+//              bring them to the screen in one go.
+// PARAMETERS : mapwin - map window
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void History::RepairDamage( MapWindow *mapwin ) {
+  MapView *mv = mapwin->GetMapView();
+  Map *map = mv->GetMap();
+  Rect area( 0, 0, 0, 0 );
+
+  // UpdateHex() does nothing if the view is disabled, e.g. at the
+  // start of a quick replay; the view will be redrawn completely
+  // when it is enabled
+  for ( vector<Point>::iterator i = damage.begin(); i != damage.end(); ++i ) {
+    if ( mv->HexVisible( *i ) ) area.Union( mv->UpdateHex( *i ) );
+    damaged[map->Hex2Index( *i )] = false;
+  }
+  damage.clear();
+
+  if ( !area.IsEmpty() ) mapwin->Show( area );
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : History::ReplayUnitEvent
 // DESCRIPTION: Add a new unit to the map.
@@ -674,7 +1031,8 @@ void History::ReplayUnitEvent( const HistEvent &event, MapWindow *mapwin ) {
       u->Remove();
 
       if ( !u->IsSheltered() ) {
-        if ( mv->Enabled() ) {
+        if ( batch ) Damage( u->Position() );
+        else if ( mv->Enabled() ) {
           mapwin->DisplayHex( u->Position() );
           SDL_Delay( delay );
           mapwin->FadeInUnit( u->Image(), u->Position() );
@@ -686,7 +1044,8 @@ void History::ReplayUnitEvent( const HistEvent &event, MapWindow *mapwin ) {
     } else if ( event.data[1] == HIST_UEVENT_DESTROY ) { // destroy unit
       if ( !u->IsSheltered() ) {
         map->SetUnit( NULL, u->Position() );
-        if ( mv->Enabled() ) {
+        if ( batch ) Damage( u->Position() );
+        else if ( mv->Enabled() ) {
           mapwin->DisplayHex( u->Position() );
           SDL_Delay( delay );
           mapwin->FadeOutUnit( u->Image(), u->Position() );
@@ -737,6 +1096,21 @@ Unit *History::GetDummy( unsigned short id ) const {
   return u;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : History::SetUnitTypes
+// DESCRIPTION: Make the internal unit definitions refer to another
+//              copy of the unit types, e.g. after the language has
+//              been changed.
+// PARAMETERS : types - unit types, indexed by type ID
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void History::SetUnitTypes( const UnitType *types ) {
+  for ( Unit *u = static_cast<Unit *>( units.Head() );
+        u; u = static_cast<Unit *>( u->Next() ) )
+    u->SetType( &types[u->Type()->ID()] );
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : History::SetEventsProcessed
 // DESCRIPTION: Set all events to processed.
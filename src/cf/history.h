@@ -24,13 +24,17 @@
 #ifndef _INCLUDE_HISTORY_H
 #define _INCLUDE_HISTORY_H
 
+#include <vector>
+using namespace std;
+
 #include "combat.h"
 
 class HistEvent : public Node {
 public:
   HistEvent( void ) : processed(false) {}
-  int Load ( MemBuffer &file );
-  int Save( MemBuffer &file ) const;
+  int Load( MemBuffer &file, short *last );
+  int Save( MemBuffer &file, short *last ) const;
+  int LoadLegacy( MemBuffer &file );
 
   unsigned char type;
   short data[4];
@@ -60,9 +64,18 @@ public:
     HIST_UEVENT_REPAIR
   };
 
-  History( void ) {}
+  // flags for Save()
+  enum {
+    HIST_SAVE_NETWORK = 0x01,   // only what the peer needs
+    HIST_SAVE_UNSENT  = 0x02    // only events not saved with this flag
+  };                            // before
+
+  History( void ) : batch(false) {}
   short Load( MemBuffer &file, Mission &mission );
-  int Save( MemBuffer &file, bool network = false ) const;
+  short LoadLegacy( MemBuffer &file, Mission &mission );
+  int Save( MemBuffer &file, const Mission &mission,
+            unsigned short flags = 0, const Unit *hold = NULL ) const;
+  bool Unsent( const Unit *hold ) const;
 
   void StartRecording( List &list );
 
@@ -85,8 +98,12 @@ public:
   void SetEventsProcessed( void ) const;
   const List &GetEvents( void ) const { return events; }
   Unit *GetDummy( unsigned short id ) const;
+  void SetUnitTypes( const UnitType *types );
 
 private:
+  bool Include( const HistEvent &he, unsigned short flags,
+                const Unit *hold ) const;
+
   void BeginReplay( List &backup, Map *map );
   void EndReplay( List &backup, Map *map );
 
@@ -96,11 +113,19 @@ private:
   void ReplayMoveEvent( const HistEvent &event, MapWindow *mapwin );
   void ReplayTileEvent( const HistEvent &event, MapWindow *mapwin );
   void ReplayUnitEvent( const HistEvent &event, MapWindow *mapwin );
+  void ApplyCombatEvent( const HistEvent &event );
+
+  void Damage( const Point &hex );
+  void RepairDamage( MapWindow *mapwin );
 
   List events;
   List units;
 
   unsigned short delay;
+  bool batch;               // apply events without animation
+
+  vector<bool> damaged;     // hexes changed in batch mode, indexed
+  vector<Point> damage;     // by Map::Hex2Index()
 
   Unit *lastunit;
   Point lastpos;
@@ -70,13 +70,18 @@ extern Options CFOptions;
 InitWindow::InitWindow( View *view, Window *title ) :
     Window( WIN_CENTER, view ), title(title) {
   // read list of maps/saves
+  LevelIndex index( CFOptions.GetLanguage() );
+  index.Load();
+
   const string home_lev( get_home_levels_dir() );
   if ( !home_lev.empty() )
     FileWindow::CreateFilesList( home_lev.c_str(), ".lev", levels );
   FileWindow::CreateFilesList( get_levels_dir().c_str(), ".lev", levels );
-  CompleteFilesList( levels );
+  CompleteFilesList( levels, index );
   FileWindow::CreateFilesList( get_save_dir().c_str(), ".sav", saves );
-  CompleteFilesList( saves );
+  CompleteFilesList( saves, index );
+
+  index.Save();
 
   Audio::PlayMusic( CF_MUSIC_THEME );
 
@@ -437,7 +442,7 @@ GUI_Status InitWindow::StartGame( const char *filename ) {
 
       // if server, send initial data to client
       if ( is_server ) {
-        DynBuffer send;
+        DynBuffer &send = connection->GetSendBuffer();
         // put player ID for client at start of sync buffer
         send.Write8( pid^1 );
 
@@ -471,7 +476,6 @@ GUI_Status InitWindow::StartGame( const char *filename ) {
             if ( game->Load( *recv ) != 0 )  {
               err = -1;
             }
-            delete recv;
           } else err = -1;
         }
 
@@ -491,8 +495,15 @@ GUI_Status InitWindow::StartGame( const char *filename ) {
     }  while ( err );
 
     m = game->GetMission();
-    m->GetPlayer( pid ).SetRemote( false );
-    m->GetPlayer( pid^1 ).SetRemote( true );
+    if ( pid == CF_NET_SPECTATOR ) {
+      // connected to a relay which already has two players; both
+      // sides are controlled remotely and we only watch
+      m->GetPlayer( PLAYER_ONE ).SetRemote( true );
+      m->GetPlayer( PLAYER_TWO ).SetRemote( true );
+    } else {
+      m->GetPlayer( pid ).SetRemote( false );
+      m->GetPlayer( pid^1 ).SetRemote( true );
+    }
     game->SetNetworkConnection( connection );
 
     view->CloseWindow( nsw );
@@ -549,19 +560,27 @@ short InitWindow::AskForSide( Mission &m ) const {
 // DESCRIPTION: For the levels list display we need some information
 //              about the maps (campaign info, 1 or 2 players). This
 //              information is attached to the list items.
-// PARAMETERS : list - list of files created using create_files_list()
+// PARAMETERS : list  - list of files created using create_files_list()
+//              index - level information cache
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
 
-void InitWindow::CompleteFilesList( TLWList &list ) {
+void InitWindow::CompleteFilesList( TLWList &list, LevelIndex &index ) {
   bool reorder = false;
+  TLWNode *n, *next;
+  vector<string> paths;
+
+  for ( n = static_cast<TLWNode *>(list.Head()); n;
+        n = static_cast<TLWNode *>(n->Next()) )
+    paths.push_back( *(string *)n->UserData() );
+  index.Update( paths );
 
-  for ( TLWNode *n = static_cast<TLWNode *>(list.Head()), *next; n; n = next ) {
+  for ( n = static_cast<TLWNode *>(list.Head()); n; n = next ) {
     next = static_cast<TLWNode *>(n->Next());
     string *fullname = (string *)n->UserData();
     bool campaign = false, skirmish = false, remove = false;
 
-    Mission *m = LoadMission( fullname->c_str(), false );
+    const LevelInfo *m = index.Get( *fullname );
     if ( m ) {
       string filename;
       string title;
@@ -569,22 +588,22 @@ void InitWindow::CompleteFilesList( TLWList &list ) {
       filename.assign( n->Name() );
       filename.erase( filename.size() - 4 );    // remove .sav/.lev
 
-      if ( (m->GetFlags() & GI_SAVEFILE) || !m->GetName() ) {
+      if ( (m->flags & GI_SAVEFILE) || !m->GetName() ) {
         // saved game -> use file name
         title = filename;
       } else {
         // new mission
         // campaign maps are only available if they have been unlocked
         // by playing the campaign
-        campaign = ( (m->GetFlags() & GI_CAMPAIGN) &&   // campaign map
-                     (m->GetCampaignName() != 0) );     // first map of a campaign
+        campaign = ( (m->flags & GI_CAMPAIGN) &&            // campaign map
+                     (m->GetCampaignName() != 0) );       // first map of a campaign
 
-        skirmish = ( (m->GetFlags() & GI_SKIRMISH) &&     // skirmish map
-                     (!(m->GetFlags() & GI_CAMPAIGN) ||   // no campaign map
+        skirmish = ( (m->flags & GI_SKIRMISH) &&            // skirmish map
+                     (!(m->flags & GI_CAMPAIGN) ||          // no campaign map
                       campaign ||                         // first campaign map
                       !CFOptions.IsLocked( filename )) ); // or already played
 
-        if ( (m->GetFlags() & GI_CAMPAIGN) &&   // campaign map
+        if ( (m->flags & GI_CAMPAIGN) &&         // campaign map
              (m->GetCampaignName() != 0) ) {    // first map of a campaign
           TLWNode *cnode = new TLWNode( m->GetCampaignName() );
           string *full_path = new string(*fullname);
@@ -603,25 +622,23 @@ void InitWindow::CompleteFilesList( TLWList &list ) {
       if ( !remove ) {
         title += ' ';
         title += '(';
-        if ( m->GetFlags() & GI_PBEM ) title += MSG(MSG_TAG_PBEM);
-        else if ( m->GetFlags() & GI_NETWORK ) title += MSG(MSG_TAG_NET);
-        else if ( m->GetFlags() & GI_SAVEFILE ) {
-          if ( !m->GetPlayer(PLAYER_ONE).IsHuman() ||
-               !m->GetPlayer(PLAYER_TWO).IsHuman() )
+        if ( m->flags & GI_PBEM ) title += MSG(MSG_TAG_PBEM);
+        else if ( m->flags & GI_NETWORK ) title += MSG(MSG_TAG_NET);
+        else if ( m->flags & GI_SAVEFILE ) {
+          if ( !m->human[PLAYER_ONE] || !m->human[PLAYER_TWO] )
             title += '1';
           else title += '2';
-        } else title += ((m->GetFlags() & GI_AI) != 0 ? '1' : '2');
+        } else title += ((m->flags & GI_AI) != 0 ? '1' : '2');
 
-        if ( m->GetFlags() & GI_SAVEFILE ) {
+        if ( m->flags & GI_SAVEFILE ) {
           title += ", ";
           title += MSG(MSG_TURN);
           title += ' ';
-          title += StringUtil::tostring(m->GetTurn());
+          title += StringUtil::tostring(m->turn);
         }
         title += ')';
         n->SetName( title );
       }
-      delete m;
     } else remove = true;
 
     if ( remove ) {
@@ -648,8 +665,8 @@ void InitWindow::CompleteFilesList( TLWList &list ) {
 Mission *InitWindow::LoadMission( const char *filename, bool full ) const {
   Mission *m = 0;
 
-  File file( filename );
-  if ( file.Open( "rb" ) ) {
+  MemoryBuffer file( filename );
+  if ( file.Open() ) {
     int rc;
     m = new Mission();
 
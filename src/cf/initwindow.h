@@ -28,6 +28,7 @@
 #include "button.h"
 #include "mapwindow.h"
 #include "network.h"
+#include "levelindex.h"
 
 class TitleWindow : public Window {
 public:
@@ -47,7 +48,7 @@ public:
   void VideoModeChange( void );
 
 private:
-  void CompleteFilesList( TLWList &list );
+  void CompleteFilesList( TLWList &list, LevelIndex &index );
   Mission *LoadMission( const char *filename, bool full = true ) const;
   GUI_Status StartGame( const char *filename );
   void Rebuild( void );
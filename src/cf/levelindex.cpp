@@ -0,0 +1,330 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// levelindex.cpp -- cached information about levels and saved games
+//
+// The level selection dialog needs a few bits of information from the
+// header of every level and saved game (flags, turn, player types, and
+// the localized mission and campaign names). Instead of opening and
+// inflating all files each time the dialog is opened, this information
+// is kept in a small index file in the configuration directory.
+//
+// The index file is written in little-endian format:
+//
+//   u32 FID_LEVELINDEX, u8 LEVELINDEX_VERSION,
+//   u16 language length, language, u16 number of entries
+//
+// and for each entry
+//
+//   u16 path length, path, u32 size, u32 mtime, u8 valid, u16 flags,
+//   u16 turn, u8 player types, u16 name length, name,
+//   u16 campaign name length, campaign name
+//
+// The names are stored in the language the index was created for.
+// If the language changes the index is discarded.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32_WCE
+# include <sys/stat.h>
+#endif
+
+#include "SDL.h"
+
+#include "levelindex.h"
+#include "mission.h"
+#include "fileio.h"
+#include "misc.h"
+
+#define FID_LEVELINDEX      MakeID('L','I','D','X')
+#define LEVELINDEX_VERSION  1
+
+// state shared by the scanner threads
+struct ScanJob {
+  const vector<string> *paths;
+  const vector<LevelInfo *> *infos;
+  const string *lang;
+  SDL_mutex *lock;
+  unsigned int next;
+};
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : file_stat
+// DESCRIPTION: Get size and modification time of a file.
+// PARAMETERS : path  - file name
+//              size  - buffer for the size
+//              mtime - buffer for the modification time
+// RETURNS    : TRUE on success, FALSE if the information is not
+//              available
+////////////////////////////////////////////////////////////////////////
+
+static bool file_stat( const string &path, unsigned long &size, long &mtime ) {
+#ifdef _WIN32_WCE
+  return false;
+#else
+  struct stat st;
+  if ( stat( path.c_str(), &st ) != 0 ) return false;
+
+  size = st.st_size;
+  mtime = st.st_mtime;
+  return true;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : scan_level
+// DESCRIPTION: Read the information we need from a level file. This
+//              may be called from any thread.
+// PARAMETERS : path - file name
+//              info - information buffer
+//              lang - language to use for the names
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+static void scan_level( const string &path, LevelInfo &info, const string &lang ) {
+  MemoryBuffer file( path );
+  Mission m;
+
+  info.valid = file.Open() && (m.QuickLoad( file ) != -1);
+  info.flags = info.turn = 0;
+  info.human[PLAYER_ONE] = info.human[PLAYER_TWO] = false;
+  info.name.erase();
+  info.campaign.erase();
+
+  if ( info.valid ) {
+    m.SetLocale( lang );
+
+    info.flags = m.GetFlags();
+    info.turn = m.GetTurn();
+    info.human[PLAYER_ONE] = m.GetPlayer(PLAYER_ONE).IsHuman();
+    info.human[PLAYER_TWO] = m.GetPlayer(PLAYER_TWO).IsHuman();
+    info.name.assign( m.GetName() ? m.GetName() : "" );
+    info.campaign.assign( m.GetCampaignName() ? m.GetCampaignName() : "" );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : scan_thread
+// DESCRIPTION: Scanner thread entry point. Levels are taken from the
+//              job until none are left.
+// PARAMETERS : data - ScanJob
+// RETURNS    : 0
+////////////////////////////////////////////////////////////////////////
+
+static int scan_thread( void *data ) {
+  ScanJob *job = (ScanJob *)data;
+
+  for ( ; ; ) {
+    SDL_mutexP( job->lock );
+    unsigned int i = job->next++;
+    SDL_mutexV( job->lock );
+
+    if ( i >= job->paths->size() ) break;
+    scan_level( (*job->paths)[i], *(*job->infos)[i], *job->lang );
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : LevelIndex::Load
+// DESCRIPTION: Read the index from disk.
+// PARAMETERS : -
+// RETURNS    : 0 on success, -1 if the index is not available or does
+//              not match the current language
+////////////////////////////////////////////////////////////////////////
+
+int LevelIndex::Load( void ) {
+  string fname( get_config_dir() );
+  append_path( fname, LEVELINDEX_FILE );
+
+  MemoryBuffer file( fname );
+  if ( !file.Open() ||
+       (file.Read32() != FID_LEVELINDEX) ||
+       (file.Read8() != LEVELINDEX_VERSION) ||
+       (file.ReadS( file.Read16() ) != lang) ) return -1;
+
+  unsigned short num = file.Read16();
+  for ( int i = 0; (i < num) && (file.Remaining() > 0); ++i ) {
+    string path( file.ReadS( file.Read16() ) );
+    LevelInfo &info = entries[path];
+
+    info.size = file.Read32();
+    info.mtime = file.Read32();
+    info.valid = (file.Read8() != 0);
+    info.seen = false;
+    info.flags = file.Read16();
+    info.turn = file.Read16();
+
+    unsigned char types = file.Read8();
+    info.human[PLAYER_ONE] = (types & 1) != 0;
+    info.human[PLAYER_TWO] = (types & 2) != 0;
+
+    info.name = file.ReadS( file.Read16() );
+    info.campaign = file.ReadS( file.Read16() );
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : LevelIndex::Save
+// DESCRIPTION: Write the index to disk if it has been modified. Entries
+//              for files which have not been seen since the index was
+//              loaded are dropped.
+// PARAMETERS : -
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int LevelIndex::Save( void ) {
+  map<string, LevelInfo>::iterator it;
+  unsigned short num = 0;
+
+  for ( it = entries.begin(); it != entries.end(); ++it ) {
+    if ( it->second.seen ) ++num;
+    else dirty = true;
+  }
+
+  if ( !dirty ) return 0;
+
+  string fname( get_config_dir() );
+  append_path( fname, LEVELINDEX_FILE );
+
+  File file( fname );
+  if ( !file.Open( "wb" ) ) return -1;
+
+  file.Write32( FID_LEVELINDEX );
+  file.Write8( LEVELINDEX_VERSION );
+  file.Write16( lang.size() );
+  file.WriteS( lang );
+  file.Write16( num );
+
+  for ( it = entries.begin(); it != entries.end(); ++it ) {
+    const LevelInfo &info = it->second;
+    if ( !info.seen ) continue;
+
+    file.Write16( it->first.size() );
+    file.WriteS( it->first );
+    file.Write32( info.size );
+    file.Write32( info.mtime );
+    file.Write8( info.valid ? 1 : 0 );
+    file.Write16( info.flags );
+    file.Write16( info.turn );
+    file.Write8( (info.human[PLAYER_ONE] ? 1 : 0)|(info.human[PLAYER_TWO] ? 2 : 0) );
+    file.Write16( info.name.size() );
+    file.WriteS( info.name );
+    file.Write16( info.campaign.size() );
+    file.WriteS( info.campaign );
+  }
+
+  file.Close();
+  dirty = false;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : LevelIndex::Update
+// DESCRIPTION: Make sure the index contains up-to-date information
+//              about the given files.
+// PARAMETERS : paths - full paths of level or save files
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void LevelIndex::Update( const vector<string> &paths ) {
+  vector<string> todo;
+  vector<LevelInfo *> infos;
+
+  for ( vector<string>::const_iterator it = paths.begin();
+        it != paths.end(); ++it ) {
+    unsigned long size = 0;
+    long mtime = 0;
+    bool known = file_stat( *it, size, mtime );
+
+    map<string, LevelInfo>::iterator e = entries.find( *it );
+    if ( known && (e != entries.end()) &&
+         (e->second.size == size) && (e->second.mtime == mtime) ) {
+      e->second.seen = true;
+    } else {
+      LevelInfo &info = entries[*it];
+      info.size = size;
+      info.mtime = mtime;
+      info.seen = known;    // don't store entries we can't validate
+      todo.push_back( *it );
+      infos.push_back( &info );
+    }
+  }
+
+  if ( !todo.empty() ) {
+    Scan( todo, infos );
+    dirty = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : LevelIndex::Scan
+// DESCRIPTION: Examine a number of files. If there is more than one
+//              file the work is distributed across several threads.
+// PARAMETERS : paths - files to examine
+//              infos - information buffers, one for each file
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void LevelIndex::Scan( const vector<string> &paths,
+                       const vector<LevelInfo *> &infos ) {
+  ScanJob job;
+  job.paths = &paths;
+  job.infos = &infos;
+  job.lang = &lang;
+  job.lock = SDL_CreateMutex();
+  job.next = 0;
+
+  SDL_Thread *threads[LEVELINDEX_THREADS];
+  int i, num = 0;
+
+  if ( job.lock && (paths.size() > 1) ) {
+    for ( i = 0; (i < LEVELINDEX_THREADS) && (i < (int)paths.size()); ++i ) {
+      threads[num] = SDL_CreateThread( scan_thread, &job );
+      if ( threads[num] ) ++num;
+    }
+  }
+
+  if ( num == 0 ) {
+    // no threads available; do it ourselves
+    for ( i = 0; i < (int)paths.size(); ++i )
+      scan_level( paths[i], *infos[i], lang );
+  } else {
+    for ( i = 0; i < num; ++i ) SDL_WaitThread( threads[i], NULL );
+  }
+
+  if ( job.lock ) SDL_DestroyMutex( job.lock );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : LevelIndex::Get
+// DESCRIPTION: Get the information about a file. The file must have
+//              been passed to LevelIndex::Update() before.
+// PARAMETERS : path - full path of the file
+// RETURNS    : level information or NULL if not available or not a
+//              valid level file
+////////////////////////////////////////////////////////////////////////
+
+const LevelInfo *LevelIndex::Get( const string &path ) const {
+  map<string, LevelInfo>::const_iterator it = entries.find( path );
+  if ( (it == entries.end()) || !it->second.valid ) return NULL;
+  return &it->second;
+}
+
@@ -0,0 +1,75 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+/////////////////////////////////////////////////////////////////////////
+// levelindex.h - cached information about levels and saved games
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef _INCLUDE_LEVELINDEX_H
+#define _INCLUDE_LEVELINDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+#define LEVELINDEX_FILE     "levels.idx"
+#define LEVELINDEX_THREADS  4
+
+// the subset of mission data required for the level selection lists
+struct LevelInfo {
+  unsigned long size;       // size and modification time of the file
+  long mtime;               // when the information was collected
+  bool valid;               // file is a mission we can read
+  bool seen;                // file still exists (not stored)
+  unsigned short flags;
+  unsigned short turn;
+  bool human[2];            // player types
+  string name;              // localized mission name
+  string campaign;          // localized campaign name
+
+  const char *GetName( void ) const
+    { return name.empty() ? NULL : name.c_str(); }
+  const char *GetCampaignName( void ) const
+    { return campaign.empty() ? NULL : campaign.c_str(); }
+};
+
+// The index is stored in the configuration directory. Entries are
+// identified by path, size and modification time of the level file,
+// and only new or modified files have to be examined when the index
+// is updated. Those are read in parallel on a few threads.
+class LevelIndex {
+public:
+  LevelIndex( const char *lang ) : lang(lang), dirty(false) {}
+
+  int Load( void );
+  int Save( void );
+
+  void Update( const vector<string> &paths );
+  const LevelInfo *Get( const string &path ) const;
+
+private:
+  void Scan( const vector<string> &paths, const vector<LevelInfo *> &infos );
+
+  map<string, LevelInfo> entries;
+  string lang;
+  bool dirty;
+};
+
+#endif	/* _INCLUDE_LEVELINDEX_H */
+
@@ -45,6 +45,8 @@
 #include "msgs.h"
 #include "network.h"
 #include "platform.h"
+#include "setcache.h"
+#include "codec.h"
 
 // global vars
 Game *Gam;
@@ -78,7 +80,7 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE hPrev, LPTSTR szCmdLine, int sw) {
 int main( int argc, char **argv ) {
 #endif
   struct GUIOptions guiopts = { DEFAULT_RESOLUTION, DISPLAY_BPP, true, true,
-                    MIX_MAX_VOLUME*3/4, MIX_MAX_VOLUME/2, SDL_HWSURFACE, NULL };
+                    MIX_MAX_VOLUME*3/4, MIX_MAX_VOLUME/2, SDL_HWSURFACE, NULL, NULL, 0 };
 
   load_settings( guiopts );
 
@@ -92,9 +94,12 @@ int main( int argc, char **argv ) {
     // only open intro screen if the user didn't supply a level on the command line
     int intro = 1;
 
-    if ( guiopts.level ) {
+    if ( guiopts.level || guiopts.replay ) {
       Gam = new Game( display );
-      intro = Gam->Load( guiopts.level );
+      if ( guiopts.replay )
+        intro = Gam->LoadRecording( guiopts.replay, guiopts.replay_turn );
+      else
+        intro = Gam->Load( guiopts.level );
       Mission *m = Gam->GetMission();
       if ( !intro ) {
         // default is to play single-player single-map
@@ -130,6 +135,7 @@ int main( int argc, char **argv ) {
 
       do {
         status = display->HandleEvents();
+        if ( Gam ) Gam->StreamActions();
       } while ( (status != GUI_QUIT) && (status != GUI_RESTART) );
 
       delete Gam;
@@ -152,9 +158,19 @@ int main( int argc, char **argv ) {
 //                     initialized with defaults before calling this
 //                     method
 // RETURNS    : -
+//
+// NOTE       : Computer player profiling can also be enabled by
+//              setting the environment variable CRIMSON_AI_PROFILE.
+//              The command line option takes precedence.
 ////////////////////////////////////////////////////////////////////////
 
 static void parse_options( int argc, char **argv, GUIOptions &opts ) {
+  const char *prof = getenv( "CRIMSON_AI_PROFILE" );
+  if ( prof && *prof ) CFOptions.SetProfileLog( prof );
+
+  // saved games are written much more often than they are
+  // distributed, so favour speed over size by default
+  Codec::SetDefault( CODEC_LZ );
 
   while ( argc > 1 ) {
     --argc;
@@ -165,6 +181,18 @@ static void parse_options( int argc, char **argv, GUIOptions &opts ) {
       opts.px_height = atoi(argv[argc]);
     } else if (strcmp(argv[argc-1], "--level") == 0) {
       opts.level = argv[argc];
+    } else if (strcmp(argv[argc-1], "--profile") == 0) {
+      CFOptions.SetProfileLog( argv[argc] );
+    } else if (strcmp(argv[argc-1], "--record") == 0) {
+      CFOptions.SetRecordFile( argv[argc] );
+    } else if (strcmp(argv[argc-1], "--replay") == 0) {
+      opts.replay = argv[argc];
+    } else if (strcmp(argv[argc-1], "--turn") == 0) {
+      opts.replay_turn = atoi(argv[argc]);
+    } else if (strcmp(argv[argc-1], "--compress") == 0) {
+      int codec = Codec::Find( argv[argc] );
+      if ( codec != -1 ) Codec::SetDefault( codec );
+      else cerr << "Warning: Unknown compression method " << argv[argc] << endl;
     } else if (strcmp(argv[argc-1], "--fullscreen") == 0) {
       if ( atoi( argv[argc] ) ) opts.sdl_flags |= SDL_FULLSCREEN;
       else opts.sdl_flags &= ~SDL_FULLSCREEN;
@@ -200,6 +228,13 @@ static void print_usage( char *prog ) {
 #ifndef DISABLE_SOUND
             << "  --sound <1|0>        enable/disable sound" << endl
 #endif
+            << "  --profile <file>     log computer player statistics to file" << endl
+            << "                       (- for stderr)" << endl
+            << "  --compress <method>  compression for saved games" << endl
+            << "                       (none, fast, or best)" << endl
+            << "  --record <file>      record games to file" << endl
+            << "  --replay <file>      play back a game recording" << endl
+            << "  --turn <turn>        start playback at the given turn" << endl
             << "  --help               display this help and exit" << endl
             << "  --version            output version information and exit" << endl;
 }
@@ -227,8 +262,8 @@ static View *init( GUIOptions &opts ) {
 
     string datpath( get_data_dir() );
     datpath.append( CF_DATFILE );
-    File datfile( datpath );
-    if ( datfile.Open( "rb" ) ) {
+    MemoryBuffer datfile( datpath );
+    if ( datfile.Open() ) {
 
       icons = new Surface;    // load icons surface
       if ( !icons->LoadImageData( datfile ) ) {
@@ -509,6 +544,11 @@ static GUI_Status event_filter( SDL_Event &event, Window *window ) {
         SDL_WM_IconifyWindow();
       else rc = GUI_OK;            // send to windows
     }
+  } else if ( (event.type == SDL_USEREVENT) &&
+              (event.user.code == AUTOSAVE_FAILED) ) {
+    // background save failed
+    new NoteWindow( MSG(MSG_ERROR), MSG(MSG_ERR_SAVE), 0, display );
+    rc = GUI_NONE;
   } else if ( event.type == SDL_QUIT ) do_exit();
 
   return rc;
@@ -523,6 +563,7 @@ static GUI_Status event_filter( SDL_Event &event, Window *window ) {
 
 static void do_exit( void ) {
   delete Gam;
+  SetCache::Flush();
 
   platform_dispose();
 
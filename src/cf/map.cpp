@@ -21,6 +21,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "map.h"
+#include "profile.h"
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Map::Map
@@ -235,10 +236,47 @@ short Map::SetUnit( Unit *u, const Point &pos ) {
         }
       }
     } else m_objects[Hex2Index(pos)] = u;
+
+    for ( vector<HexObserver *>::iterator it = observers.begin();
+          it != observers.end(); ++it )
+      (*it)->HexChanged( pos );
   }
   return conquer;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Map::SetHexType
+// DESCRIPTION: Change the terrain of a hex.
+// PARAMETERS : x    - horizontal hex position
+//              y    - vertical hex position
+//              type - new terrain type
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Map::SetHexType( short x, short y, short type ) {
+  m_data[y * m_w + x] = type;
+  for ( vector<HexObserver *>::iterator it = observers.begin();
+        it != observers.end(); ++it )
+    (*it)->TerrainChanged( Point(x, y) );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Map::RemoveObserver
+// DESCRIPTION: Stop notifying an observer about changes to the map.
+// PARAMETERS : observer - observer to remove
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Map::RemoveObserver( HexObserver *observer ) {
+  for ( vector<HexObserver *>::iterator it = observers.begin();
+        it != observers.end(); ++it ) {
+    if ( *it == observer ) {
+      observers.erase( it );
+      return;
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Map::GetBuilding
 // DESCRIPTION: Get a building from the map.
@@ -297,6 +335,7 @@ signed char Map::MoveCost( const Unit *u, const Point &src,
   const TerrainType *type = HexType( dst );
   bool hexok = (type->tt_type & u->Terrain()) != 0;
 
+  ++PStats.move_cost;
   state = 0;
 
   Unit *block = GetUnit( dst );
@@ -23,6 +23,9 @@
 #ifndef _INCLUDE_MAP_H
 #define _INCLUDE_MAP_H
 
+#include <vector>
+using namespace std;
+
 #include "hexsup.h"
 #include "rect.h"
 #include "unit.h"
@@ -69,8 +72,10 @@ public:
   bool IsShop( const Point &hex ) const { return (TerrainTypes(hex) & TT_ENTRANCE) != 0; }
 
   unsigned long HexColor( unsigned short xy ) const;
-  void SetHexType( short x, short y, short type )
-               { m_data[y * m_w + x] = type; }
+  void SetHexType( short x, short y, short type );
+
+  void AddObserver( HexObserver *observer ) { observers.push_back( observer ); }
+  void RemoveObserver( HexObserver *observer );
 
   short GetNeighbors( const Point &hex, Point *parray ) const;
   int Hex2Index( const Point &hex ) const { return hex.y * m_w + hex.x; }
@@ -86,6 +91,7 @@ private:
   MapObject **m_objects;
   UnitSet *uset;
   TerrainSet *tset;
+  vector<HexObserver *> observers;   // notified about changes to hexes
 };
 
 #endif	/* _INCLUDE_MAP_H */
@@ -38,10 +38,11 @@
 
 MapWindow::MapWindow( short x, short y, unsigned short w, unsigned short h,
                       unsigned short flags, View *view ) :
-           Window( x, y, w, h, flags, view ) {
+           Window( x, y, w, h, flags, view ), anim( this ) {
   panel = new Panel( this, view );
   mview = new MapView( this, *this,
-              MV_AUTOSCROLL|MV_DISABLE|MV_DISABLE_CURSOR|MV_DISABLE_FOG );
+              MV_AUTOSCROLL|MV_DISABLE|MV_DISABLE_CURSOR|MV_DISABLE_FOG|
+              MV_TERRAIN_CACHE );
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -98,58 +99,14 @@ void MapWindow::DrawBack( short x, short y, unsigned short w, unsigned short h )
 void MapWindow::MoveHex( unsigned short img, const TileSet &tiles,
                 const Point &hex1, const Point &hex2,
                 unsigned short speed, bool blink /* = false */ ) {
-  // allocate a new surface where we can store the "background" graphics
-  Point psrc = mview->Hex2Pixel( hex1 );
-  Point pdst = mview->Hex2Pixel( hex2 );
-
-  Rect bg;
-  bg.x = MIN( psrc.x, pdst.x );
-  bg.y = MIN( psrc.y, pdst.y );
-  bg.w = tiles.TileWidth() + ABS(psrc.x-pdst.x);
-  bg.h = tiles.TileHeight() + ABS(psrc.y-pdst.y);
-  bg.Clip( *this );
-
-  Surface *bgs = new Surface;
-  if ( !bgs->Create( bg.w, bg.h, DISPLAY_BPP, 0 ) ) {
-    unsigned long oldticks, ticks = 0, blinkticks = 0;
-    Point curp = mview->Cursor();
-
-    Blit( bgs, bg, 0, 0 );
-
-    if ( blink && mview->CursorEnabled() ) {
-      mview->DisableCursor();
-      Show( mview->UpdateHex( curp ) );
-      blinkticks = speed / 2;
-    }
-
-    oldticks = SDL_GetTicks();
-    do {
-      short cx, cy;
-
-      // don't modify the following three lines; some versions of gcc
-      // (e.g. 2.95.3) seem to produce bogus code when all the calculations
-      // are done in one line
-      cx = (short)((pdst.x - psrc.x) * ticks);
-      cy = (short)((pdst.y - psrc.y) * ticks);
-      tiles.DrawTile( img, this,
-            psrc.x + cx / speed, psrc.y + cy / speed, bg );
-
-      Show( bg );
-      bgs->Blit( this, Rect( 0, 0, bg.w, bg.h ), bg.x, bg.y );
-
-      ticks = SDL_GetTicks() - oldticks;
-
-      if ( blinkticks && ticks >= blinkticks ) {
-        mview->EnableCursor();
-        Show( mview->UpdateHex( curp ) );
-        blinkticks = 0;
-      }
-
-    } while ( ticks < speed );
-
-    Show( bg );
+  if ( blink && mview->CursorEnabled() ) {
+    mview->DisableCursor();
+    Show( mview->UpdateHex( mview->Cursor() ) );
+    anim.Add( new CursorBlinkAnimation( mview, speed / 2 ) );
   }
-  delete bgs;
+
+  anim.Add( new HexMoveAnimation( mview, img, tiles, hex1, hex2, speed ) );
+  anim.Run();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -164,46 +121,8 @@ void MapWindow::MoveHex( unsigned short img, const TileSet &tiles,
 ////////////////////////////////////////////////////////////////////////
 
 void MapWindow::FadeHex( unsigned short img, const Point &hex, bool in, bool unit ) {
-  unsigned long firstticks, oldticks, ticks;
-  Point pos = mview->Hex2Pixel( hex );
-  const Rect dest( pos.x, pos.y, mview->TileWidth(), mview->TileHeight() );
-  const unsigned int speed = 4 * ANIM_SPEED_UNIT;
-  const unsigned short terrain = mview->GetMap()->HexImage( hex );
-
-  Surface tile;
-  tile.Create( mview->TileWidth(), mview->TileHeight(), DISPLAY_BPP, SDL_HWSURFACE );
-  tile.SetAlpha( SDL_ALPHA_TRANSPARENT, SDL_SRCALPHA );
-  tile.SetColorKey( Color(CF_COLOR_WHITE) );
-  tile.DisplayFormat();
-  tile.Flood( Color(CF_COLOR_WHITE) );
-
-  Unit *blocker = NULL;
-  if ( unit ) mview->DrawUnit( img, &tile, 0, 0, tile );
-  else {
-    mview->DrawTerrain( img, &tile, 0, 0, tile );
-    blocker = mview->GetMap()->GetUnit( hex );
-  }
-
-  firstticks = oldticks = SDL_GetTicks();
-  do {
-    ticks = SDL_GetTicks() - firstticks;
-
-    int alpha = SDL_ALPHA_OPAQUE * ticks / speed;
-    if ( alpha > SDL_ALPHA_OPAQUE ) alpha = SDL_ALPHA_OPAQUE;
-    if ( !in ) alpha = SDL_ALPHA_OPAQUE - alpha;
-
-    tile.SetAlpha( alpha, SDL_SRCALPHA );
-    mview->DrawTerrain( terrain, this, pos.x, pos.y, dest );
-    tile.Blit( this, tile, pos.x, pos.y );
-    if ( blocker )
-      mview->DrawUnit( blocker->Image(), this, pos.x, pos.y, dest );
-    Show( dest );
-
-    if ( ticks - oldticks < 30 ) SDL_Delay( 25 );
-    oldticks = ticks;
-  } while ( ticks < speed );
-
-  Show( dest );
+  anim.Add( new HexFadeAnimation( mview, img, hex, in, unit ) );
+  anim.Run();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -215,57 +134,8 @@ void MapWindow::FadeHex( unsigned short img, const Point &hex, bool in, bool uni
 ////////////////////////////////////////////////////////////////////////
 
 void MapWindow::FlashUnit( const Point &hex, unsigned short times ) {
-  unsigned long firstticks, oldticks, ticks;
-  Point pos = mview->Hex2Pixel( hex );
-  const Rect dest( pos.x, pos.y, mview->TileWidth(), mview->TileHeight() );
-  const unsigned int speed = ANIM_SPEED_UNIT * 3 / 2;
-  const unsigned int delay = speed / 3;
-  unsigned short img;
-  bool show_cursor;
-
-  Surface tile;
-  tile.Create( mview->TileWidth(), mview->TileHeight(), DISPLAY_BPP, 0 );
-  tile.SetAlpha( SDL_ALPHA_OPAQUE, SDL_SRCALPHA );
-  tile.SetColorKey( Color(CF_COLOR_WHITE) );
-  tile.DisplayFormat();
-  tile.Flood( Color(CF_COLOR_WHITE) );
-
-  img = mview->GetMap()->GetUnit( hex )->Image();
-  mview->DrawUnit( img, &tile, 0, 0, tile );
-  show_cursor = mview->CursorEnabled() && (mview->Cursor() == hex);
-  if ( show_cursor )
-    mview->DrawTerrain( mview->GetCursorImage(), &tile, 0, 0, tile );
-
-  Surface whitetile;
-  whitetile.Create( mview->TileWidth(), mview->TileHeight(), DISPLAY_BPP, 0 );
-  whitetile.SetAlpha( SDL_ALPHA_OPAQUE / 4, SDL_SRCALPHA );
-  whitetile.DisplayFormat();
-  whitetile.Flood( Color(CF_COLOR_WHITE) );
-
-  for ( int i = 0; i < times; ++i ) {
-    firstticks = oldticks = SDL_GetTicks();
-    do {
-      whitetile.Blit( &tile, whitetile, 0, 0 );
-      if ( show_cursor )
-        mview->DrawTerrain( mview->GetCursorImage(), &tile, 0, 0, tile );
-      tile.Blit( this, tile, pos.x, pos.y );
-      Show( dest );
-
-      ticks = SDL_GetTicks() - firstticks;
-      if ( ticks - oldticks < 30 ) SDL_Delay( 25 );
-      oldticks = ticks;
-    } while ( ticks < delay );
-
-    SDL_Delay( delay );
-
-    mview->DrawUnit( img, &tile, 0, 0, tile );
-    if ( show_cursor )
-      mview->DrawTerrain( mview->GetCursorImage(), &tile, 0, 0, tile );
-    tile.Blit( this, tile, pos.x, pos.y );
-    Show( dest );
-
-    SDL_Delay( delay );
-  }
+  anim.Add( new HexFlashAnimation( mview, hex, times ) );
+  anim.Run();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -501,14 +371,14 @@ void Panel::VideoModeChange( void ) {
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TacticalWindow::TacticalWindow
 // DESCRIPTION: Create a window and show an overview map of the level.
-// PARAMETERS : mapview - pointer to map viewport
-//              m       - mission object
-//              view    - pointer to the window's view
+// PARAMETERS : mapwin - pointer to the map window
+//              m      - mission object
+//              view   - pointer to the window's view
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
 
-TacticalWindow::TacticalWindow( MapView *mapview, Mission &m, View *view ) :
-        Window( WIN_CLOSE_ESC|WIN_CENTER, view ), mv(mapview), mission(m),
+TacticalWindow::TacticalWindow( MapWindow *mapwin, Mission &m, View *view ) :
+        Window( WIN_CLOSE_ESC|WIN_CENTER, view ), mv(mapwin->GetMapView()), mission(m),
         p1(m.GetPlayer(PLAYER_ONE)), p2(m.GetPlayer(PLAYER_TWO)) {
   Map *pmap = mv->GetMap();
 
@@ -547,8 +417,12 @@ TacticalWindow::TacticalWindow( MapView *mapview, Mission &m, View *view ) :
 
   mw = new MapWidget( 0, map.x, map.y, map.w, map.h,
                       WIDGET_HSCROLLKEY|WIDGET_VSCROLLKEY, this );
-  mw->SetPlayerColors( p1.LightColor(), p2.LightColor() );
-  mw->SetMap( pmap, viewport, magnify );
+  // the overview is kept by the map window and only repainted where
+  // the map has changed since the last time
+  MapOverview *overview = mapwin->GetOverview();
+  overview->SetPlayerColors( p1.LightColor(), p2.LightColor() );
+  overview->SetMap( pmap, magnify );
+  mw->SetOverview( overview, viewport );
   mw->SetHook( this );
 
   Draw();
@@ -665,12 +539,14 @@ CombatWindow::CombatWindow( Combat *combat, MapWindow *mapwin, View *view ) :
     startgroup1( att->GroupSize() ), startgroup2( def->GroupSize() ) {
 
   MapView *mv = mapwin->GetMapView();
+  const TerrainSet *ts = mv->GetMap()->GetTerrainSet();
 
-  // calculate window dimensions
+  // calculate window dimensions; the units are shown at their
+  // original size regardless of the map zoom level
   short wwidth = (MAX( sfont->TextWidth( att->Name() ),
                        sfont->TextWidth( def->Name() ) ) + XP_ICON_WIDTH + 25) * 2;
-  wwidth = MAX( wwidth, mv->TileWidth() * 6 + 50 );
-  Rect win( 0, 0, wwidth, mv->TileHeight() * 3 + sfont->Height() * 2 + 50 );
+  wwidth = MAX( wwidth, ts->TileWidth() * 6 + 50 );
+  Rect win( 0, 0, wwidth, ts->TileHeight() * 3 + sfont->Height() * 2 + 50 );
 
   // place window on map window
   mv->CenterOnHex( Point( (apos.x + dpos.x) / 2, (apos.y + dpos.y) / 2 ) );
@@ -694,21 +570,21 @@ CombatWindow::CombatWindow( Combat *combat, MapWindow *mapwin, View *view ) :
   msgbar1 = Rect( 4, h - sfont->Height() - 14 - brect.h, (w - 16) / 2, sfont->Height() + 6 );
   msgbar2 = Rect( msgbar1.x + msgbar1.w + 8, msgbar1.y, msgbar1.w, msgbar1.h );
 
-  att_anchor = Rect( w/4 - mv->TileWidth()/2, 10 + mv->TileHeight(), mv->TileWidth(), mv->TileHeight() );
-  def_anchor = Rect( (w * 3)/4 - mv->TileWidth()/2, att_anchor.y, mv->TileWidth(), mv->TileHeight() );
-
-  clock[0][0] = Rect( att_anchor.x, att_anchor.y - mv->TileHeight(), mv->TileWidth(), mv->TileHeight() );
-  clock[0][1] = Rect( att_anchor.x + mv->TileWidth() - mv->TileShiftX(), att_anchor.y - mv->TileShiftY(), mv->TileWidth(), mv->TileHeight() );
-  clock[0][2] = Rect( att_anchor.x + mv->TileWidth() - mv->TileShiftX(), att_anchor.y + mv->TileShiftY(), mv->TileWidth(), mv->TileHeight() );
-  clock[0][3] = Rect( att_anchor.x, att_anchor.y + mv->TileHeight(), mv->TileWidth(), mv->TileHeight() );
-  clock[0][4] = Rect( att_anchor.x - mv->TileWidth() + mv->TileShiftX(), att_anchor.y + mv->TileShiftY(), mv->TileWidth(), mv->TileHeight() );
-  clock[0][5] = Rect( att_anchor.x - mv->TileWidth() + mv->TileShiftX(), att_anchor.y - mv->TileShiftY(), mv->TileWidth(), mv->TileHeight() );
-  clock[1][0] = Rect( def_anchor.x, def_anchor.y - mv->TileHeight(), mv->TileWidth(), mv->TileHeight() );
-  clock[1][1] = Rect( def_anchor.x + mv->TileWidth() - mv->TileShiftX(), def_anchor.y - mv->TileShiftY(), mv->TileWidth(), mv->TileHeight() );
-  clock[1][2] = Rect( def_anchor.x + mv->TileWidth() - mv->TileShiftX(), def_anchor.y + mv->TileShiftY(), mv->TileWidth(), mv->TileHeight() );
-  clock[1][3] = Rect( def_anchor.x, def_anchor.y + mv->TileHeight(), mv->TileWidth(), mv->TileHeight() );
-  clock[1][4] = Rect( def_anchor.x - mv->TileWidth() + mv->TileShiftX(), def_anchor.y + mv->TileShiftY(), mv->TileWidth(), mv->TileHeight() );
-  clock[1][5] = Rect( def_anchor.x - mv->TileWidth() + mv->TileShiftX(), def_anchor.y - mv->TileShiftY(), mv->TileWidth(), mv->TileHeight() );
+  att_anchor = Rect( w/4 - ts->TileWidth()/2, 10 + ts->TileHeight(), ts->TileWidth(), ts->TileHeight() );
+  def_anchor = Rect( (w * 3)/4 - ts->TileWidth()/2, att_anchor.y, ts->TileWidth(), ts->TileHeight() );
+
+  clock[0][0] = Rect( att_anchor.x, att_anchor.y - ts->TileHeight(), ts->TileWidth(), ts->TileHeight() );
+  clock[0][1] = Rect( att_anchor.x + ts->TileWidth() - ts->TileShiftX(), att_anchor.y - ts->TileShiftY(), ts->TileWidth(), ts->TileHeight() );
+  clock[0][2] = Rect( att_anchor.x + ts->TileWidth() - ts->TileShiftX(), att_anchor.y + ts->TileShiftY(), ts->TileWidth(), ts->TileHeight() );
+  clock[0][3] = Rect( att_anchor.x, att_anchor.y + ts->TileHeight(), ts->TileWidth(), ts->TileHeight() );
+  clock[0][4] = Rect( att_anchor.x - ts->TileWidth() + ts->TileShiftX(), att_anchor.y + ts->TileShiftY(), ts->TileWidth(), ts->TileHeight() );
+  clock[0][5] = Rect( att_anchor.x - ts->TileWidth() + ts->TileShiftX(), att_anchor.y - ts->TileShiftY(), ts->TileWidth(), ts->TileHeight() );
+  clock[1][0] = Rect( def_anchor.x, def_anchor.y - ts->TileHeight(), ts->TileWidth(), ts->TileHeight() );
+  clock[1][1] = Rect( def_anchor.x + ts->TileWidth() - ts->TileShiftX(), def_anchor.y - ts->TileShiftY(), ts->TileWidth(), ts->TileHeight() );
+  clock[1][2] = Rect( def_anchor.x + ts->TileWidth() - ts->TileShiftX(), def_anchor.y + ts->TileShiftY(), ts->TileWidth(), ts->TileHeight() );
+  clock[1][3] = Rect( def_anchor.x, def_anchor.y + ts->TileHeight(), ts->TileWidth(), ts->TileHeight() );
+  clock[1][4] = Rect( def_anchor.x - ts->TileWidth() + ts->TileShiftX(), def_anchor.y + ts->TileShiftY(), ts->TileWidth(), ts->TileHeight() );
+  clock[1][5] = Rect( def_anchor.x - ts->TileWidth() + ts->TileShiftX(), def_anchor.y - ts->TileShiftY(), ts->TileWidth(), ts->TileHeight() );
 
   button = new ButtonWidget( GUI_CLOSE, brect.x, brect.y, brect.w, brect.h, WIDGET_DEFAULT, MSG(MSG_B_OK), this );
 
@@ -740,12 +616,13 @@ void CombatWindow::Draw( void ) {
                 msgbar2.y + (msgbar2.h - sfont->Height())/2 );
 
   // draw terrain and unit image to the center of the 'clock'
-  MapView *mv = mapwin->GetMapView();
-  Map *map = mv->GetMap();
-  mv->DrawTerrain( map->HexImage( apos ), this, att_anchor.x, att_anchor.y, att_anchor );
-  mv->DrawTerrain( map->HexImage( dpos ), this, def_anchor.x, def_anchor.y, def_anchor );
-  mv->DrawUnit( att->Image(), this, att_anchor.x, att_anchor.y, att_anchor );
-  mv->DrawUnit( def->Image(), this, def_anchor.x, def_anchor.y, def_anchor );
+  Map *map = mapwin->GetMapView()->GetMap();
+  const TerrainSet *ts = map->GetTerrainSet();
+  const UnitSet *us = map->GetUnitSet();
+  ts->DrawTile( map->HexImage( apos ), this, att_anchor.x, att_anchor.y, att_anchor );
+  ts->DrawTile( map->HexImage( dpos ), this, def_anchor.x, def_anchor.y, def_anchor );
+  us->DrawTile( att->Image(), this, att_anchor.x, att_anchor.y, att_anchor );
+  us->DrawTile( def->Image(), this, def_anchor.x, def_anchor.y, def_anchor );
 
   DrawState();
 }
@@ -759,24 +636,26 @@ void CombatWindow::Draw( void ) {
 
 void CombatWindow::DrawState( void ) {
   short group1 = att->GroupSize(), group2 = def->GroupSize();
-  MapView *mv = mapwin->GetMapView();
+  Map *map = mapwin->GetMapView()->GetMap();
+  const TerrainSet *ts = map->GetTerrainSet();
+  const UnitSet *us = map->GetUnitSet();
 
   for ( int i = NORTH; i <= NORTHWEST; ++i ) {
 
     if ( i < startgroup1 ) {
-      mv->DrawTerrain( IMG_RECESSED_HEX, this, clock[0][i].x, clock[0][i].y, clock[0][i] );
-      mv->DrawUnit( att->BaseImage() + i, this, clock[0][i].x, clock[0][i].y, clock[0][i] );
+      ts->DrawTile( IMG_RECESSED_HEX, this, clock[0][i].x, clock[0][i].y, clock[0][i] );
+      us->DrawTile( att->BaseImage() + i, this, clock[0][i].x, clock[0][i].y, clock[0][i] );
 
       if ( i >= group1 )
-        mv->DrawFog( this, clock[0][i].x, clock[0][i].y, clock[0][i] );
+        ts->DrawFog( this, clock[0][i].x, clock[0][i].y, clock[0][i] );
     }
 
     if ( i < startgroup2 ) {
-      mv->DrawTerrain( IMG_RECESSED_HEX, this, clock[1][i].x, clock[1][i].y, clock[1][i] );
-      mv->DrawUnit( def->BaseImage() + i, this, clock[1][i].x, clock[1][i].y, clock[1][i] );
+      ts->DrawTile( IMG_RECESSED_HEX, this, clock[1][i].x, clock[1][i].y, clock[1][i] );
+      us->DrawTile( def->BaseImage() + i, this, clock[1][i].x, clock[1][i].y, clock[1][i] );
 
       if ( i >= group2 )
-        mv->DrawFog( this, clock[1][i].x, clock[1][i].y, clock[1][i] );
+        ts->DrawFog( this, clock[1][i].x, clock[1][i].y, clock[1][i] );
     }
   }
 }
@@ -28,9 +28,7 @@
 #include "mapwidget.h"
 #include "mission.h"
 #include "misc.h"
-
-#define ANIM_SPEED_UNIT		150  // time it takes for a unit to move one hex (ms)
-#define ANIM_SPEED_CURSOR	40   // speed when moving cursor
+#include "animation.h"
 
 #define DEFAULT_PANEL_HEIGHT	(20)
 
@@ -65,6 +63,7 @@ public:
   virtual void VideoModeChange( void );
 
   MapView *GetMapView( void ) const { return mview; }
+  MapOverview *GetOverview( void ) { return &overview; }
   Panel *GetPanel( void ) const { return panel; }
 
   void MoveHex( unsigned short img, const TileSet &tiles, const Point &hex1,
@@ -86,12 +85,14 @@ private:
 
   MapView *mview;
   Panel *panel;
+  Animator anim;
+  MapOverview overview;   // image for the tactical map
 };
 
 
 class TacticalWindow : public Window, public WidgetHook {
 public:
-  TacticalWindow( MapView *mapview, Mission &m, View *view );
+  TacticalWindow( MapWindow *mapwin, Mission &m, View *view );
 
   void Draw( void );
   GUI_Status WidgetActivated( Widget *widget, Window *win );
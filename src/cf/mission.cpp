@@ -23,6 +23,7 @@
 #include <iostream>
 
 #include "mission.h"
+#include "setcache.h"
 #include "fileio.h"
 #include "strutil.h"
 #include "globals.h"
@@ -36,116 +37,199 @@
 
 Mission::~Mission( void ) {
   delete history;
+
+  SetCache::Release( unit_set );
+  SetCache::Release( terrain_set );
 }
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Mission::Load
-// DESCRIPTION: Load a game from a mission file.
+// DESCRIPTION: Load a game from a mission file. Both sectioned files
+//              and files using the old monolithic layout (version
+//              FILE_VERSION_MONOLITHIC) are supported.
 // PARAMETERS : file - mission file
 // RETURNS    : 0 on success, non-null otherwise
 ////////////////////////////////////////////////////////////////////////
 
 int Mission::Load( MemBuffer &file ) {
   int rc = -1;
+  unsigned char version = 0;
 
-  // read game info
-  if ( (file.Read32() == FID_MISSION) && (file.Read8() == FILE_VERSION) ) {
-    unsigned short len, i;
-    string uset, tset;
+  if ( file.Read32() == FID_MISSION ) version = file.Read8();
 
-    flags = file.Read16();
-    turn = file.Read16();
+  if ( version == FILE_VERSION ) {
+    ChunkReader chunks;
 
-    name = file.Read8();
-    level_info = file.Read8();
-    campaign_name = file.Read8();
-    campaign_info = file.Read8();
-    next_map = file.Read8();
-    music = file.Read8();
-    handicap = file.Read8();
-    current_player = file.Read8();
-    turn_phase = file.Read8();
+    if ( !chunks.Load( file ) ) {
+      MemBuffer *head = chunks.GetSection( SECT_HEADER );
+      MemBuffer *mapdata = chunks.GetSection( SECT_MAP );
+      MemBuffer *sets = chunks.GetSection( SECT_SETS );
+      MemBuffer *objs = chunks.GetSection( SECT_OBJECTS );
+      MemBuffer *text = chunks.GetSection( SECT_TEXT );
 
-    p1.Load( file );
-    p2.Load( file );
+      if ( head && mapdata && sets && objs && text &&
+           !LoadHeader( *head ) && !map.Load( *mapdata ) &&
+           !LoadSets( *sets ) && !LoadObjects( *objs ) ) {
+        internal_messages.ReadCatalog( *text );
 
-    messages.Load( file );
+        MemBuffer *hist = chunks.GetSection( SECT_HISTDELTA );
+        if ( hist ) LoadHistory( *hist, false );
+        else {
+          hist = chunks.GetSection( SECT_HISTORY );
+          if ( hist ) LoadHistory( *hist, true );
+        }
 
-    map.Load( file );               // load map
+        rc = 0;
+      }
+    }
+  } else if ( version == FILE_VERSION_MONOLITHIC ) {
+    if ( !LoadHeader( file ) && !map.Load( file ) &&
+         !LoadSets( file ) && !LoadObjects( file ) ) {
+      internal_messages.ReadCatalog( file );
+      LoadHistory( file, true );
+      rc = 0;
+    }
+  } else
+    cerr << "Warning: invalid header or version" << endl;
 
-    len = file.Read16();            // load name of unit set
-    uset = file.ReadS( len );
+  return rc;
+}
 
-    File ufile( uset + ".units" );
-    if ( !ufile.OpenData("rb") || unit_set.Load( ufile, uset.c_str() ) ) {
-      cerr << "Error: Unit set '" << uset << "' not available" << endl;
-      return -1;
-    }
-    ufile.Close();
+////////////////////////////////////////////////////////////////////////
+// NAME       : Mission::LoadHeader
+// DESCRIPTION: Load general game information, players, and messages.
+// PARAMETERS : file - mission file or section
+// RETURNS    : 0 on success, non-null otherwise
+////////////////////////////////////////////////////////////////////////
 
-    len = file.Read16();            // load name of terrain set
-    tset = file.ReadS( len );
+int Mission::LoadHeader( MemBuffer &file ) {
+  flags = file.Read16();
+  turn = file.Read16();
 
-    File tfile( tset + ".tiles" );
-    if ( !tfile.OpenData("rb") || terrain_set.Load( tfile, tset.c_str() ) ) {
-      cerr << "Error: Terrain set '" << tset << "' not available" << endl;
-      return -1;
-    }
-    tfile.Close();
-
-    map.SetUnitSet( &unit_set );
-    map.SetTerrainSet( &terrain_set );
-
-    len = file.Read16();         // load shops
-    for ( i = 0; i < len; ++i ) {
-      Building *b = new Building();
-      short pid = b->Load( file );
-      b->SetOwner( pid == PLAYER_NONE ? 0 : &GetPlayer( pid ), false );
-      shops.AddTail( b );
-      map.SetBuilding( b, b->Position() );
-    }
+  name = file.Read8();
+  level_info = file.Read8();
+  campaign_name = file.Read8();
+  campaign_info = file.Read8();
+  next_map = file.Read8();
+  music = file.Read8();
+  handicap = file.Read8();
+  current_player = file.Read8();
+  turn_phase = file.Read8();
 
-    len = file.Read16();         // load units
-    for ( i = 0; i < len; ++i ) {
-      Unit *u = LoadUnit( file );
-      if ( u ) {
-        units.AddTail( u );
-        map.SetUnit( u, u->Position() );
-      }
-    }
+  p1.Load( file );
+  p2.Load( file );
 
-    len = file.Read16();             // load battles
-    for ( i = 0; i < len; ++i ) {    // only present in saved games
-      Combat *combat = new Combat();
-      combat->Load( file, *this );
-      battles.AddTail( combat );
-    }
+  messages.Load( file );
+  return 0;
+}
 
-    len = file.Read16();            // load events
-    for ( i = 0; i < len; ++i ) {
-      Event *e = new Event();
-      short pid = e->Load( file );
-      e->SetPlayer( GetPlayer( pid ) );
-      events.AddTail( e );
-    }
+////////////////////////////////////////////////////////////////////////
+// NAME       : Mission::LoadSets
+// DESCRIPTION: Load the unit and terrain sets used by the mission.
+// PARAMETERS : file - mission file or section
+// RETURNS    : 0 on success, non-null otherwise
+////////////////////////////////////////////////////////////////////////
 
-    internal_messages.ReadCatalog( file );
+int Mission::LoadSets( MemBuffer &file ) {
+  unsigned short len;
+  string uset, tset;
 
-    history = new History();
-    if ( history->Load( file, *this ) == 0 ) {
-      if ( GetPlayer(current_player^1).IsHuman() ) {
-        history->StartRecording( GetUnits() );
-      } else {
-        delete history;
-        history = 0;
-      }
+  len = file.Read16();            // load name of unit set
+  uset = file.ReadS( len );
+
+  unit_set = SetCache::GetUnitSet( uset );
+  if ( !unit_set ) {
+    cerr << "Error: Unit set '" << uset << "' not available" << endl;
+    return -1;
+  }
+  unit_types = unit_set->GetUnitTypes( CF_LANG_DEFAULT );
+
+  len = file.Read16();            // load name of terrain set
+  tset = file.ReadS( len );
+
+  terrain_set = SetCache::GetTerrainSet( tset );
+  if ( !terrain_set ) {
+    cerr << "Error: Terrain set '" << tset << "' not available" << endl;
+    return -1;
+  }
+
+  map.SetUnitSet( unit_set );
+  map.SetTerrainSet( terrain_set );
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Mission::LoadObjects
+// DESCRIPTION: Load shops, units, battles, and events. The map and
+//              the sets must have been loaded before.
+// PARAMETERS : file - mission file or section
+// RETURNS    : 0 on success, non-null otherwise
+////////////////////////////////////////////////////////////////////////
+
+int Mission::LoadObjects( MemBuffer &file ) {
+  unsigned short len, i;
+
+  len = file.Read16();         // load shops
+  for ( i = 0; i < len; ++i ) {
+    Building *b = new Building();
+    short pid = b->Load( file );
+    b->SetOwner( pid == PLAYER_NONE ? 0 : &GetPlayer( pid ), false );
+    shops.AddTail( b );
+    map.SetBuilding( b, b->Position() );
+  }
+
+  len = file.Read16();         // load units
+  for ( i = 0; i < len; ++i ) {
+    Unit *u = LoadUnit( file );
+    if ( u ) {
+      units.AddTail( u );
+      map.SetUnit( u, u->Position() );
     }
+  }
 
-    rc = 0;
-  } else
-    cerr << "Warning: invalid header or version" << endl;
+  len = file.Read16();             // load battles
+  for ( i = 0; i < len; ++i ) {    // only present in saved games
+    Combat *combat = new Combat();
+    combat->Load( file, *this );
+    battles.AddTail( combat );
+  }
 
-  return rc;
+  len = file.Read16();            // load events
+  for ( i = 0; i < len; ++i ) {
+    Event *e = new Event();
+    short pid = e->Load( file );
+    e->SetPlayer( GetPlayer( pid ) );
+    events.AddTail( e );
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Mission::LoadHistory
+// DESCRIPTION: Load the turn history and start recording a new one if
+//              required.
+// PARAMETERS : file   - mission file or section
+//              legacy - history is stored in the old format with
+//                       fixed-width fields
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Mission::LoadHistory( MemBuffer &file, bool legacy ) {
+  history = new History();
+  short num = legacy ? history->LoadLegacy( file, *this ) :
+                       history->Load( file, *this );
+  if ( num < 0 ) {
+    delete history;
+    history = 0;
+  } else if ( num == 0 ) {
+    if ( GetPlayer(current_player^1).IsHuman() ) {
+      history->StartRecording( GetUnits() );
+    } else {
+      delete history;
+      history = 0;
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -166,7 +250,7 @@ Unit *Mission::LoadUnit( MemBuffer &file, bool dummy /* = false */ ) {
   pid = file.Read8();
 
   if ( pid != PLAYER_NONE ) p = &GetPlayer( pid );
-  type = unit_set.GetUnitInfo( tid );
+  type = GetUnitInfo( tid );
 
   if ( (type->Flags() & U_TRANSPORT) && !dummy ) u = new Transport();
   else u = new Unit();
@@ -186,28 +270,20 @@ Unit *Mission::LoadUnit( MemBuffer &file, bool dummy /* = false */ ) {
 
 int Mission::QuickLoad( MemBuffer &file ) {
   int rc = -1;
+  unsigned char version = 0;
 
   // read game info
-  if ( (file.Read32() == FID_MISSION) && (file.Read8() == FILE_VERSION) ) {
-    flags = file.Read16();
-    turn = file.Read16();
-
-    name = file.Read8();
-    level_info = file.Read8();
-    campaign_name = file.Read8();
-    campaign_info = file.Read8();
-    next_map = file.Read8();
-    music = file.Read8();
-    handicap = file.Read8();
-    current_player = file.Read8();
-    turn_phase = file.Read8();
-
-    p1.Load( file );
-    p2.Load( file );
-
-    messages.Load( file );
-
-    rc = 0;
+  if ( file.Read32() == FID_MISSION ) version = file.Read8();
+
+  if ( version == FILE_VERSION ) {
+    ChunkReader chunks;
+
+    if ( !chunks.Load( file, SECT_HEADER ) ) {
+      MemBuffer *head = chunks.GetSection( SECT_HEADER );
+      if ( head ) rc = LoadHeader( *head );
+    }
+  } else if ( version == FILE_VERSION_MONOLITHIC ) {
+    rc = LoadHeader( file );
   }
 
   return rc;
@@ -221,39 +297,69 @@ int Mission::QuickLoad( MemBuffer &file ) {
 ////////////////////////////////////////////////////////////////////////
 
 int Mission::Save( MemBuffer &file ) {
-  // save game info
-  file.Write32( FID_MISSION );
-  file.Write8( FILE_VERSION );
+  ChunkWriter chunks;
+  Save( chunks );
+  return Write( file, chunks );
+}
 
-  file.Write16( flags );
-  file.Write16( turn );
-  file.Write8( name );
-  file.Write8( level_info );
-  file.Write8( campaign_name );
-  file.Write8( campaign_info );
-  file.Write8( next_map );
-  file.Write8( music );
-  file.Write8( handicap );
-  file.Write8( current_player );
-  file.Write8( turn_phase );
+////////////////////////////////////////////////////////////////////////
+// NAME       : Mission::Write
+// DESCRIPTION: Write a serialized mission to a file. This is the
+//              expensive part of saving since the sections are
+//              compressed here. It does not access the mission, so it
+//              may safely be run in another thread.
+// PARAMETERS : file   - data file
+//              chunks - mission data as produced by Mission::Save()
+// RETURNS    : 0 on successful write, non-zero otherwise
+////////////////////////////////////////////////////////////////////////
 
-  p1.Save( file );      // save player data
-  p2.Save( file );
+int Mission::Write( MemBuffer &file, const ChunkWriter &chunks ) {
+  if ( file.Write32( FID_MISSION ) || file.Write8( FILE_VERSION ) )
+    return -1;
+  return chunks.Write( file );
+}
 
-  messages.Save( file );
+////////////////////////////////////////////////////////////////////////
+// NAME       : Mission::Save
+// DESCRIPTION: Serialize the mission into memory.
+// PARAMETERS : chunks - buffer to store the mission sections in
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
 
-  map.Save( file );     // save map
+void Mission::Save( ChunkWriter &chunks ) {
+  // save game info
+  MemBuffer &head = chunks.AddSection( SECT_HEADER );
+  head.Write16( flags );
+  head.Write16( turn );
+  head.Write8( name );
+  head.Write8( level_info );
+  head.Write8( campaign_name );
+  head.Write8( campaign_info );
+  head.Write8( next_map );
+  head.Write8( music );
+  head.Write8( handicap );
+  head.Write8( current_player );
+  head.Write8( turn_phase );
+
+  p1.Save( head );      // save player data
+  p2.Save( head );
+
+  messages.Save( head );
+
+  map.Save( chunks.AddSection( SECT_MAP ) );     // save map
 
   // save mission set info
-  file.Write16( unit_set.GetName().length() );
-  file.WriteS( unit_set.GetName() );
-  file.Write16( terrain_set.GetName().length() );
-  file.WriteS( terrain_set.GetName() );
+  MemBuffer &sets = chunks.AddSection( SECT_SETS );
+  sets.Write16( unit_set->GetName().length() );
+  sets.WriteS( unit_set->GetName() );
+  sets.Write16( terrain_set->GetName().length() );
+  sets.WriteS( terrain_set->GetName() );
 
   // save shops
-  file.Write16( shops.CountNodes() );
+  MemBuffer &objs = chunks.AddSection( SECT_OBJECTS );
+  objs.Write16( shops.CountNodes() );
   for ( Building *b = static_cast<Building *>(shops.Head());
-        b; b = static_cast<Building *>(b->Next()) ) b->Save( file );
+        b; b = static_cast<Building *>(b->Next()) ) b->Save( objs );
 
   // save transports; basically, transports are not much different
   // from other units but we MUST make sure that transports having
@@ -261,35 +367,35 @@ int Mission::Save( MemBuffer &file ) {
   // make two passes through the list, first saving all unsheltered
   // units (which are possibly transports carrying other units), and
   // all sheltered units in the second run
-  file.Write16( units.CountNodes() );
+  objs.Write16( units.CountNodes() );
   const Unit *u;
   for ( u = static_cast<Unit *>(units.Head());
         u; u = static_cast<Unit *>(u->Next()) ) {  // make sure transports are
-    if ( !u->IsSheltered() ) u->Save( file );      // stored before carried units
+    if ( !u->IsSheltered() ) u->Save( objs );      // stored before carried units
   }
 
   for ( u = static_cast<Unit *>(units.Head());
         u; u = static_cast<Unit *>(u->Next()) ) {
-    if ( u->IsSheltered() ) u->Save( file );
+    if ( u->IsSheltered() ) u->Save( objs );
   }
 
   // save combat data
-  file.Write16( battles.CountNodes() );
+  objs.Write16( battles.CountNodes() );
   for ( Combat *com = static_cast<Combat *>(battles.Head());
         com; com = static_cast<Combat *>(com->Next()) )
-    com->Save( file );
+    com->Save( objs );
 
   // save events
-  file.Write16( events.CountNodes() );
+  objs.Write16( events.CountNodes() );
   for ( Event *ev = static_cast<Event *>(events.Head());
         ev; ev = static_cast<Event *>(ev->Next()) )
-    ev->Save( file );
+    ev->Save( objs );
 
-  internal_messages.WriteCatalog( file );
+  internal_messages.WriteCatalog( chunks.AddSection( SECT_TEXT ) );
 
-  if ( history ) history->Save( file );         // save turn history
-  else file.Write16( 0 );
-  return 0;
+  MemBuffer &hist = chunks.AddSection( SECT_HISTDELTA );
+  if ( history ) history->Save( hist, *this );  // save turn history
+  else hist.WriteVar( 0 );
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -307,7 +413,7 @@ int Mission::Save( MemBuffer &file ) {
 Unit *Mission::CreateUnit( unsigned char type, Player &p,
      const Point &pos, Direction dir, unsigned char group, unsigned char xp ) {
   Unit *u;
-  const UnitType *utype = unit_set.GetUnitInfo( type );
+  const UnitType *utype = GetUnitInfo( type );
 
   if ( utype->Flags() & U_TRANSPORT )
     u = new Transport( utype, &p, CreateUnitID(), pos );
@@ -421,14 +527,26 @@ void Mission::RegisterBattle( Unit *att, Unit *def ) {
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Mission::SetLocale
-// DESCRIPTION: Set the language to use.
+// DESCRIPTION: Set the language to use. The unit set is shared with
+//              other missions, so instead of changing its names we
+//              switch to its unit types for the new language.
 // PARAMETERS : lang - locale identifier
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
 
 void Mission::SetLocale( const string &lang ) {
   messages.SetDefaultLanguage( lang );
-  unit_set.SetLocale( lang );
+
+  if ( unit_set ) {
+    const UnitType *types = unit_set->GetUnitTypes( lang );
+    if ( types != unit_types ) {
+      for ( Unit *u = static_cast<Unit *>(units.Head());
+            u; u = static_cast<Unit *>(u->Next()) )
+        u->SetType( &types[u->Type()->ID()] );
+      if ( history ) history->SetUnitTypes( types );
+      unit_types = types;
+    }
+  }
 
   p1.SetName( messages.GetMsg(p1.NameID()) );
   p2.SetName( messages.GetMsg(p2.NameID()) );
@@ -29,20 +29,25 @@
 #include "player.h"
 #include "history.h"
 #include "lang.h"
+#include "chunkfile.h"
 
 class Mission {
 public:
-  Mission( void ) { history = 0; }
+  Mission( void ) : unit_set(0), unit_types(0), terrain_set(0), history(0) {}
   ~Mission( void );
 
   int Load( MemBuffer &file );
   Unit *LoadUnit( MemBuffer &file, bool dummy = false );
   int QuickLoad( MemBuffer &file );
   int Save( MemBuffer &file );
+  void Save( ChunkWriter &chunks );
+  static int Write( MemBuffer &file, const ChunkWriter &chunks );
 
   Map &GetMap( void ) { return map; }
-  TerrainSet &GetTerrainSet( void ) { return terrain_set; }
-  UnitSet &GetUnitSet( void ) { return unit_set; }
+  TerrainSet &GetTerrainSet( void ) { return *terrain_set; }
+  UnitSet &GetUnitSet( void ) { return *unit_set; }
+  const UnitType *GetUnitInfo( unsigned short utid ) const
+        { return (utid < unit_set->NumTiles()) ? &unit_types[utid] : NULL; }
 
   const char *GetSequel( void ) const { return GetInternalMessage(next_map); }
   const char *GetInfoMsg( void ) const { return GetMessage(level_info); }
@@ -89,6 +94,11 @@ public:
   void SetHandicap( unsigned char hcap ) { handicap = hcap; }
 
 private:
+  int LoadHeader( MemBuffer &file );
+  int LoadSets( MemBuffer &file );
+  int LoadObjects( MemBuffer &file );
+  void LoadHistory( MemBuffer &file, bool legacy );
+
   const char *GetInternalMessage( short id ) const;
   unsigned short CreateUnitID( void ) const;
 
@@ -115,8 +125,9 @@ private:
   Player p1;
   Player p2;
 
-  UnitSet unit_set;
-  TerrainSet terrain_set;
+  UnitSet *unit_set;         // shared sets from the SetCache
+  const UnitType *unit_types; // unit_set types in the mission language
+  TerrainSet *terrain_set;
   History *history;
 
   template <typename T>  // get a specific object from a list
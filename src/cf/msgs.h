@@ -111,6 +111,7 @@ enum {
   MSG_CHOOSE_PASSWORD,
   MSG_CONFIRM_PASSWORD,
   MSG_NET_WAITING,
+  MSG_NET_WAITING_LATENCY,
   MSG_NET_WAITING_CLIENT,
   MSG_NET_CONNECTING,
   MSG_NET_CONFIG_SERVER,
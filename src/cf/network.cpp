@@ -21,177 +21,36 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include <stdio.h>
+#include <string.h>
 
 #include "network.h"
 
 #ifndef DISABLE_NETWORK
 
 #include "misc.h"
+#include "codec.h"
 
-#define DEFAULT_CAPACITY  512
+// while waiting for data we must still look after the user interface
+// every once in a while; incoming data wakes us up immediately
+#define NET_WAIT_SLICE    100
+#define NET_WAIT_FOREVER  0xffffffff
 
-////////////////////////////////////////////////////////////////////////
-// NAME       : DynBuffer::DynBuffer
-// DESCRIPTION: Create a new dynamic buffer with the default capacity in
-//              memory. When using the Write*() methods defined for this
-//              class, the buffer will grow dynamically as required.
-// PARAMETERS : -
-// RETURNS    : -
-////////////////////////////////////////////////////////////////////////
-
-DynBuffer::DynBuffer( void ) : mem(0), size(0), capacity(0), pos(0) {
-  Init( DEFAULT_CAPACITY);
-}
-
-////////////////////////////////////////////////////////////////////////
-// NAME       : DynBuffer::DynBuffer
-// DESCRIPTION: Create a new buffer in memory.
-// PARAMETERS : capacity - desired initial buffer size
-// RETURNS    : -
-////////////////////////////////////////////////////////////////////////
-
-DynBuffer::DynBuffer( unsigned long capacity ) : mem(0), size(0), capacity(0), pos(0) {
-  Init( capacity );
-}
+// smaller payloads are never compressed
+#define NET_COMPRESS_MIN  256
 
 ////////////////////////////////////////////////////////////////////////
-// NAME       : DynBuffer::~DynBuffer
-// DESCRIPTION: Free the buffer.
+// NAME       : TCPConnection::TCPConnection
+// DESCRIPTION: Create a new connection object.
 // PARAMETERS : -
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
 
-DynBuffer::~DynBuffer( void ) {
-  if (mem) free( mem );
-}
-
-////////////////////////////////////////////////////////////////////////
-// NAME       : DynBuffer::Init
-// DESCRIPTION: Initialize a new buffer in memory.
-// PARAMETERS : len - desired initial buffer size
-// RETURNS    : 0 on success, -1 on error
-////////////////////////////////////////////////////////////////////////
-
-int DynBuffer::Init( unsigned long len ) {
-  mem = (char *)malloc( len );
-
-  if (mem) {
-    capacity = len;
-    return 0;
-  }
-
-  return -1;
-}
-
-////////////////////////////////////////////////////////////////////////
-// NAME       : DynBuffer::CheckResize
-// DESCRIPTION: Check whether a given amount of data fits into the
-//              currently allocated buffer. If it doesn't, resize the
-//              buffer.
-// PARAMETERS : len - total amount of data that the buffer must be able
-//                    to hold
-// RETURNS    : 0 on success, -1 on error
-////////////////////////////////////////////////////////////////////////
-
-int DynBuffer::CheckResize( unsigned long len ) {
-  int rc = 0;
-
-  if (len > capacity)  {
-    unsigned long new_capacity = MAX( len, capacity * 2 );
-
-    mem = (char *)realloc( mem, new_capacity );
-
-    if (mem)
-      capacity = new_capacity;
-    else
-      rc = -1;
-  }
-
-  return rc;
-}
-
-////////////////////////////////////////////////////////////////////////
-// NAME       : DynBuffer::SetSize
-// DESCRIPTION: Set buffer to a given size. Current position inside the
-//              buffer is not modified, unless the buffer size is
-//              reduced and the position is outside the valid buffer
-//              after the resize. In that case, position is moved to the
-//              end of the buffer.
-// PARAMETERS : size - size to set
-// RETURNS    : 0 on success, -1 on error
-////////////////////////////////////////////////////////////////////////
-
-int DynBuffer::SetSize( unsigned long size ) {
-  int rc;
-
-  if (size > capacity) {
-    rc = CheckResize( size );
-  } else {
-    // buffer reduction will always succeed
-    rc = 0;
-    pos = MIN( size, pos );
-  }
-
-  this->size = size;
-  return rc;
-}
-
-////////////////////////////////////////////////////////////////////////
-// NAME       : DynBuffer::Read
-// DESCRIPTION: Read a number of bytes from the buffer.
-// PARAMETERS : buffer - buffer to read into
-//              size   - amount of data to read
-// RETURNS    : 0 on success, -1 on error
-////////////////////////////////////////////////////////////////////////
-
-int DynBuffer::Read( void *buffer, int size ) {
-  if (pos + size > this->size)
-    return -1;
-
-  memcpy( buffer, &mem[pos], size );
-  pos += size;
-
-  return 0;
+TCPConnection::TCPConnection( void ) : socket(0), client(0), set(0),
+               server(false), codec(CODEC_LZ), send_time(0), recv_time(0),
+               sent(false), received(false) {
+  ResetLatency();
 }
 
-////////////////////////////////////////////////////////////////////////
-// NAME       : DynBuffer::Write
-// DESCRIPTION: Write a number of bytes to the buffer.
-// PARAMETERS : buffer - buffer to read from
-//              size   - amount of data to write
-// RETURNS    : 0 on success, -1 on error
-////////////////////////////////////////////////////////////////////////
-
-int DynBuffer::Write( const void *buffer, int size ) {
-  if (CheckResize( pos + size ) != 0) {
-    return -1;
-  }
-
-  memcpy( &mem[pos], buffer, size );
-  pos += size;
-  this->size += size;
-
-  return 0;
-}
-
-#define CF_PACKET_ID      0xcfcfcfcf
-#define CF_PACKET_VERSION 0
-
-enum {
-  CF_PACKET_TYPE_DATA,
-  CF_PACKET_TYPE_ACK    // might be used for unreliable protocols
-};
-
-extern "C" {
-  struct TCPPacketHeader {
-    Uint32 id;
-    Uint8 version;
-    Uint8 type;
-    Uint16 reserved;
-    Uint32 size;
-  };
-};
-
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TCPConnection::Open
 // DESCRIPTION: Open the connection.
@@ -236,19 +95,20 @@ int TCPConnection::Open( const char *ipaddr, Uint16 port, UserActionHook *hook )
   }
 
   if ( server ) {
-    // wait for a client
+    // wait for a client; a listening socket becomes ready when a
+    // connection request comes in
+    SDLNet_TCP_AddSocket( set, socket );
     while ( !client ) {
-      client = SDLNet_TCP_Accept( socket );
-
-      if ( !client ) {
-        if ( hook && hook->Cancelled() )
-          return 1;
-
-        SDL_Delay( 200 );
-      } else {
-        SDLNet_TCP_AddSocket( set, client );
+      int ready = Wait( socket, hook );
+      if ( ready <= 0 ) {
+        SDLNet_TCP_DelSocket( set, socket );
+        return (ready == 0) ? 1 : -1;
       }
+
+      client = SDLNet_TCP_Accept( socket );
     }
+    SDLNet_TCP_DelSocket( set, socket );
+    SDLNet_TCP_AddSocket( set, client );
   } else {
     SDLNet_TCP_AddSocket( set, socket );
   }
@@ -264,6 +124,9 @@ int TCPConnection::Open( const char *ipaddr, Uint16 port, UserActionHook *hook )
 ////////////////////////////////////////////////////////////////////////
 
 void TCPConnection::Close( void ) {
+  ResetLatency();
+  sent = received = false;
+
   if (client) {
     SDLNet_TCP_Close( client );
     client = NULL;
@@ -278,10 +141,33 @@ void TCPConnection::Close( void ) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : TCPConnection::GetSendBuffer
+// DESCRIPTION: Get an empty buffer for the next packet. The buffer
+//              reserves room for the packet header so it can be sent
+//              without copying the payload. It remains valid until the
+//              next call to this method.
+// PARAMETERS : -
+// RETURNS    : buffer to write the payload to
+////////////////////////////////////////////////////////////////////////
+
+DynBuffer &TCPConnection::GetSendBuffer( void ) {
+  struct TCPPacketHeader hdr;
+  memset( &hdr, 0, CF_PACKET_HEADER );
+
+  sendbuf.Clear();
+  sendbuf.Write( &hdr, CF_PACKET_HEADER );
+  return sendbuf;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TCPConnection::Send
-// DESCRIPTION: Send a buffer over the network.
-// PARAMETERS : buf - buffer to send
+// DESCRIPTION: Send a buffer over the network. Header and payload are
+//              transmitted with a single call so that the packet is
+//              not split up by the Nagle algorithm. If possible the
+//              payload is compressed.
+// PARAMETERS : buf - buffer to send; if this is the buffer obtained
+//                    from GetSendBuffer() the payload is not copied
 // RETURNS    : TRUE if buffer was sent successfully, FALSE on error
 ////////////////////////////////////////////////////////////////////////
 
@@ -292,24 +178,61 @@ bool TCPConnection::Send( DynBuffer &buf ) {
   dest = (server ? client : socket);
 
   if (dest) {
-    int len;
     struct TCPPacketHeader hdr;
+    Uint32 now = SDL_GetTicks();
+    DynBuffer *frame = NULL;
+    const char *payload = buf.GetData();
+    unsigned long len = buf.Size();
+
+    if ( &buf == &sendbuf ) {
+      frame = &sendbuf;
+      payload += CF_PACKET_HEADER;
+      len -= CF_PACKET_HEADER;
+    }
+
+    hdr.codec = CODEC_STORE;
+
+    const Codec *c = Codec::Get( codec );
+    if ( c && (codec != CODEC_STORE) && (len >= NET_COMPRESS_MIN) ) {
+      unsigned long enclen = c->Bound( len );
+
+      if ( (packbuf.SetSize( CF_PACKET_HEADER + 4 + enclen ) == 0) &&
+           (c->Encode( (const unsigned char *)payload, len,
+              (unsigned char *)packbuf.GetData() + CF_PACKET_HEADER + 4,
+              enclen ) == 0) &&
+           (enclen + 4 < len) ) {
+        Uint32 rawlen = SDL_SwapLE32(len);
+        memcpy( packbuf.GetData() + CF_PACKET_HEADER, &rawlen, 4 );
+        packbuf.SetSize( CF_PACKET_HEADER + 4 + enclen );
+        frame = &packbuf;
+        hdr.codec = codec;
+      }
+    }
+
+    if ( !frame ) {
+      // the caller didn't leave room for the header
+      if ( sendbuf.SetSize( CF_PACKET_HEADER + len ) != 0 ) return false;
+      memcpy( sendbuf.GetData() + CF_PACKET_HEADER, payload, len );
+      frame = &sendbuf;
+    }
 
     hdr.id = SDL_SwapLE32(CF_PACKET_ID);
     hdr.version = CF_PACKET_VERSION;
     hdr.type = CF_PACKET_TYPE_DATA;
     hdr.reserved = 0;
-    hdr.size = SDL_SwapLE32(buf.Size());
-
-    len = SDLNet_TCP_Send( dest, &hdr, sizeof(struct TCPPacketHeader) );
-    if ( len != sizeof(struct TCPPacketHeader) ) {
-      fprintf( stderr, "SDLNet_Send (header): %s\n", SDLNet_GetError() );
-    } else {
-      len = SDLNet_TCP_Send( dest, buf.GetData(), buf.Size() );
-      rc = ((unsigned long)len == buf.Size());
-
-      if (!rc)
-        fprintf( stderr, "SDLNet_Send (data): %s\n", SDLNet_GetError() );
+    hdr.size = SDL_SwapLE32(frame->Size() - CF_PACKET_HEADER);
+    hdr.hold = SDL_SwapLE32(received ? now - recv_time : CF_PACKET_NO_HOLD);
+    memcpy( frame->GetData(), &hdr, CF_PACKET_HEADER );
+
+    int sent_len = SDLNet_TCP_Send( dest, frame->GetData(), frame->Size() );
+    rc = ((unsigned long)sent_len == frame->Size());
+
+    if (!rc)
+      fprintf( stderr, "SDLNet_Send: %s\n", SDLNet_GetError() );
+    else {
+      send_time = now;
+      sent = true;
+      received = false;
     }
   }
 
@@ -318,8 +241,9 @@ bool TCPConnection::Send( DynBuffer &buf ) {
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TCPConnection::Receive
-// DESCRIPTION: Receive a buffer over the network. If a buffer is
-//              returned, it must be freed by the caller after use.
+// DESCRIPTION: Receive a buffer over the network. The buffer belongs
+//              to the connection and is reused for the next packet, so
+//              it must not be freed by the caller.
 // PARAMETERS : hook - UserActionHook which can be used to abort this
 //                     otherwise synchronous operation
 // RETURNS    : received buffer or NULL on error or user abort
@@ -334,11 +258,12 @@ DynBuffer *TCPConnection::Receive( UserActionHook *hook ) {
   if ( src ) {
     struct TCPPacketHeader hdr;
 
-    if ( !Read( src, (char *)&hdr, sizeof(struct TCPPacketHeader), hook ) )
+    if ( !Read( src, (char *)&hdr, CF_PACKET_HEADER, hook ) )
       return NULL;
 
     hdr.id = SDL_SwapLE32(hdr.id);
     hdr.size = SDL_SwapLE32(hdr.size);
+    hdr.hold = SDL_SwapLE32(hdr.hold);
 
     if (hdr.id != CF_PACKET_ID)  {
       fprintf( stderr, "TCP_Receive: Received unknown ID %d\n", hdr.id );
@@ -349,20 +274,99 @@ DynBuffer *TCPConnection::Receive( UserActionHook *hook ) {
     } else if (hdr.type != CF_PACKET_TYPE_DATA)  {
       fprintf( stderr, "TCP_Receive: Received packet of type %d\n", hdr.type );
       return NULL;
+    } else if (hdr.size > CF_PACKET_MAX_SIZE)  {
+      fprintf( stderr, "TCP_Receive: Received packet of size %d\n", hdr.size );
+      return NULL;
     }
 
-    buf = new DynBuffer( hdr.size );
-    buf->SetSize( hdr.size );
-
-    if ( !Read( src, buf->GetData(), hdr.size, hook ) ) {
-      delete buf;
+    recvbuf.Clear();
+    if ( (recvbuf.SetSize( hdr.size ) != 0) ||
+         !Read( src, recvbuf.GetData(), hdr.size, hook ) )
       return NULL;
+
+    if ( hdr.codec == CODEC_STORE ) buf = &recvbuf;
+    else {
+      const Codec *c = Codec::Get( hdr.codec );
+      if ( !c || (hdr.size < 4) ) {
+        fprintf( stderr, "TCP_Receive: Received packet with unsupported codec %d\n", hdr.codec );
+        return NULL;
+      }
+
+      // don't trust the decoded size before allocating memory for it
+      unsigned long rawlen = recvbuf.Read32();
+      unpackbuf.Clear();
+      if ( (rawlen > CF_PACKET_MAX_SIZE) ||
+           (rawlen / c->MaxRatio() > hdr.size - 4) ||
+           (unpackbuf.SetSize( rawlen ) != 0) ||
+           (c->Decode( (const unsigned char *)recvbuf.GetData() + 4, hdr.size - 4,
+                       (unsigned char *)unpackbuf.GetData(), rawlen ) != 0) ) {
+        fprintf( stderr, "TCP_Receive: Could not decode packet\n" );
+        return NULL;
+      }
+      buf = &unpackbuf;
     }
+
+    recv_time = SDL_GetTicks();
+    received = true;
+
+    if ( sent && (hdr.hold != CF_PACKET_NO_HOLD) ) {
+      Uint32 elapsed = recv_time - send_time;
+      unsigned long lat = (elapsed > hdr.hold) ? elapsed - hdr.hold : 0;
+
+      if ( (latency.count == 0) || (lat < latency.min) ) latency.min = lat;
+      if ( lat > latency.max ) latency.max = lat;
+      latency.last = lat;
+      latency.total += lat;
+      ++latency.count;
+    }
+    sent = false;
   }
 
   return buf;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : TCPConnection::ResetLatency
+// DESCRIPTION: Clear the turn handoff latency statistics.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void TCPConnection::ResetLatency( void ) {
+  latency.count = latency.total = 0;
+  latency.min = latency.max = latency.last = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : TCPConnection::Wait
+// DESCRIPTION: Wait until a socket becomes ready for reading. Instead
+//              of polling we sleep in SDLNet_CheckSockets() so that we
+//              wake up as soon as data arrives. If a hook is given the
+//              wait is interrupted every NET_WAIT_SLICE milliseconds to
+//              give the user a chance to abort.
+// PARAMETERS : socket - socket to wait for; it must be part of the set
+//              hook   - UserActionHook which can be used to abort the
+//                       operation (may be NULL)
+// RETURNS    : 1 if the socket is ready, 0 if the user aborted, -1 on
+//              error
+////////////////////////////////////////////////////////////////////////
+
+int TCPConnection::Wait( TCPsocket socket, UserActionHook *hook ) const {
+  Uint32 timeout = (hook ? NET_WAIT_SLICE : NET_WAIT_FOREVER);
+
+  while ( true ) {
+    int ready = SDLNet_CheckSockets( set, timeout );
+    if ( ready < 0 ) {
+      fprintf( stderr, "SDLNet_CheckSockets: %s\n", SDLNet_GetError() );
+      return -1;
+    }
+
+    if ( (ready > 0) && SDLNet_SocketReady( socket ) ) return 1;
+
+    if ( hook && hook->Cancelled() ) return 0;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TCPConnection::Read
 // DESCRIPTION: Receive a buffer of <size> bytes over the network. This
@@ -383,29 +387,19 @@ bool TCPConnection::Read( TCPsocket socket, char *buf, Uint32 size,
   unsigned int read = 0;
 
   do  {
-    // we don't want SDLNet_TCP_Recv to block, so we check in advance
-    // whether there is any data waiting for us
-    int ready = SDLNet_CheckSockets( set, 0 );
-    if ( ready < 0 ) {
-      return false;
-
-    } else if ( ready == 0 ) {
-      if ( hook && hook->Cancelled() )
-        return false;
-      SDL_Delay( 200 );
+    // we don't want SDLNet_TCP_Recv to block, so we wait until there
+    // is any data waiting for us
+    if ( Wait( socket, hook ) <= 0 ) return false;
 
-    } else {
-      // data available
-      len = SDLNet_TCP_Recv( socket, buf + read, size - read );
+    len = SDLNet_TCP_Recv( socket, buf + read, size - read );
 
-      if ( len <= 0 ) {
-        fprintf( stderr, "SDLNet_TCP_Recv: %s\n", SDLNet_GetError() );
-        return false;
-      }
-
-      read += len;
+    if ( len <= 0 ) {
+      fprintf( stderr, "SDLNet_TCP_Recv: %s\n", SDLNet_GetError() );
+      return false;
     }
 
+    read += len;
+
   } while (read < size);
 
   return true;
@@ -29,53 +29,78 @@
 #include "fileio.h"
 #include "widget.h"  // for UserActionHook
 
-class DynBuffer : public MemBuffer {
-public:
-  DynBuffer( void );
-  DynBuffer( unsigned long capacity );
-  ~DynBuffer( void );
+#define CF_PACKET_ID      0xcfcfcfcf
+#define CF_PACKET_VERSION 4
 
-  unsigned long Size( void ) const { return size; }
-  int SetSize( unsigned long size );
+#define CF_PACKET_NO_HOLD 0xffffffff  // packet is not an answer
 
-  int Read( void *buffer, int size );
-  unsigned char Read8( void ) { return mem[pos++]; }
-  unsigned short Read16( void )
-    { unsigned short v = SDL_SwapLE16( *((Uint16 *)&mem[pos]) ); pos += 2; return v; }
-  unsigned long Read32( void )
-    { unsigned long v = SDL_SwapLE32( *((Uint32 *)&mem[pos]) ); pos += 4; return v; }
+// largest payload accepted, both encoded and decoded; anything bigger
+// is considered malformed
+#define CF_PACKET_MAX_SIZE  (16 * 1024 * 1024)
 
-  int Write( const void *values, int size );
-  int Write8( unsigned char value ) { return Write( &value, 1 ); }
-  int Write16( unsigned short value )
-    { value = SDL_SwapLE16( value ); return Write( &value, 2 ); }
-  int Write32( unsigned long value )
-    { value = SDL_SwapLE32( value ); return Write( &value, 4 ); }
+// player ID sent instead of a side in the initial packet if the
+// peer only watches the game (see tools/cfrelay.cpp)
+#define CF_NET_SPECTATOR  0xff
 
-  char *GetData( void ) const { return mem; }
+enum {
+  CF_PACKET_TYPE_DATA,
+  CF_PACKET_TYPE_ACK    // might be used for unreliable protocols
+};
 
-private:
-  int Init( unsigned long len );
-  int CheckResize( unsigned long len );
+extern "C" {
+  struct TCPPacketHeader {
+    Uint32 id;
+    Uint8 version;
+    Uint8 type;
+    Uint8 codec;      // payload compression method; the payload
+                      // is prefixed with its decoded size if set
+    Uint8 reserved;
+    Uint32 size;
+    Uint32 hold;      // ms between the last packet received by the
+                      // sender and this one
+  };
+};
 
-  char *mem;
-  unsigned long size;
-  unsigned long capacity;
-  unsigned long pos;
+#define CF_PACKET_HEADER  sizeof(struct TCPPacketHeader)
+
+// turn handoff latency, i.e. the time it takes for a packet to
+// travel to the peer and for the answer to come back, minus the time
+// the peer spent before answering (usually playing its turn)
+struct NetLatency {
+  unsigned long count;    // number of measured handoffs
+  unsigned long total;    // sum of all measurements (ms)
+  unsigned long min;
+  unsigned long max;
+  unsigned long last;
 };
 
+// Packets are sent as frames consisting of a header and the payload.
+// The complete frame is handed to the network stack in a single call.
+// To avoid copying the payload, use the buffer returned by
+// GetSendBuffer(), which already reserves room for the header.
+// Received payloads are stored in buffers owned by the connection and
+// reused for subsequent packets.
 class TCPConnection {
 public:
-  TCPConnection( void ) : socket(0), client(0), set(0) {}
+  TCPConnection( void );
   ~TCPConnection( void ) { Close(); }
 
   int Open( const char *ipaddr, Uint16 port, UserActionHook *hook );
   void Close( void );
 
+  bool Connected( void ) const { return (server ? client : socket) != NULL; }
+
+  DynBuffer &GetSendBuffer( void );
   bool Send( DynBuffer &buf );
   DynBuffer *Receive( UserActionHook *hook );
 
+  void SetCodec( unsigned char codec ) { this->codec = codec; }
+
+  const NetLatency &GetLatency( void ) const { return latency; }
+  void ResetLatency( void );
+
 private:
+  int Wait( TCPsocket socket, UserActionHook *hook ) const;
   bool Read( TCPsocket socket, char *buf, Uint32 size,
              UserActionHook *hook );
 
@@ -83,6 +108,18 @@ private:
   TCPsocket client;
   SDLNet_SocketSet set;
   bool server;
+
+  DynBuffer sendbuf;      // outgoing frame
+  DynBuffer packbuf;      // outgoing frame with compressed payload
+  DynBuffer recvbuf;      // incoming payload
+  DynBuffer unpackbuf;    // decompressed incoming payload
+  unsigned char codec;    // payload compression
+
+  Uint32 send_time;       // time the last packet was sent
+  Uint32 recv_time;       // time the last packet was received
+  bool sent;
+  bool received;
+  NetLatency latency;
 };
 
 #endif /* DISABLE_NETWORK */
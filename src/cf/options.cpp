@@ -78,3 +78,58 @@ const char *Options::GetRemoteName( void ) const {
     return NULL;
  return server.c_str();
 }
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Options::SetProfileLog
+// DESCRIPTION: Set the file to write computer player profiling data to.
+// PARAMETERS : log - file name ("-" for standard error) or NULL to
+//                    disable profiling
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Options::SetProfileLog( const char *log ) {
+  if ( log )
+    profile_log.assign( log );
+  else
+    profile_log.erase();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Options::GetProfileLog
+// DESCRIPTION: Get the name of the profile log file.
+// PARAMETERS : -
+// RETURNS    : file name or NULL if profiling is disabled
+////////////////////////////////////////////////////////////////////////
+
+const char *Options::GetProfileLog( void ) const {
+  if ( profile_log.empty() )
+    return NULL;
+  return profile_log.c_str();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Options::SetRecordFile
+// DESCRIPTION: Set the file to record games to.
+// PARAMETERS : file - file name or NULL to disable recording
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Options::SetRecordFile( const char *file ) {
+  if ( file )
+    record_file.assign( file );
+  else
+    record_file.erase();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Options::GetRecordFile
+// DESCRIPTION: Get the name of the recording file.
+// PARAMETERS : -
+// RETURNS    : file name or NULL if recording is disabled
+////////////////////////////////////////////////////////////////////////
+
+const char *Options::GetRecordFile( void ) const {
+  if ( record_file.empty() )
+    return NULL;
+  return record_file.c_str();
+}
@@ -98,6 +98,11 @@ public:
   void SetLocalPort( unsigned short port ) { local_port = port; }
   unsigned short GetLocalPort( void ) const { return local_port; }
 
+  void SetProfileLog( const char *log );
+  const char *GetProfileLog( void ) const;
+  void SetRecordFile( const char *file );
+  const char *GetRecordFile( void ) const;
+
   bool IsLocked( const string &map ) const
     { return find(unlocked_maps.begin(), unlocked_maps.end(), map)
              == unlocked_maps.end(); }
@@ -122,6 +127,9 @@ private:
   unsigned short server_port; // connecting as client
   unsigned short local_port;  // acting as server
 
+  string profile_log; // computer player profile log; empty if disabled
+  string record_file; // game recording; empty if disabled
+
   vector<string> unlocked_maps;
   SDLKey keymap[KEYBIND_COUNT];
 };
@@ -25,6 +25,7 @@
 using namespace std;
 
 #include "path.h"
+#include "profile.h"
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : BasicPath::BasicPath
@@ -129,6 +130,7 @@ short BasicPath::Find( const Unit *u, const Point &start, const Point &end ) {
     pnode = openlist.front();
     pop_heap( openlist.begin(), openlist.end(), comp );
     openlist.pop_back();
+    ++PStats.nodes;
 
     // check for destination
     if ( StopSearch( pnode ) ) break;
@@ -199,6 +201,7 @@ short BasicPath::Find( const Unit *u, const Point &start, const Point &end ) {
 
 short Path::Find( const Unit *u, const Point &start, const Point &end,
                   unsigned char qual, unsigned char off ) {
+  ++PStats.path_searches;
   quality = qual;
   deviation = off;
   return BasicPath::Find( u, start, end );
@@ -477,6 +480,29 @@ TransPath::TransPath( Map *map, const Transport *trans, signed char *buffer ) :
   t = trans;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : TransPath::Find
+// DESCRIPTION: Search a path on the map. See Path::Find() for details.
+//              This is only a separate method so that transport
+//              searches can be told apart from normal searches when
+//              profiling.
+// PARAMETERS : u     - unit to search a path for
+//              start - hex to start from (transport position)
+//              end   - destination hex
+//              qual  - path quality/speed trade-off
+//              off   - maximum distance to the destination
+// RETURNS    : approximate number of turns to reach the destination
+//              hex, or -1 if no valid path was found
+////////////////////////////////////////////////////////////////////////
+
+short TransPath::Find( const Unit *u, const Point &start, const Point &end,
+                       unsigned char qual, unsigned char off ) {
+  ++PStats.trans_searches;
+  quality = qual;
+  deviation = off;
+  return BasicPath::Find( u, start, end );
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TransPath::AddNode
 // DESCRIPTION: Calculate the cost for the unit to move from one hex to
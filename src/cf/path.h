@@ -123,6 +123,11 @@ protected:
 class TransPath : public Path {
 public:
   TransPath( Map *map, const Transport *trans, signed char *buffer = NULL );
+
+  short Find( const Unit *u,
+              const Point &start, const Point &end,
+              unsigned char qual = PATH_BEST,
+              unsigned char off = 0 );
   void Reverse( void );
 
 protected:
@@ -35,6 +35,8 @@ struct GUIOptions {
   unsigned char music_vol;
   unsigned long sdl_flags;
   const char *level;
+  const char *replay;          // game recording to play back
+  unsigned short replay_turn;  // turn to start playback at
 };
 
 // init environment
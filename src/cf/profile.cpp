@@ -0,0 +1,235 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// profile.cpp -- computer player instrumentation
+//
+// When enabled via the --profile command line option or the
+// CRIMSON_AI_PROFILE environment variable, the profiler writes one line
+// per computer player turn to the log. Each line is a JSON object
+// containing wall clock times (in microseconds) for the individual
+// phases of AI::Play() as well as pathfinding statistics, e.g.
+//
+// {"turn":3,"player":2,"units":14,"total":81234,"phases":{...},
+//  "calls":{...},"path_find":211,"transpath_find":12,
+//  "nodes":48211,"move_cost":263511}
+//
+// Phase times are exclusive, i.e. when a transport commands its cargo
+// the time spent on the cargo is not attributed to the transport.
+////////////////////////////////////////////////////////////////////////
+
+#ifdef WIN32
+# include <windows.h>
+#else
+# include <sys/time.h>
+#endif
+
+#include <fstream>
+#include <string.h>
+
+#include "profile.h"
+#include "options.h"
+
+extern Options CFOptions;
+
+PathStats PStats = { 0, 0, 0, 0 };
+
+static AIProfiler profiler;
+
+static const char *phase_names[AIProfiler::PHASE_COUNT] = {
+  "identify", "assign", "select", "repair", "defend",
+  "conquer", "attack", "transport", "build"
+};
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AIProfiler::Get
+// DESCRIPTION: Get the profiler. The log is opened on first access.
+// PARAMETERS : -
+// RETURNS    : profiler or NULL if profiling is disabled (or the log
+//              could not be opened)
+////////////////////////////////////////////////////////////////////////
+
+AIProfiler *AIProfiler::Get( void ) {
+  const char *log = CFOptions.GetProfileLog();
+
+  if ( !log ) return NULL;
+  if ( !profiler.out && !profiler.Open( log ) ) {
+    // don't try again
+    CFOptions.SetProfileLog( NULL );
+    return NULL;
+  }
+  return &profiler;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AIProfiler::Ticks
+// DESCRIPTION: Get a high resolution time stamp. The value wraps
+//              around so only use it for computing differences.
+// PARAMETERS : -
+// RETURNS    : time in microseconds
+////////////////////////////////////////////////////////////////////////
+
+unsigned long AIProfiler::Ticks( void ) {
+#ifdef WIN32
+  LARGE_INTEGER freq, now;
+  if ( QueryPerformanceFrequency( &freq ) && QueryPerformanceCounter( &now ) )
+    return (unsigned long)(now.QuadPart * 1000000 / freq.QuadPart);
+  return GetTickCount() * 1000;
+#else
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AIProfiler::Open
+// DESCRIPTION: Open the profile log.
+// PARAMETERS : log - file name; "-" writes to standard error. Data is
+//                    appended to existing files.
+// RETURNS    : TRUE on success, FALSE on error
+////////////////////////////////////////////////////////////////////////
+
+bool AIProfiler::Open( const char *log ) {
+  Close();
+
+  if ( !strcmp( log, "-" ) ) {
+    out = &cerr;
+    own = false;
+  } else {
+    ofstream *file = new ofstream( log, ios::out|ios::app );
+    if ( !file->is_open() ) {
+      cerr << "Warning: Couldn't open profile log " << log << endl;
+      delete file;
+      return false;
+    }
+    out = file;
+    own = true;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AIProfiler::Close
+// DESCRIPTION: Close the profile log.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void AIProfiler::Close( void ) {
+  if ( own ) delete out;
+  out = 0;
+  own = false;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AIProfiler::StartTurn
+// DESCRIPTION: Reset all counters for a new computer player turn.
+// PARAMETERS : turn   - current turn
+//              player - player ID
+//              units  - number of units controlled by the player
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void AIProfiler::StartTurn( unsigned short turn, unsigned char player,
+                            unsigned short units ) {
+  this->turn = turn;
+  this->player = player;
+  this->units = units;
+
+  for ( int i = 0; i < PHASE_COUNT; ++i ) {
+    time[i] = 0;
+    calls[i] = 0;
+  }
+  stats = PStats;
+  depth = 0;
+  turn_start = Ticks();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AIProfiler::EndTurn
+// DESCRIPTION: Write the data collected for the current turn to the
+//              log.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void AIProfiler::EndTurn( void ) {
+  unsigned long total = Ticks() - turn_start;
+  int i;
+
+  *out << "{\"turn\":" << turn
+       << ",\"player\":" << player + 1
+       << ",\"units\":" << units
+       << ",\"total\":" << total
+       << ",\"phases\":{";
+  for ( i = 0; i < PHASE_COUNT; ++i ) {
+    if ( i > 0 ) *out << ',';
+    *out << '"' << phase_names[i] << "\":" << time[i];
+  }
+  *out << "},\"calls\":{";
+  for ( i = 0; i < PHASE_COUNT; ++i ) {
+    if ( i > 0 ) *out << ',';
+    *out << '"' << phase_names[i] << "\":" << calls[i];
+  }
+  *out << "},\"path_find\":" << PStats.path_searches - stats.path_searches
+       << ",\"transpath_find\":" << PStats.trans_searches - stats.trans_searches
+       << ",\"nodes\":" << PStats.nodes - stats.nodes
+       << ",\"move_cost\":" << PStats.move_cost - stats.move_cost
+       << '}' << endl;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AIProfiler::Enter
+// DESCRIPTION: Start timing a phase. If another phase is currently
+//              active it is suspended until the new one is left.
+// PARAMETERS : phase - phase to enter
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void AIProfiler::Enter( Phase phase ) {
+  unsigned long now = Ticks();
+
+  if ( (depth > 0) && (depth <= PROFILE_MAX_DEPTH) )
+    time[stack[depth-1]] += now - phase_start;
+
+  if ( depth < PROFILE_MAX_DEPTH ) stack[depth] = phase;
+  ++depth;
+  ++calls[phase];
+  phase_start = now;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : AIProfiler::Leave
+// DESCRIPTION: Stop timing the current phase and resume the previous
+//              one, if any.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void AIProfiler::Leave( void ) {
+  unsigned long now = Ticks();
+
+  if ( depth > 0 ) {
+    --depth;
+    if ( depth < PROFILE_MAX_DEPTH )
+      time[stack[depth]] += now - phase_start;
+  }
+  phase_start = now;
+}
+
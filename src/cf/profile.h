@@ -0,0 +1,105 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+/////////////////////////////////////////////////////////////////////////
+// profile.h - computer player instrumentation
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef _INCLUDE_PROFILE_H
+#define _INCLUDE_PROFILE_H
+
+#include <iostream>
+using namespace std;
+
+// pathfinding statistics; the counters are cheap enough to be
+// maintained all the time, but they are only evaluated by the
+// profiler
+struct PathStats {
+  unsigned long path_searches;    // Path::Find() calls
+  unsigned long trans_searches;   // TransPath::Find() calls
+  unsigned long nodes;            // nodes expanded by all searches
+  unsigned long move_cost;        // Map::MoveCost() calls
+};
+
+extern PathStats PStats;
+
+#define PROFILE_MAX_DEPTH  8
+
+class AIProfiler {
+public:
+  enum Phase {
+    PHASE_IDENTIFY = 0,  // AI::IdentifyObjectives()
+    PHASE_ASSIGN,        // AI::AssignObjectives()
+    PHASE_SELECT,        // unit selection (move shading) before commands
+    PHASE_REPAIR,        // AI::CommandUnitRepair()
+    PHASE_DEFEND,        // AI::CommandUnitDefend()
+    PHASE_CONQUER,       // AI::CommandUnitConquer()
+    PHASE_ATTACK,        // AI::CommandUnitAttack()
+    PHASE_TRANSPORT,     // AI::CommandUnitTransport()
+    PHASE_BUILD,         // AI::BuildReinforcements()
+    PHASE_COUNT
+  };
+
+  AIProfiler( void ) : out(0), own(false), depth(0) {}
+  ~AIProfiler( void ) { Close(); }
+
+  static AIProfiler *Get( void );
+  static unsigned long Ticks( void );
+
+  void StartTurn( unsigned short turn, unsigned char player,
+                  unsigned short units );
+  void EndTurn( void );
+
+  void Enter( Phase phase );
+  void Leave( void );
+
+private:
+  bool Open( const char *log );
+  void Close( void );
+
+  ostream *out;
+  bool own;                  // out was allocated by us
+
+  unsigned short turn;
+  unsigned char player;
+  unsigned short units;
+  unsigned long turn_start;
+  unsigned long phase_start;
+
+  unsigned long time[PHASE_COUNT];    // exclusive time in microseconds
+  unsigned short calls[PHASE_COUNT];
+  PathStats stats;           // counter snapshot at start of turn
+
+  Phase stack[PROFILE_MAX_DEPTH];  // phases may be nested, e.g. a
+  unsigned char depth;             // transport commanding its cargo
+};
+
+// measure the time spent in a phase from construction until
+// destruction of the object; does nothing if profiling is disabled
+class ProfileScope {
+public:
+  ProfileScope( AIProfiler *prof, AIProfiler::Phase phase ) : prof(prof)
+    { if ( prof ) prof->Enter( phase ); }
+  ~ProfileScope( void ) { if ( prof ) prof->Leave(); }
+
+private:
+  AIProfiler *prof;
+};
+
+#endif	/* _INCLUDE_PROFILE_H */
+
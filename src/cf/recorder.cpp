@@ -0,0 +1,306 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+
+////////////////////////////////////////////////////////////////////////
+// recorder.cpp
+////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <iostream>
+
+#include "recorder.h"
+#include "chunkfile.h"
+#include "strutil.h"
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecorder::TurnStart
+// DESCRIPTION: Called at the start of every turn. Writes a keyframe if
+//              necessary.
+// PARAMETERS : mission - current mission
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int GameRecorder::TurnStart( Mission &mission ) {
+  if ( !need_keyframe &&
+       ((mission.GetPlayer().ID() != PLAYER_ONE) ||
+        (mission.GetTurn() < last_keyframe + KEYFRAME_INTERVAL)) )
+    return 0;
+
+  ChunkWriter chunks;
+  unsigned short mflags = mission.GetFlags();
+  mission.SetFlags( mflags|GI_SAVEFILE );
+  mission.Save( chunks );
+  mission.SetFlags( mflags );
+
+  DynBuffer data;
+  int rc = Mission::Write( data, chunks );
+  if ( rc == 0 )
+    rc = Append( new_mission ? REC_MISSION : REC_KEYFRAME, mission, data );
+  if ( rc == 0 ) {
+    last_keyframe = mission.GetTurn();
+    need_keyframe = new_mission = false;
+  }
+  return rc;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecorder::TurnEnd
+// DESCRIPTION: Called at the end of every turn after all battles have
+//              been resolved. Writes the actions of the current player.
+// PARAMETERS : mission - current mission
+//              history - history of the turn; if NULL the turn can't
+//                        be recorded and the next turn will start with
+//                        a keyframe
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int GameRecorder::TurnEnd( Mission &mission, const History *history ) {
+  if ( !history ) {
+    need_keyframe = true;
+    return 0;
+  }
+
+  DynBuffer data;
+  history->Save( data, mission, History::HIST_SAVE_NETWORK );
+  return Append( REC_TURN, mission, data );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecorder::NewMission
+// DESCRIPTION: Called when the game has moved on to another map. The
+//              turn numbers start over, and the next turn must start
+//              with a keyframe of the new mission.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void GameRecorder::NewMission( void ) {
+  last_keyframe = 0;
+  need_keyframe = new_mission = true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecorder::Append
+// DESCRIPTION: Add a record to the end of the recording. The file is
+//              created with the first record. If a file of that name
+//              exists already, a number is added to the name.
+// PARAMETERS : type    - record type
+//              mission - current mission
+//              data    - record data
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int GameRecorder::Append( unsigned char type, Mission &mission,
+                          const DynBuffer &data ) {
+  int rc = -1;
+
+  if ( !created && File::Exists( file ) ) {
+    string base( file ), ext;
+    size_t dot = file.rfind( '.' ), dir = file.rfind( PATHDELIM );
+    if ( (dot != string::npos) && ((dir == string::npos) || (dot > dir)) ) {
+      base.erase( dot );
+      ext = file.substr( dot );
+    }
+
+    for ( int i = 2; File::Exists( file ); ++i )
+      file = base + '-' + StringUtil::tostring( i ) + ext;
+    cout << "Recording game to " << file << endl;
+  }
+
+  File out( file );
+  if ( out.Open( created ? "ab" : "wb", false ) ) {
+    rc = 0;
+
+    if ( !created ) {
+      rc = out.Write32( FID_RECORDING ) || out.Write8( RECORDING_VERSION );
+      created = (rc == 0);
+    }
+
+    if ( rc == 0 )
+      rc = out.Write8( type ) ||
+           out.Write16( mission.GetTurn() ) ||
+           out.Write8( mission.GetPlayer().ID() ) ||
+           out.Write32( data.Size() ) ||
+           out.Write( data.GetData(), data.Size() );
+    out.Close();
+  }
+
+  if ( rc ) {
+    cerr << "Error: Could not write recording " << file << endl;
+    rc = -1;
+  }
+  return rc;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecording::Open
+// DESCRIPTION: Open a recording and read the record headers.
+// PARAMETERS : -
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int GameRecording::Open( void ) {
+  if ( !file.Open( "rb", false ) ) {
+    cerr << "Error: Could not open " << file.Name() << endl;
+    return -1;
+  }
+
+  unsigned long id = file.Read32();
+  unsigned char version = file.Read8();
+  if ( (id != FID_RECORDING) || (version < 1) ||
+       (version > RECORDING_VERSION) ) {
+    cerr << "Error: " << file.Name() << " is not a valid recording" << endl;
+    return -1;
+  }
+
+  // only the headers are read here, the data is skipped
+  unsigned long pos = file.Tell();
+  Record rec;
+  while ( file.Read( &rec.type, 1 ) == 1 ) {
+    rec.turn = file.Read16();
+    rec.player = file.Read8();
+    rec.size = file.Read32();
+    rec.offset = pos + 8;
+
+    index.push_back( rec );
+
+    pos = rec.offset + rec.size;
+    if ( file.Seek( pos ) < 0 ) break;
+  }
+
+  current = 0;
+  return index.empty() ? -1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecording::Seek
+// DESCRIPTION: Go to the start of a turn. The game state is restored
+//              from the last keyframe before that turn. The caller
+//              must then execute the turns up to the requested one.
+//              Only the first mission of the recording is searched;
+//              later ones can only be reached by playing through.
+// PARAMETERS : turn     - turn to go to
+//              keyframe - buffer to hold the saved game to start from
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int GameRecording::Seek( unsigned short turn, MemoryBuffer &keyframe ) {
+  int key = -1;
+
+  for ( unsigned int i = 0; i < index.size(); ++i ) {
+    const Record &r = index[i];
+
+    // the turn numbers of the next mission start over
+    if ( (r.type == REC_MISSION) && (key != -1) ) break;
+
+    if ( (r.type == REC_KEYFRAME) || (r.type == REC_MISSION) ) {
+      if ( (key == -1) || (r.turn < turn) ||
+           ((r.turn == turn) && (r.player == PLAYER_ONE)) )
+        key = i;
+      else break;
+    }
+  }
+
+  if ( (key == -1) || ReadRecord( index[key], keyframe ) ) return -1;
+
+  current = key + 1;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecording::NextTurn
+// DESCRIPTION: Advance to the next turn record.
+// PARAMETERS : turn   - set to the turn number of the record
+//              player - set to the ID of the player of the record
+// RETURNS    : TRUE if there was another turn, FALSE at the end of the
+//              recording or of the current mission
+////////////////////////////////////////////////////////////////////////
+
+bool GameRecording::NextTurn( unsigned short &turn, unsigned char &player ) {
+  while ( current < index.size() ) {
+    const Record &r = index[current];
+
+    // the game must move on to the next map first (see NextMission())
+    if ( r.type == REC_MISSION ) break;
+    ++current;
+
+    if ( r.type == REC_TURN ) {
+      turn = r.turn;
+      player = r.player;
+      return true;
+    }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecording::NextMission
+// DESCRIPTION: Skip the rest of the current mission. Call this when
+//              the game being played back moves on to the next map.
+// PARAMETERS : -
+// RETURNS    : 0 on success, -1 if the recording does not contain
+//              another mission
+////////////////////////////////////////////////////////////////////////
+
+int GameRecording::NextMission( void ) {
+  while ( current < index.size() ) {
+    if ( index[current++].type == REC_MISSION ) return 0;
+  }
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecording::GetTurn
+// DESCRIPTION: Read the history of the turn selected by the last call
+//              to GameRecording::NextTurn(). This may be called more
+//              than once for the same turn.
+// PARAMETERS : buf - buffer to hold the history
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int GameRecording::GetTurn( MemoryBuffer &buf ) {
+  if ( (current == 0) || (index[current-1].type != REC_TURN) )
+    return -1;
+  return ReadRecord( index[current-1], buf );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : GameRecording::ReadRecord
+// DESCRIPTION: Read the data of a record.
+// PARAMETERS : rec - record to read
+//              buf - buffer to hold the data
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int GameRecording::ReadRecord( const Record &rec, MemoryBuffer &buf ) {
+  unsigned char *data = (unsigned char *)malloc( rec.size ? rec.size : 1 );
+  if ( !data ) return -1;
+
+  if ( (file.Seek( rec.offset ) < 0) ||
+       ((unsigned long)file.Read( data, rec.size ) != rec.size) ) {
+    // the game probably crashed while writing this
+    cerr << "Error: Recording " << file.Name() << " is truncated" << endl;
+    free( data );
+    return -1;
+  }
+
+  buf.Assign( data, rec.size );
+  return 0;
+}
@@ -0,0 +1,112 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+
+////////////////////////////////////////////////////////////////////////
+// recorder.h - full game recordings
+////////////////////////////////////////////////////////////////////////
+
+#ifndef _INCLUDE_RECORDER_H
+#define _INCLUDE_RECORDER_H
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "mission.h"
+#include "misc.h"
+
+#define FID_RECORDING      MakeID('C','F','R','C')
+#define RECORDING_VERSION  2
+
+// number of turns between two snapshots of the complete game state
+#define KEYFRAME_INTERVAL  5
+
+// A recording is a sequence of records, each starting with a header:
+//
+//   type (8 bits), turn (16), player (8), size of data (32)
+//
+// Keyframes contain a saved game as written by Mission::Write() and
+// are created at the start of a turn. Turn records contain the history
+// of one player turn in the compact network format. To get to a given
+// turn, load the closest keyframe before it and execute the turns in
+// between.
+//
+// The first keyframe of each mission is of type REC_MISSION. Turn
+// numbers start over when a campaign moves on to the next map, so
+// searching for a turn must not cross such a record. Version 1
+// recordings don't have them and always contain a single mission.
+enum {
+  REC_KEYFRAME = 0,
+  REC_TURN,
+  REC_MISSION
+};
+
+// append a running game to a recording. The file is opened for each
+// record so a recording is usable even if the game crashes. An
+// existing file is never overwritten; if the name is already taken a
+// number is added to it.
+class GameRecorder {
+public:
+  GameRecorder( const string &file ) :
+    file(file), last_keyframe(0), need_keyframe(true),
+    new_mission(true), created(false) {}
+
+  int TurnStart( Mission &mission );
+  int TurnEnd( Mission &mission, const History *history );
+  void NewMission( void );
+
+private:
+  int Append( unsigned char type, Mission &mission,
+              const DynBuffer &data );
+
+  string file;
+  unsigned short last_keyframe;  // turn of last keyframe
+  bool need_keyframe;            // state can't be restored from turns
+  bool new_mission;              // next keyframe starts a mission
+  bool created;                  // file has been created
+};
+
+// read a recording
+class GameRecording {
+public:
+  GameRecording( const string &file ) : file(file), current(0) {}
+
+  int Open( void );
+  int Seek( unsigned short turn, MemoryBuffer &keyframe );
+  bool NextTurn( unsigned short &turn, unsigned char &player );
+  int NextMission( void );
+  int GetTurn( MemoryBuffer &buf );
+
+private:
+  struct Record {
+    unsigned char type;
+    unsigned short turn;
+    unsigned char player;
+    unsigned long offset;  // start of data in file
+    unsigned long size;
+  };
+
+  int ReadRecord( const Record &rec, MemoryBuffer &buf );
+
+  File file;
+  vector<Record> index;
+  unsigned int current;   // current record
+};
+
+#endif	/* _INCLUDE_RECORDER_H */
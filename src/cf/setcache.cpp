@@ -0,0 +1,203 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// setcache.cpp -- process-wide cache for unit and terrain sets
+//
+// Loading a set is expensive (sound effects, portraits, and the tiles
+// which need to be converted to the display format), and most maps use
+// the default sets anyway. Sets which are no longer referenced are not
+// freed immediately since the old mission is usually destroyed before
+// the next one is loaded. Instead, up to SETCACHE_MAX_UNUSED of them
+// are kept around, and the least recently used ones are dropped first.
+////////////////////////////////////////////////////////////////////////
+
+#include "setcache.h"
+#include "fileio.h"
+#include "list.h"
+
+class SetCacheEntry : public Node {
+public:
+  SetCacheEntry( TileSet *set, const string &name, const string &path,
+                 long mtime, unsigned char type ) :
+    set(set), name(name), path(path), mtime(mtime), type(type),
+    refs(1), stale(false) {}
+  ~SetCacheEntry( void ) { delete set; }
+
+  TileSet *set;
+  string name;
+  string path;      // full path of the data file
+  long mtime;       // modification time of the data file when loaded
+  unsigned char type;
+  unsigned short refs;
+  bool stale;       // data file has changed since
+};
+
+static List entries;
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : SetCache::GetUnitSet
+// DESCRIPTION: Get a unit set. The set is loaded if it is not in the
+//              cache yet or if the data file has changed.
+// PARAMETERS : name - name of the unit set (without suffix)
+// RETURNS    : unit set or NULL on error
+////////////////////////////////////////////////////////////////////////
+
+UnitSet *SetCache::GetUnitSet( const string &name ) {
+  return static_cast<UnitSet *>(Get( name, SET_UNITS ));
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : SetCache::GetTerrainSet
+// DESCRIPTION: Get a terrain set. The set is loaded if it is not in
+//              the cache yet or if the data file has changed.
+// PARAMETERS : name - name of the terrain set (without suffix)
+// RETURNS    : terrain set or NULL on error
+////////////////////////////////////////////////////////////////////////
+
+TerrainSet *SetCache::GetTerrainSet( const string &name ) {
+  return static_cast<TerrainSet *>(Get( name, SET_TERRAIN ));
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : SetCache::Get
+// DESCRIPTION: Look up a set in the cache or load it.
+// PARAMETERS : name - name of the set
+//              type - type of set
+// RETURNS    : set or NULL on error
+////////////////////////////////////////////////////////////////////////
+
+TileSet *SetCache::Get( const string &name, SetType type ) {
+  string file( name + (type == SET_UNITS ? ".units" : ".tiles") );
+  string path( find_data_file( file ) );
+  if ( path.empty() ) return NULL;
+
+  long mtime = data_file_time( path );
+
+  SetCacheEntry *e = static_cast<SetCacheEntry *>(entries.Head());
+  while ( e ) {
+    SetCacheEntry *next = static_cast<SetCacheEntry *>(e->Next());
+
+    if ( (e->type == type) && (e->name == name) && !e->stale ) {
+      if ( (e->path == path) && (e->mtime == mtime) ) {
+        ++e->refs;
+        return e->set;
+      }
+
+      // the set has been modified; keep the old one around only
+      // as long as some mission is still using it
+      e->stale = true;
+      if ( e->refs == 0 ) {
+        e->Remove();
+        delete e;
+      }
+    }
+    e = next;
+  }
+
+  TileSet *set;
+  if ( type == SET_UNITS ) set = new UnitSet;
+  else set = new TerrainSet;
+
+  MemoryBuffer buf( file );
+  if ( !buf.OpenData() || set->Load( buf, name.c_str() ) ) {
+    delete set;
+    return NULL;
+  }
+
+  entries.AddTail( new SetCacheEntry( set, name, path, mtime, type ) );
+  return set;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : SetCache::Release
+// DESCRIPTION: Return a set obtained from the cache.
+// PARAMETERS : set - set to release (may be NULL)
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void SetCache::Release( TileSet *set ) {
+  if ( !set ) return;
+
+  for ( SetCacheEntry *e = static_cast<SetCacheEntry *>(entries.Head());
+        e; e = static_cast<SetCacheEntry *>(e->Next()) ) {
+    if ( e->set == set ) {
+      if ( --e->refs == 0 ) {
+        e->Remove();
+        if ( e->stale ) delete e;
+        else {
+          // most recently used sets go to the end of the list
+          entries.AddTail( e );
+          Trim();
+        }
+      }
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : SetCache::Trim
+// DESCRIPTION: Drop the least recently used sets if there are more than
+//              SETCACHE_MAX_UNUSED which are not referenced anymore.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void SetCache::Trim( void ) {
+  unsigned short unused = 0;
+  SetCacheEntry *e;
+
+  for ( e = static_cast<SetCacheEntry *>(entries.Head());
+        e; e = static_cast<SetCacheEntry *>(e->Next()) ) {
+    if ( e->refs == 0 ) ++unused;
+  }
+
+  e = static_cast<SetCacheEntry *>(entries.Head());
+  while ( e && (unused > SETCACHE_MAX_UNUSED) ) {
+    SetCacheEntry *next = static_cast<SetCacheEntry *>(e->Next());
+    if ( e->refs == 0 ) {
+      e->Remove();
+      delete e;
+      --unused;
+    }
+    e = next;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : SetCache::Flush
+// DESCRIPTION: Free all sets which are not in use. This must be called
+//              before the video and sound subsystems are shut down.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void SetCache::Flush( void ) {
+  SetCacheEntry *e = static_cast<SetCacheEntry *>(entries.Head());
+
+  while ( e ) {
+    SetCacheEntry *next = static_cast<SetCacheEntry *>(e->Next());
+    if ( e->refs == 0 ) {
+      e->Remove();
+      delete e;
+    }
+    e = next;
+  }
+}
+
@@ -0,0 +1,54 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+/////////////////////////////////////////////////////////////////////////
+// setcache.h - process-wide cache for unit and terrain sets
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef _INCLUDE_SETCACHE_H
+#define _INCLUDE_SETCACHE_H
+
+#include <string>
+using namespace std;
+
+#include "lset.h"
+
+// number of sets no longer used by any mission which are kept in
+// memory for the next map (e.g. in a campaign)
+#define SETCACHE_MAX_UNUSED  4
+
+// Missions using the same unit or terrain set share a single instance.
+// Sets are identified by name and the modification time of the data
+// file, so changed sets are loaded again. Each set obtained from the
+// cache must be returned with SetCache::Release().
+class SetCache {
+public:
+  static UnitSet *GetUnitSet( const string &name );
+  static TerrainSet *GetTerrainSet( const string &name );
+  static void Release( TileSet *set );
+  static void Flush( void );
+
+private:
+  enum SetType { SET_UNITS, SET_TERRAIN };
+
+  static TileSet *Get( const string &name, SetType type );
+  static void Trim( void );
+};
+
+#endif	/* _INCLUDE_SETCACHE_H */
+
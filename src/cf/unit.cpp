@@ -97,6 +97,87 @@ int Unit::Save( MemBuffer &file ) const {
   return 0;
 }
 
+// fields stored by Unit::SaveDelta()
+#define UD_POSITION  0x01
+#define UD_FLAGS     0x02
+#define UD_FACING    0x04
+#define UD_GROUP     0x08
+#define UD_XP        0x10
+#define UD_TARGET    0x20
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Unit::LoadDelta
+// DESCRIPTION: Apply changes written by Unit::SaveDelta(). The unit
+//              must have been initialized from the same reference unit
+//              used for saving.
+// PARAMETERS : file - descriptor of the data file
+// RETURNS    : 0 on success, non-zero on error
+////////////////////////////////////////////////////////////////////////
+
+int Unit::LoadDelta( MemBuffer &file ) {
+  unsigned char mask = file.Read8();
+
+  if ( mask & UD_POSITION ) {
+    u_pos.x += file.ReadSVar();
+    u_pos.y += file.ReadSVar();
+  }
+  if ( mask & UD_FLAGS ) {
+    // see Unit::SaveDelta()
+    unsigned long diff = file.ReadVar();
+    u_flags ^= ((diff << 24) | (diff >> 8)) & 0xFFFFFFFF;
+  }
+  if ( mask & UD_FACING ) u_facing = file.Read8();
+  if ( mask & UD_GROUP ) u_group = file.Read8();
+  if ( mask & UD_XP ) u_xp = file.Read8();
+  if ( mask & UD_TARGET ) {
+    u_target.x += file.ReadSVar();
+    u_target.y += file.ReadSVar();
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Unit::SaveDelta
+// DESCRIPTION: Save only those properties of the unit which differ
+//              from another unit. Type, owner, and ID are not saved and
+//              must be identical.
+// PARAMETERS : file - descriptor of the data file
+//              ref  - reference unit
+// RETURNS    : 0 on succes, non-zero on error
+////////////////////////////////////////////////////////////////////////
+
+int Unit::SaveDelta( MemBuffer &file, const Unit &ref ) const {
+  unsigned char mask = 0;
+
+  if ( u_pos != ref.u_pos ) mask |= UD_POSITION;
+  if ( u_flags != ref.u_flags ) mask |= UD_FLAGS;
+  if ( u_facing != ref.u_facing ) mask |= UD_FACING;
+  if ( u_group != ref.u_group ) mask |= UD_GROUP;
+  if ( u_xp != ref.u_xp ) mask |= UD_XP;
+  if ( u_target != ref.u_target ) mask |= UD_TARGET;
+
+  file.Write8( mask );
+
+  if ( mask & UD_POSITION ) {
+    file.WriteSVar( u_pos.x - ref.u_pos.x );
+    file.WriteSVar( u_pos.y - ref.u_pos.y );
+  }
+  if ( mask & UD_FLAGS ) {
+    // the flags which change during the game live in the top byte,
+    // so rotate them to the bottom to keep the number short
+    unsigned long diff = (u_flags ^ ref.u_flags) & 0xFFFFFFFF;
+    file.WriteVar( ((diff >> 24) | (diff << 8)) & 0xFFFFFFFF );
+  }
+  if ( mask & UD_FACING ) file.Write8( u_facing );
+  if ( mask & UD_GROUP ) file.Write8( u_group );
+  if ( mask & UD_XP ) file.Write8( u_xp );
+  if ( mask & UD_TARGET ) {
+    file.WriteSVar( u_target.x - ref.u_target.x );
+    file.WriteSVar( u_target.y - ref.u_target.y );
+  }
+  return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Unit::AwardXP
 // DESCRIPTION: Raise the unit's experience level. This will improve its
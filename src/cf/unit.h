@@ -56,6 +56,8 @@ public:
 
   virtual int Load( MemBuffer &file, const UnitType *type, Player *player );
   virtual int Save( MemBuffer &file ) const;
+  int LoadDelta( MemBuffer &file );
+  int SaveDelta( MemBuffer &file, const Unit &ref ) const;
 
   unsigned short BaseImage( void ) const { return u_type->Image() + u_player->ID() * 6; }
   unsigned short BuildCost( void ) const { return u_type->Cost(); }
@@ -77,6 +79,7 @@ public:
 
   void AwardXP( unsigned char xp );
   void SetOwner( Player *player );
+  void SetType( const UnitType *type ) { u_type = type; }
   virtual void SetPosition( short x, short y );
   void SetGroupSize( unsigned char size ) { u_group = size; }
 
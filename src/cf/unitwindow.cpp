@@ -194,6 +194,7 @@ ContainerWindow::ContainerWindow( UnitContainer *container, View *view ) :
   Transport *t;
   Player *player = dynamic_cast<MapObject *>(c)->Owner();;
   MapView *mv = Gam->GetMapWindow()->GetMapView();
+  const UnitSet *us = mv->GetMap()->GetUnitSet();
 
   if ( dynamic_cast<MapObject *>(c)->IsUnit() ) {
     unit = true;
@@ -206,8 +207,8 @@ ContainerWindow::ContainerWindow( UnitContainer *container, View *view ) :
   }
 
   // calculate window dimensions
-  short width = mv->TileWidth() + XP_ICON_WIDTH + lfont->Width() * 20 + 70;
-  short height = 8 * mv->TileHeight() + 40 + sfont->Height();
+  short width = us->TileWidth() + XP_ICON_WIDTH + lfont->Width() * 20 + 70;
+  short height = 8 * us->TileHeight() + 40 + sfont->Height();
   SetSize( MIN(width, view->Width()), MIN(height, view->Height()) );
 
   for ( i = 0; i < CH_NUM_BUTTONS; ++i ) buttons[i] = NULL;
@@ -231,7 +232,7 @@ ContainerWindow::ContainerWindow( UnitContainer *container, View *view ) :
   }
 
   // create list widget
-  width = mv->TileWidth() + XP_ICON_WIDTH + DEFAULT_SLIDER_SIZE + 20;
+  width = us->TileWidth() + XP_ICON_WIDTH + DEFAULT_SLIDER_SIZE + 20;
   listwidget = new UnitListWidget( CH_LIST_UNITS, 10, 10,
                width, h - sfont->Height() - 28, &normal, -1,
                WIDGET_VSCROLL|WIDGET_HSCROLLKEY|WIDGET_VSCROLLKEY,
@@ -298,7 +299,7 @@ ContainerWindow::ContainerWindow( UnitContainer *container, View *view ) :
 
 void ContainerWindow::Draw( void ) {
   Window::Draw();
-  UnitInfoWindow::DrawUnitInfo( -1, NULL, NULL, this, unitinfo );
+  UnitInfoWindow::DrawUnitInfo( NULL, NULL, NULL, this, unitinfo );
 
   unsigned short xoff;
   Rect boxrect( unitinfo.x, 10, w - unitinfo.x - 10, lfont->Height() + 20 );
@@ -398,7 +399,7 @@ void ContainerWindow::SwitchMode( unsigned short newmode ) {
       for ( int i = 0; i < 32; ++i ) {
         if ( prod & (1 << i) ) {        // this unit type can be built
           ULWNode *n = new ULWNode;
-          n->type = m->GetUnitSet().GetUnitInfo( i );
+          n->type = m->GetUnitInfo( i );
           n->unit = NULL;
           n->image = n->type->Image() + b->Owner()->ID() * 6;
           n->ok = (n->type->Cost() <= crystals);
@@ -414,7 +415,7 @@ void ContainerWindow::SwitchMode( unsigned short newmode ) {
       DrawBack( unitinfo );
       listwidget->SwitchList( &build, 0 );
       UnitInfoWindow::DrawUnitInfo(
-          static_cast<ULWNode *>(build.Head())->type->ID(),
+          static_cast<ULWNode *>(build.Head())->type,
           &m->GetUnitSet(), &m->GetTerrainSet(), this, unitinfo );
       Show();
     }
@@ -428,7 +429,7 @@ void ContainerWindow::SwitchMode( unsigned short newmode ) {
     // display normal list in widget
     DrawBack( unitinfo );
     listwidget->SwitchList( &normal, -1 );
-    UnitInfoWindow::DrawUnitInfo( -1, NULL, NULL, this, unitinfo );
+    UnitInfoWindow::DrawUnitInfo( NULL, NULL, NULL, this, unitinfo );
     Show();
   }
 
@@ -540,10 +541,9 @@ GUI_Status ContainerWindow::WidgetActivated( Widget *widget, Window *win ) {
                     );
 
     if ( node != last_selected ) {
-      short uid = -1;
-      if ( node ) uid = node->type->ID();
       DrawBack( unitinfo );
-      UnitInfoWindow::DrawUnitInfo( uid, &Gam->GetMission()->GetUnitSet(),
+      UnitInfoWindow::DrawUnitInfo( node ? node->type : NULL,
+                      &Gam->GetMission()->GetUnitSet(),
                       &Gam->GetMission()->GetTerrainSet(), this, unitinfo );
       win->Show( unitinfo );
       last_selected = node;
@@ -655,7 +655,7 @@ UnitLoadWindow::UnitLoadWindow( Transport &t, UnitContainer &c,
 
 void UnitLoadWindow::Draw( void ) {
   Window::Draw();
-  UnitInfoWindow::DrawUnitInfo( -1, NULL, NULL, this, unitinfo );
+  UnitInfoWindow::DrawUnitInfo( NULL, NULL, NULL, this, unitinfo );
 
   const char *msg = MSG(MSG_TRANSFER_UNITS);
   unsigned short txtw = sfont->TextWidth(msg);
@@ -693,10 +693,9 @@ GUI_Status UnitLoadWindow::WidgetActivated( Widget *widget, Window *win ) {
     node = static_cast<ULWNode *>( wd_list->Selected() );
 
     if ( node != last_selected ) {
-      short uid = -1;
-      if ( node ) uid = node->type->ID();
       DrawBack( unitinfo );
-      UnitInfoWindow::DrawUnitInfo( uid, &Gam->GetMission()->GetUnitSet(),
+      UnitInfoWindow::DrawUnitInfo( node ? node->type : NULL,
+                      &Gam->GetMission()->GetUnitSet(),
                       &Gam->GetMission()->GetTerrainSet(), this, unitinfo );
       win->Show( unitinfo );
       last_selected = node;
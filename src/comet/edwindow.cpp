@@ -535,7 +535,7 @@ GUI_Status EdWindow::WidgetActivated( Widget *widget, Window *win ) {
       break;
 
     case B_ID_UNIT_INFO:
-      new UnitInfoWindow( map->GetUnit( selected_hex )->Type()->ID(), *map, view );
+      new UnitInfoWindow( map->GetUnit( selected_hex )->Type(), *map, view );
       break;
     case B_ID_UNIT_EDIT: {
       EdUnitWindow *euw = new EdUnitWindow( *(map->GetUnit( selected_hex )), *mission, view );
@@ -438,14 +438,14 @@ Mission *NewMissionWindow::NewMission( const Point &size,
   UnitSet *us = new UnitSet;
 
   string tname( get_data_dir() + tset + ".tiles" );
-  File tfile( tname );
+  MemoryBuffer tfile( tname );
 
   string uname( get_data_dir() + uset + ".units" );
-  File ufile( uname );
+  MemoryBuffer ufile( uname );
 
-  if ( !tfile.Open("rb") || ts->Load( tfile, tset.c_str() ) ) {
+  if ( !tfile.Open() || ts->Load( tfile, tset.c_str() ) ) {
     new NoteWindow( "Error", "Tile set not available", 0, view );
-  } else if ( !ufile.Open("rb") || us->Load( ufile, uset.c_str() ) ) {
+  } else if ( !ufile.Open() || us->Load( ufile, uset.c_str() ) ) {
     new NoteWindow( "Error", "Unit set not available", 0, view );
   } else {
     ms = new Mission( size, ts, us );
@@ -34,6 +34,7 @@
 #include "mission.h"
 #include "color.h"
 #include "fileio.h"
+#include "codec.h"
 #include "sound.h"
 #include "globals.h"
 
@@ -116,6 +117,10 @@ void parse_options( int argc, char **argv, EdOptions &opts ) {
     } else if (strcmp(argv[argc-1], "--sound") == 0) {
       if ( atoi( argv[argc] ) ) opts.sound = true;
       else opts.sound = false;
+    } else if (strcmp(argv[argc-1], "--compress") == 0) {
+      int codec = Codec::Find( argv[argc] );
+      if ( codec != -1 ) Codec::SetDefault( codec );
+      else fprintf( stderr, "Warning: Unknown compression method %s\n", argv[argc] );
     } else {
       if (strcmp(argv[argc], "--version") == 0)
         fprintf( stdout, PROGRAMNAME" "VERSION"\n" );
@@ -145,6 +150,8 @@ void print_usage( char *prog ) {
 #ifndef DISABLE_SOUND
                    "  --sound <1|0>        enable/disable sound\n"
 #endif
+                   "  --compress <method>  compression for levels\n"
+                   "                       (none, fast, or best)\n"
                    "  --help               display this help and exit\n"
                    "  --version            output version information and exit\n",
         prog );
@@ -321,8 +328,8 @@ Editor::~Editor( void ) {
 int Editor::Init( const EdOptions &opts ) {
   string datpath( get_data_dir() );
   datpath.append( CF_DATFILE );
-  File datfile( datpath );
-  if ( !datfile.Open( "rb" ) ) {
+  MemoryBuffer datfile( datpath );
+  if ( !datfile.Open() ) {
     cerr << "Error: Couldn't open '" << datpath << "'" << endl;
     return -1;
   }
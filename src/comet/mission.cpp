@@ -24,6 +24,7 @@
 
 #include "mission.h"
 #include "fileio.h"
+#include "chunkfile.h"
 #include "strutil.h"
 #include "globals.h"
 
@@ -87,11 +88,35 @@ Mission::~Mission( void ) {
 
 int Mission::Load( const char *filename ) {
   int rc = -1;
-  File file( filename );
-  if ( !file.Open( "rb" ) ) return -1;
+  MemoryBuffer file( filename );
+  if ( !file.Open() ) return -1;
 
   // read game info
-  if ( (file.Read32() == FID_MISSION) && (file.Read8() == FILE_VERSION) ) {
+  unsigned char version = 0;
+  if ( file.Read32() == FID_MISSION ) version = file.Read8();
+
+  // sectioned files provide separate buffers for the different parts
+  // of the mission, old files contain everything in one block
+  ChunkReader chunks;
+  MemBuffer *head = &file, *mapdata = &file, *sets = &file,
+            *objs = &file, *text = &file;
+
+  if ( version == FILE_VERSION ) {
+    if ( chunks.Load( file ) ) return -1;
+
+    head = chunks.GetSection( SECT_HEADER );
+    mapdata = chunks.GetSection( SECT_MAP );
+    sets = chunks.GetSection( SECT_SETS );
+    objs = chunks.GetSection( SECT_OBJECTS );
+    text = chunks.GetSection( SECT_TEXT );
+
+    if ( !head || !mapdata || !sets || !objs || !text ) {
+      cerr << "Error: Mission file is incomplete" << endl;
+      return -1;
+    }
+  }
+
+  if ( (version == FILE_VERSION) || (version == FILE_VERSION_MONOLITHIC) ) {
     unsigned short len, i;
     signed char mapid, musicid;
     string uset, tset;
@@ -103,47 +128,47 @@ int Mission::Load( const char *filename ) {
     i = last_file_name.rfind( '.' );
     last_file_name.erase( i );
 
-    flags = file.Read16();
-    i = file.Read16();              // turn number - unused
+    flags = head->Read16();
+    i = head->Read16();             // turn number - unused
 
     if ( flags & GI_SAVEFILE )      // refuse to load saved games
       return -1;
 
-    name = file.Read8();
-    level_info = file.Read8();
-    campaign_name = file.Read8();
-    campaign_info = file.Read8();
-    mapid = file.Read8();
-    musicid = file.Read8();
-    file.Read8();                   // handicap - unused
-    file.Read8();                   // current player - unused
-    file.Read8();                   // turn phase - unused
+    name = head->Read8();
+    level_info = head->Read8();
+    campaign_name = head->Read8();
+    campaign_info = head->Read8();
+    mapid = head->Read8();
+    musicid = head->Read8();
+    head->Read8();                  // handicap - unused
+    head->Read8();                  // current player - unused
+    head->Read8();                  // turn phase - unused
 
-    p1.Load( file );
-    p2.Load( file );
+    p1.Load( *head );
+    p2.Load( *head );
 
     // load text messages
-    messages.Load( file );
+    messages.Load( *head );
 
-    map.Load( file );               // load map
+    map.Load( *mapdata );           // load map
 
-    len = file.Read16();            // load name of unit set
-    uset = file.ReadS( len );
+    len = sets->Read16();           // load name of unit set
+    uset = sets->ReadS( len );
 
     unit_set = new UnitSet;
-    File ufile( uset + ".units" );
-    if ( !ufile.OpenData("rb") || unit_set->Load( ufile, uset.c_str() ) ) {
+    MemoryBuffer ufile( uset + ".units" );
+    if ( !ufile.OpenData() || unit_set->Load( ufile, uset.c_str() ) ) {
       cerr << "Error: Unit set '" << uset << "' not available." << endl;
       return -1;
     }
     ufile.Close();
 
-    len = file.Read16();            // load name of terrain set
-    tset = file.ReadS( len );
+    len = sets->Read16();           // load name of terrain set
+    tset = sets->ReadS( len );
 
     terrain_set = new TerrainSet;
-    File tfile( tset + ".tiles" );
-    if ( !tfile.OpenData("rb") || terrain_set->Load( tfile, tset.c_str() ) ) {
+    MemoryBuffer tfile( tset + ".tiles" );
+    if ( !tfile.OpenData() || terrain_set->Load( tfile, tset.c_str() ) ) {
       cerr << "Error: Terrain set '" << tset << "' not available." << endl;
       return -1;
     }
@@ -152,19 +177,19 @@ int Mission::Load( const char *filename ) {
     map.SetUnitSet( unit_set );
     map.SetTerrainSet( terrain_set );
 
-    len = file.Read16();                // load buildings
+    len = objs->Read16();               // load buildings
     for ( i = 0; i < len; ++i ) {
       b = new Building();
-      b->Load( file );
+      b->Load( *objs );
       buildings.AddTail( b );
       map.SetBuilding( b, b->Position() );
     }
 
-    len = file.Read16();                // load units
+    len = objs->Read16();               // load units
     for ( i = 0; i < len; ++i ) {
-      unsigned char tid = file.Read8();
+      unsigned char tid = objs->Read8();
 
-      Unit *u = new Unit( file, unit_set->GetUnitInfo(tid) );
+      Unit *u = new Unit( *objs, unit_set->GetUnitInfo(tid) );
       if ( u ) {
         units.AddTail( u );
         if ( !map.GetMapObject(u->Position()) )
@@ -173,19 +198,19 @@ int Mission::Load( const char *filename ) {
       }
     }
 
-    len = file.Read16();                // load battles
+    len = objs->Read16();               // load battles
 
     // combat actions - only present in saved games
 
-    len = file.Read16();                // load events
+    len = objs->Read16();               // load events
     for ( i = 0; i < len; ++i ) {
       e = new Event();
-      e->Load( file );
+      e->Load( *objs );
       events.AddTail( e );
     }
 
     Language internal_messages;
-    internal_messages.ReadCatalog( file );
+    internal_messages.ReadCatalog( *text );
     SetSequel( internal_messages.GetMsg( mapid ) );
     SetMusic( internal_messages.GetMsg( musicid ) );
 
@@ -208,8 +233,6 @@ int Mission::Load( const char *filename ) {
       }
     }
 
-    len = file.Read16();
-
     // history - only present in saved games
 
     rc = 0;
@@ -266,39 +289,41 @@ int Mission::Save( const char *filename ) {
   num = last_file_name.rfind( '.' );
   last_file_name.erase( num );
 
-  file.Write32( FID_MISSION );
-  file.Write8( FILE_VERSION );
+  ChunkWriter chunks;
+  MemBuffer &head = chunks.AddSection( SECT_HEADER );
 
-  file.Write16( flags );
-  file.Write16( 1 );        // turn
+  head.Write16( flags );
+  head.Write16( 1 );        // turn
 
-  file.Write8( name );
-  file.Write8( level_info );
-  file.Write8( campaign_name );
-  file.Write8( campaign_info );
-  file.Write8( mapid );
-  file.Write8( musicid );
-  file.Write8( HANDICAP_NONE );
-  file.Write8( PLAYER_ONE );
-  file.Write8( TURN_START );
+  head.Write8( name );
+  head.Write8( level_info );
+  head.Write8( campaign_name );
+  head.Write8( campaign_info );
+  head.Write8( mapid );
+  head.Write8( musicid );
+  head.Write8( HANDICAP_NONE );
+  head.Write8( PLAYER_ONE );
+  head.Write8( TURN_START );
 
-  p1.Save( file );             // save player data
-  p2.Save( file );
+  p1.Save( head );             // save player data
+  p2.Save( head );
 
-  messages.Save( file );
+  messages.Save( head );
 
-  map.Save( file );            // save map
+  map.Save( chunks.AddSection( SECT_MAP ) );    // save map
 
   // save mission set info
-  file.Write16( unit_set->GetName().length() );
-  file.WriteS( unit_set->GetName() );
-  file.Write16( terrain_set->GetName().length() );
-  file.WriteS( terrain_set->GetName() );
+  MemBuffer &sets = chunks.AddSection( SECT_SETS );
+  sets.Write16( unit_set->GetName().length() );
+  sets.WriteS( unit_set->GetName() );
+  sets.Write16( terrain_set->GetName().length() );
+  sets.WriteS( terrain_set->GetName() );
 
   // save buildings
-  file.Write16( buildings.CountNodes() );
+  MemBuffer &objs = chunks.AddSection( SECT_OBJECTS );
+  objs.Write16( buildings.CountNodes() );
   for ( Building *b = static_cast<Building *>( buildings.Head() );
-        b; b = static_cast<Building *>( b->Next() ) ) b->Save( file );
+        b; b = static_cast<Building *>( b->Next() ) ) b->Save( objs );
 
   // save transports; basically, transports are not much different
   // from other units but we MUST make sure that transports having
@@ -306,31 +331,33 @@ int Mission::Save( const char *filename ) {
   // make two passes through the list, first saving all unsheltered
   // units (which are possibly transports carrying other units), and
   // all sheltered units in the second run
-  file.Write16( units.CountNodes() ); 
+  objs.Write16( units.CountNodes() ); 
   Unit *u;
   for ( u = static_cast<Unit *>( units.Head() );
         u; u = static_cast<Unit *>( u->Next() ) ) {    // make sure transports are
-    if ( !u->IsSheltered() ) u->Save( file );          // stored before carried units
+    if ( !u->IsSheltered() ) u->Save( objs );          // stored before carried units
   }
 
   for ( u = static_cast<Unit *>( units.Head() );
         u; u = static_cast<Unit *>( u->Next() ) ) {
-    if ( u->IsSheltered() ) u->Save( file );
+    if ( u->IsSheltered() ) u->Save( objs );
   }
 
-  file.Write16( 0 );        // save combat data
+  objs.Write16( 0 );        // save combat data
 
   // save events
-  file.Write16( events.CountNodes() );
+  objs.Write16( events.CountNodes() );
   for ( e = static_cast<Event *>( events.Head() );
         e; e = static_cast<Event *>( e->Next() ) )
-    e->Save( file );
+    e->Save( objs );
 
-  internal_messages.WriteCatalog( file );
+  internal_messages.WriteCatalog( chunks.AddSection( SECT_TEXT ) );
 
-  file.Write16( 0 );        // turn history
+  chunks.AddSection( SECT_HISTORY ).Write16( 0 );  // turn history
 
-  return 0;
+  file.Write32( FID_MISSION );
+  file.Write8( FILE_VERSION );
+  return chunks.Write( file );
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,251 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2007 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// chunkfile.cpp
+//
+// A chunked file starts with a section directory
+//
+//   u16 number of sections
+//
+// followed by one entry per section
+//
+//   u32 section ID, u32 offset, u32 decoded size, u32 encoded size,
+//   u8 codec
+//
+// The offset is relative to the end of the directory. The encoded
+// section data follows the directory in the same order. Any file
+// identification and version information must be written by the
+// caller before the directory.
+////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <iostream>
+
+#include "chunkfile.h"
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : ChunkWriter::~ChunkWriter
+// DESCRIPTION: Free all sections.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+ChunkWriter::~ChunkWriter( void ) {
+  for ( unsigned int i = 0; i < sections.size(); ++i )
+    delete sections[i];
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : ChunkWriter::AddSection
+// DESCRIPTION: Create a new section.
+// PARAMETERS : id - section identifier
+// RETURNS    : buffer to write the section data to
+////////////////////////////////////////////////////////////////////////
+
+MemBuffer &ChunkWriter::AddSection( unsigned long id ) {
+  DynBuffer *buf = new DynBuffer;
+  ids.push_back( id );
+  sections.push_back( buf );
+  return *buf;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : ChunkWriter::Write
+// DESCRIPTION: Write the section directory and all sections to a file.
+//              Sections are compressed using the codec selected with
+//              SetCodec(), or the default codec if none has been set.
+//              Sections which do not get smaller are always stored.
+// PARAMETERS : file - destination
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int ChunkWriter::Write( MemBuffer &file ) const {
+  unsigned int i, num = sections.size();
+  vector<unsigned char *> encoded( num, (unsigned char *)0 );
+  vector<unsigned long> stored( num );
+  const Codec *enc = (codec != CODEC_STORE) ? Codec::Get( codec ) : 0;
+  unsigned long offset = 0;
+  int rc;
+
+  for ( i = 0; i < num; ++i ) {
+    unsigned long size = sections[i]->Size();
+    stored[i] = size;
+
+    if ( enc && (size > 0) ) {
+      unsigned long len = enc->Bound( size );
+      unsigned char *buf = (unsigned char *)malloc( len );
+
+      if ( buf && (enc->Encode( (unsigned char *)sections[i]->GetData(),
+                                size, buf, len ) == 0) &&
+           (len < size) ) {
+        encoded[i] = buf;
+        stored[i] = len;
+      } else free( buf );
+    }
+  }
+
+  rc = file.Write16( num );
+  for ( i = 0; (i < num) && (rc == 0); ++i ) {
+    rc = file.Write32( ids[i] );
+    if ( !rc ) rc = file.Write32( offset );
+    if ( !rc ) rc = file.Write32( sections[i]->Size() );
+    if ( !rc ) rc = file.Write32( stored[i] );
+    if ( !rc ) rc = file.Write8( encoded[i] ? codec : CODEC_STORE );
+    offset += stored[i];
+  }
+
+  for ( i = 0; (i < num) && (rc == 0); ++i ) {
+    if ( stored[i] > 0 ) {
+      if ( encoded[i] ) rc = file.Write( encoded[i], stored[i] );
+      else rc = file.Write( sections[i]->GetData(), stored[i] );
+    }
+  }
+
+  for ( i = 0; i < num; ++i ) free( encoded[i] );
+  return rc;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : ChunkReader::~ChunkReader
+// DESCRIPTION: Free all section data.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+ChunkReader::~ChunkReader( void ) {
+  for ( unsigned int i = 0; i < chunks.size(); ++i ) {
+    free( chunks[i].data );
+    delete chunks[i].buf;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : ChunkReader::Load
+// DESCRIPTION: Read the section directory and the raw section data.
+//              Sections are not decoded yet.
+// PARAMETERS : file - file positioned at the section directory
+//              last - if not 0 stop reading after the data of the
+//                     section with this ID; later sections are not
+//                     available
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int ChunkReader::Load( MemBuffer &file, unsigned long last /* = 0 */ ) {
+  unsigned short i, num = file.Read16();
+  unsigned long offset = 0;
+  long left;
+
+  for ( i = 0; i < num; ++i ) {
+    Chunk c;
+    c.id = file.Read32();
+    unsigned long start = file.Read32();
+    c.size = file.Read32();
+    c.stored = file.Read32();
+    c.codec = file.Read8();
+    c.data = 0;
+    c.buf = 0;
+
+    // sections must follow each other without gaps
+    if ( (start != offset) ||
+         ((c.codec == CODEC_STORE) && (c.stored != c.size)) ) {
+      cerr << "Error: Invalid section directory" << endl;
+      return -1;
+    }
+    offset += c.stored;
+    chunks.push_back( c );
+  }
+
+  // don't trust the directory with memory allocation if the buffer
+  // is known to be shorter than the sections claim
+  left = file.Remaining();
+
+  for ( i = 0; i < num; ++i ) {
+    Chunk &c = chunks[i];
+
+    if ( left >= 0 ) {
+      if ( c.stored > (unsigned long)left ) {
+        cerr << "Error: Section data truncated" << endl;
+        return -1;
+      }
+      left -= c.stored;
+    }
+
+    if ( c.stored > 0 ) {
+      c.data = (unsigned char *)malloc( c.stored );
+      if ( !c.data || (file.Read( c.data, c.stored ) != (int)c.stored) ) {
+        cerr << "Error: Section data truncated" << endl;
+        return -1;
+      }
+    }
+
+    if ( c.id == last ) {
+      chunks.resize( i + 1 );
+      break;
+    }
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : ChunkReader::GetSection
+// DESCRIPTION: Get the contents of a section. The section is decoded
+//              on first access.
+// PARAMETERS : id - section identifier
+// RETURNS    : section buffer, or NULL if the section does not exist
+//              or could not be decoded
+////////////////////////////////////////////////////////////////////////
+
+MemoryBuffer *ChunkReader::GetSection( unsigned long id ) {
+  for ( unsigned int i = 0; i < chunks.size(); ++i ) {
+    Chunk &c = chunks[i];
+    if ( c.id != id ) continue;
+    if ( c.buf ) return c.buf;
+
+    unsigned char *buf = 0;
+    if ( c.codec == CODEC_STORE ) {
+      buf = c.data;
+      c.data = 0;
+    } else {
+      const Codec *dec = Codec::Get( c.codec );
+      if ( dec ) {
+        buf = (unsigned char *)malloc( c.size ? c.size : 1 );
+        if ( buf && dec->Decode( c.data, c.stored, buf, c.size ) ) {
+          free( buf );
+          buf = 0;
+        }
+        if ( buf ) {
+          free( c.data );
+          c.data = 0;
+        }
+      }
+    }
+
+    if ( !buf && (c.size > 0) ) {
+      cerr << "Error: Could not decode section " << i << endl;
+      return NULL;
+    }
+
+    c.buf = new MemoryBuffer;
+    c.buf->Assign( buf, c.size );
+    return c.buf;
+  }
+  return NULL;
+}
+
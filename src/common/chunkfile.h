@@ -0,0 +1,79 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2009 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// chunkfile.h - data files made up of independent sections
+////////////////////////////////////////////////////////////////////////
+
+#ifndef _INCLUDE_CHUNKFILE_H
+#define _INCLUDE_CHUNKFILE_H
+
+#include <vector>
+using namespace std;
+
+#include "fileio.h"
+#include "codec.h"
+
+// Collects a number of sections in memory and writes them to a file
+// along with a section directory. Each section is compressed
+// separately, so readers can later access any section without having
+// to decode the ones before it.
+class ChunkWriter {
+public:
+  ChunkWriter( void ) : codec(Codec::GetDefault()) {}
+  ~ChunkWriter( void );
+
+  MemBuffer &AddSection( unsigned long id );
+  void SetCodec( unsigned char codec ) { this->codec = codec; }
+  int Write( MemBuffer &file ) const;
+
+private:
+  unsigned char codec;
+  vector<unsigned long> ids;
+  vector<DynBuffer *> sections;
+};
+
+// Reads the section directory and the (encoded) section data from a
+// file. Sections are only decoded when they are requested.
+class ChunkReader {
+public:
+  ChunkReader( void ) {}
+  ~ChunkReader( void );
+
+  int Load( MemBuffer &file, unsigned long last = 0 );
+  MemoryBuffer *GetSection( unsigned long id );
+
+  unsigned short NumSections( void ) const { return chunks.size(); }
+  unsigned long GetSectionID( unsigned short i ) const
+    { return chunks[i].id; }
+
+private:
+  struct Chunk {
+    unsigned long id;
+    unsigned long size;       // decoded size
+    unsigned long stored;     // encoded size
+    unsigned char codec;
+    unsigned char *data;      // encoded data, NULL once decoded
+    MemoryBuffer *buf;        // decoded data
+  };
+
+  vector<Chunk> chunks;
+};
+
+#endif	/* _INCLUDE_CHUNKFILE_H */
+
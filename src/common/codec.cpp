@@ -0,0 +1,344 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2007 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// codec.cpp
+//
+// The LZ codec uses a simple byte oriented format. Each block starts
+// with a control byte c:
+//
+//   c < 32   c + 1 literal bytes follow
+//   c >= 32  back reference; the length (minus 2) is stored in the
+//            upper 3 bits of c. If all three are set, another byte
+//            follows which is added to the length. The next byte
+//            together with the lower 5 bits of c holds the distance
+//            (minus 1) to the start of the match.
+//
+// It doesn't compress as well as deflate but is several times faster
+// in both directions.
+////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#ifdef HAVE_LIBZ
+# include <zlib.h>
+#endif
+
+#include "codec.h"
+
+#define LZ_HASH_BITS    13
+#define LZ_MAX_LIT      32
+#define LZ_MAX_OFF      8192
+#define LZ_MAX_MATCH    (7 + 255 + 2)
+
+unsigned char Codec::default_codec = CODEC_DEFLATE;
+
+class StoreCodec : public Codec {
+public:
+  const char *Name( void ) const { return "none"; }
+  unsigned long Bound( unsigned long len ) const { return len; }
+  unsigned long MaxRatio( void ) const { return 1; }
+
+  int Encode( const unsigned char *src, unsigned long len,
+              unsigned char *dst, unsigned long &dstlen ) const;
+  int Decode( const unsigned char *src, unsigned long len,
+              unsigned char *dst, unsigned long dstlen ) const;
+};
+
+class LZCodec : public Codec {
+public:
+  const char *Name( void ) const { return "fast"; }
+  unsigned long Bound( unsigned long len ) const
+    { return len + len / LZ_MAX_LIT + 1; }
+  // the longest match is encoded in three bytes
+  unsigned long MaxRatio( void ) const { return LZ_MAX_MATCH / 3; }
+
+  int Encode( const unsigned char *src, unsigned long len,
+              unsigned char *dst, unsigned long &dstlen ) const;
+  int Decode( const unsigned char *src, unsigned long len,
+              unsigned char *dst, unsigned long dstlen ) const;
+};
+
+#ifdef HAVE_LIBZ
+class DeflateCodec : public Codec {
+public:
+  const char *Name( void ) const { return "best"; }
+  unsigned long Bound( unsigned long len ) const
+    { return compressBound( len ); }
+  unsigned long MaxRatio( void ) const { return 1032; }
+
+  int Encode( const unsigned char *src, unsigned long len,
+              unsigned char *dst, unsigned long &dstlen ) const;
+  int Decode( const unsigned char *src, unsigned long len,
+              unsigned char *dst, unsigned long dstlen ) const;
+};
+#endif
+
+static StoreCodec store_codec;
+static LZCodec lz_codec;
+#ifdef HAVE_LIBZ
+static DeflateCodec deflate_codec;
+#endif
+
+// indexed by codec ID; codecs which are not available in this build
+// are NULL
+static const Codec *codecs[CODEC_COUNT] = {
+  &store_codec,
+#ifdef HAVE_LIBZ
+  &deflate_codec,
+#else
+  0,
+#endif
+  &lz_codec
+};
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Codec::Get
+// DESCRIPTION: Get the codec for an identifier.
+// PARAMETERS : id - codec identifier
+// RETURNS    : codec or NULL if the codec is unknown or has not been
+//              compiled in
+////////////////////////////////////////////////////////////////////////
+
+const Codec *Codec::Get( unsigned char id ) {
+  return (id < CODEC_COUNT) ? codecs[id] : 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Codec::Find
+// DESCRIPTION: Look up a codec by name.
+// PARAMETERS : name - codec name
+// RETURNS    : codec identifier or -1 if no codec of that name is
+//              available
+////////////////////////////////////////////////////////////////////////
+
+int Codec::Find( const char *name ) {
+  for ( int i = 0; i < CODEC_COUNT; ++i ) {
+    if ( codecs[i] && !strcmp( codecs[i]->Name(), name ) ) return i;
+  }
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : StoreCodec::Encode
+// DESCRIPTION: Copy data without compression.
+// PARAMETERS : src    - data to encode
+//              len    - length of src
+//              dst    - destination buffer
+//              dstlen - size of the destination buffer when called;
+//                       set to the number of bytes written on return
+// RETURNS    : 0 on success, -1 if dst is too small
+////////////////////////////////////////////////////////////////////////
+
+int StoreCodec::Encode( const unsigned char *src, unsigned long len,
+                        unsigned char *dst, unsigned long &dstlen ) const {
+  if ( dstlen < len ) return -1;
+  memcpy( dst, src, len );
+  dstlen = len;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : StoreCodec::Decode
+// DESCRIPTION: Copy uncompressed data.
+// PARAMETERS : src    - encoded data
+//              len    - length of src
+//              dst    - destination buffer
+//              dstlen - expected size of the decoded data
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int StoreCodec::Decode( const unsigned char *src, unsigned long len,
+                        unsigned char *dst, unsigned long dstlen ) const {
+  if ( dstlen != len ) return -1;
+  memcpy( dst, src, len );
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : LZCodec::Encode
+// DESCRIPTION: Compress a block of data. Matches are found using a
+//              hash of the next three bytes. Only the most recent
+//              position for each hash value is remembered.
+// PARAMETERS : src    - data to encode
+//              len    - length of src
+//              dst    - destination buffer
+//              dstlen - size of the destination buffer when called;
+//                       set to the number of bytes written on return
+// RETURNS    : 0 on success, -1 if dst is too small
+////////////////////////////////////////////////////////////////////////
+
+int LZCodec::Encode( const unsigned char *src, unsigned long len,
+                     unsigned char *dst, unsigned long &dstlen ) const {
+  unsigned long table[1 << LZ_HASH_BITS];  // positions + 1; 0 is unused
+  unsigned long ip = 0, op = 0, lit = 0;
+
+  memset( table, 0, sizeof(table) );
+
+  while ( ip < len ) {
+    unsigned long mlen = 0, ref = 0;
+
+    if ( ip + 2 < len ) {
+      unsigned long h = (src[ip] << 16) | (src[ip+1] << 8) | src[ip+2];
+      h = ((h * 2654435761UL) >> (32 - LZ_HASH_BITS)) & ((1 << LZ_HASH_BITS) - 1);
+
+      ref = table[h];
+      table[h] = ip + 1;
+
+      if ( ref && (ip - ref < LZ_MAX_OFF) ) {
+        --ref;
+        unsigned long max = len - ip;
+        if ( max > LZ_MAX_MATCH ) max = LZ_MAX_MATCH;
+        while ( (mlen < max) && (src[ref + mlen] == src[ip + mlen]) ) ++mlen;
+        if ( mlen < 3 ) mlen = 0;
+      }
+    }
+
+    if ( mlen == 0 ) {
+      ++ip;
+      if ( ip - lit == LZ_MAX_LIT ) {
+        if ( op + 1 + LZ_MAX_LIT > dstlen ) return -1;
+        dst[op++] = LZ_MAX_LIT - 1;
+        memcpy( &dst[op], &src[lit], LZ_MAX_LIT );
+        op += LZ_MAX_LIT;
+        lit = ip;
+      }
+      continue;
+    }
+
+    // flush pending literals
+    if ( ip > lit ) {
+      unsigned long n = ip - lit;
+      if ( op + 1 + n > dstlen ) return -1;
+      dst[op++] = n - 1;
+      memcpy( &dst[op], &src[lit], n );
+      op += n;
+    }
+
+    unsigned long off = ip - ref - 1;
+    unsigned long l = mlen - 2;
+    if ( op + 3 > dstlen ) return -1;
+    if ( l < 7 ) dst[op++] = (l << 5) | (off >> 8);
+    else {
+      dst[op++] = (7 << 5) | (off >> 8);
+      dst[op++] = l - 7;
+    }
+    dst[op++] = off & 0xFF;
+
+    ip += mlen;
+    lit = ip;
+  }
+
+  if ( ip > lit ) {
+    unsigned long n = ip - lit;
+    if ( op + 1 + n > dstlen ) return -1;
+    dst[op++] = n - 1;
+    memcpy( &dst[op], &src[lit], n );
+    op += n;
+  }
+
+  dstlen = op;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : LZCodec::Decode
+// DESCRIPTION: Decompress a block of data.
+// PARAMETERS : src    - encoded data
+//              len    - length of src
+//              dst    - destination buffer
+//              dstlen - expected size of the decoded data
+// RETURNS    : 0 on success, -1 if the data is corrupt
+////////////////////////////////////////////////////////////////////////
+
+int LZCodec::Decode( const unsigned char *src, unsigned long len,
+                     unsigned char *dst, unsigned long dstlen ) const {
+  unsigned long ip = 0, op = 0;
+
+  while ( ip < len ) {
+    unsigned long c = src[ip++];
+
+    if ( c < LZ_MAX_LIT ) {
+      ++c;
+      if ( (ip + c > len) || (op + c > dstlen) ) return -1;
+      memcpy( &dst[op], &src[ip], c );
+      ip += c;
+      op += c;
+    } else {
+      unsigned long l = c >> 5;
+      if ( l == 7 ) {
+        if ( ip >= len ) return -1;
+        l += src[ip++];
+      }
+      if ( ip >= len ) return -1;
+
+      unsigned long off = (((c & 0x1F) << 8) | src[ip++]) + 1;
+      l += 2;
+      if ( (off > op) || (op + l > dstlen) ) return -1;
+
+      // source and destination may overlap, so copy byte by byte
+      const unsigned char *ref = &dst[op - off];
+      unsigned char *out = &dst[op];
+      op += l;
+      while ( l-- ) *out++ = *ref++;
+    }
+  }
+
+  return (op == dstlen) ? 0 : -1;
+}
+
+#ifdef HAVE_LIBZ
+////////////////////////////////////////////////////////////////////////
+// NAME       : DeflateCodec::Encode
+// DESCRIPTION: Compress a block of data using the zlib format at the
+//              highest compression level.
+// PARAMETERS : src    - data to encode
+//              len    - length of src
+//              dst    - destination buffer
+//              dstlen - size of the destination buffer when called;
+//                       set to the number of bytes written on return
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int DeflateCodec::Encode( const unsigned char *src, unsigned long len,
+                          unsigned char *dst, unsigned long &dstlen ) const {
+  uLongf out = dstlen;
+  if ( compress2( dst, &out, src, len, Z_BEST_COMPRESSION ) != Z_OK )
+    return -1;
+  dstlen = out;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DeflateCodec::Decode
+// DESCRIPTION: Decompress a block of zlib data.
+// PARAMETERS : src    - encoded data
+//              len    - length of src
+//              dst    - destination buffer
+//              dstlen - expected size of the decoded data
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int DeflateCodec::Decode( const unsigned char *src, unsigned long len,
+                          unsigned char *dst, unsigned long dstlen ) const {
+  uLongf out = dstlen;
+  if ( (uncompress( dst, &out, src, len ) != Z_OK) || (out != dstlen) )
+    return -1;
+  return 0;
+}
+#endif
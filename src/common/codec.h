@@ -0,0 +1,60 @@
+// Crimson Fields -- a game of tactical warfare
+// Copyright (C) 2000-2007 Jens Granseuer
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+
+////////////////////////////////////////////////////////////////////////
+// codec.h - compression methods for data file sections
+////////////////////////////////////////////////////////////////////////
+
+#ifndef _INCLUDE_CODEC_H
+#define _INCLUDE_CODEC_H
+
+// codec identifiers; these are stored in the files, so don't change
+// the values of existing codecs
+#define CODEC_STORE     0      // no compression
+#define CODEC_DEFLATE   1      // zlib, best compression
+#define CODEC_LZ        2      // fast LZ77 variant
+#define CODEC_COUNT     3
+
+class Codec {
+public:
+  virtual ~Codec( void ) {}
+
+  // name as used on the command line
+  virtual const char *Name( void ) const = 0;
+
+  // maximum encoded size for len bytes of input
+  virtual unsigned long Bound( unsigned long len ) const = 0;
+  // maximum ratio of decoded to encoded size
+  virtual unsigned long MaxRatio( void ) const = 0;
+
+  virtual int Encode( const unsigned char *src, unsigned long len,
+                      unsigned char *dst, unsigned long &dstlen ) const = 0;
+  virtual int Decode( const unsigned char *src, unsigned long len,
+                      unsigned char *dst, unsigned long dstlen ) const = 0;
+
+  static const Codec *Get( unsigned char id );
+  static int Find( const char *name );
+
+  static void SetDefault( unsigned char id ) { default_codec = id; }
+  static unsigned char GetDefault( void ) { return default_codec; }
+
+private:
+  static unsigned char default_codec;
+};
+
+#endif	/* _INCLUDE_CODEC_H */
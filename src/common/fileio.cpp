@@ -33,15 +33,45 @@
 # ifndef _WIN32_WCE
 #  include <shellapi.h>
 # endif
+#else
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
 #endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <iostream>
 
 #include "SDL_zlib.h"
 #include "fileio.h"
 #include "globals.h"      // for CF_SHORTNAME
+#include "misc.h"
+
+// Asset packs are uncompressed, little-endian containers which can be
+// mapped into memory. A pack starts with a header
+//
+//   u32 FID_PACK, u16 PACK_VERSION, u16 number of sections
+//
+// followed by the section table with one entry per section
+//
+//   u32 section ID, u32 offset from start of file, u32 size
+//
+// Sections start at offsets aligned to PACK_ALIGN. Currently there is
+// only one section type, PACK_SECT_DATA, which contains the exact
+// stream found in the (compressed) data file the pack replaces. The
+// pack for a file <name> is called <name>.pak. If <name> has been
+// modified after the pack was created, the pack is outdated and the
+// file is used instead.
+#define FID_PACK          MakeID('C','P','A','K')
+#define PACK_VERSION      1
+#define PACK_ALIGN        16
+#define PACK_HEADER_SIZE  32
+#define PACK_SECT_DATA    MakeID('D','A','T','A')
+#define PACK_SUFFIX       ".pak"
+
+#define DYNBUFFER_CAPACITY  512
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Directory::Directory
@@ -286,6 +316,265 @@ unsigned char File::Read8( void ) {
   return val;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : file_time
+// DESCRIPTION: Get the time of the last modification of a file.
+// PARAMETERS : path - full path to the file
+// RETURNS    : modification time or 0 if not available
+////////////////////////////////////////////////////////////////////////
+
+static long file_time( const string &path ) {
+  long mtime = 0;
+#ifndef _WIN32_WCE
+  struct stat st;
+
+  if ( stat( path.c_str(), &st ) == 0 ) mtime = st.st_mtime;
+#endif
+  return mtime;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemoryBuffer::Open
+// DESCRIPTION: Read the complete file into memory. Compressed files
+//              are inflated. If an asset pack for the file exists and
+//              is not older than the file, it is used instead.
+// PARAMETERS : -
+// RETURNS    : TRUE on success, FALSE on error
+////////////////////////////////////////////////////////////////////////
+
+bool MemoryBuffer::Open( void ) {
+  if ( data ) return false;
+
+  string pack( name + PACK_SUFFIX );
+  long packtime = file_time( pack );
+  if ( packtime && (file_time( name ) > packtime) )
+    cerr << "Warning: Ignoring outdated asset pack " << pack << endl;
+  else if ( Map( pack ) ) return true;
+
+  File file( name );
+  return file.Open( "rb" ) && Fill( file );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemoryBuffer::OpenData
+// DESCRIPTION: Read the complete file into memory. The file name is
+//              resolved the same way as for File::OpenData(). After a
+//              successful call, MemoryBuffer::Name() returns the full
+//              path to the file.
+// PARAMETERS : subdir - data subdirectory to look in
+// RETURNS    : TRUE on success, FALSE on error
+////////////////////////////////////////////////////////////////////////
+
+bool MemoryBuffer::OpenData( const string &subdir /* = "" */ ) {
+  if ( data ) return false;
+
+  string local( name );
+  name = get_home_dir();
+  if ( !name.empty() ) {
+    append_path( name, subdir );
+    append_path( name, local );
+    if ( Open() ) return true;
+  }
+
+  name = get_data_subdir( subdir );
+  append_path( name, local );
+  return Open();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemoryBuffer::Assign
+// DESCRIPTION: Use a block of memory as buffer contents. The buffer
+//              takes ownership of the memory.
+// PARAMETERS : buf - memory allocated with malloc()
+//              len - size of the block
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MemoryBuffer::Assign( unsigned char *buf, unsigned long len ) {
+  Close();
+  data = buf;
+  datalen = len;
+  mem = data;
+  size = datalen;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemoryBuffer::Close
+// DESCRIPTION: Free the buffer.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MemoryBuffer::Close( void ) {
+#ifndef WIN32
+  if ( mapped ) munmap( data, datalen );
+  else
+#endif
+  free( data );
+
+  data = 0;
+  mem = 0;
+  datalen = size = pos = 0;
+  mapped = false;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemoryBuffer::Fill
+// DESCRIPTION: Read the contents of a file into the buffer. The size
+//              of the uncompressed data is not known in advance, so we
+//              read in large blocks and grow the buffer as required.
+// PARAMETERS : file - opened file
+// RETURNS    : TRUE on success, FALSE on error
+////////////////////////////////////////////////////////////////////////
+
+bool MemoryBuffer::Fill( File &file ) {
+  unsigned long capacity = 0;
+  int got;
+
+  do {
+    if ( capacity - datalen < 0x4000 ) {
+      capacity = (capacity ? capacity * 2 : 0x10000);
+      unsigned char *grown = (unsigned char *)realloc( data, capacity );
+      if ( !grown ) {
+        Close();
+        return false;
+      }
+      data = grown;
+    }
+
+    got = file.Read( &data[datalen], capacity - datalen );
+    if ( got > 0 ) datalen += got;
+  } while ( got > 0 );
+
+  mem = data;
+  size = datalen;
+  pos = 0;
+
+  if ( got < 0 ) Close();
+  return got == 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemoryBuffer::Map
+// DESCRIPTION: Open an asset pack and prepare its data section for
+//              reading. The pack is mapped into memory if the platform
+//              supports it, otherwise it is read in one go.
+// PARAMETERS : path - asset pack file name
+// RETURNS    : TRUE on success, FALSE if the pack does not exist or is
+//              invalid
+////////////////////////////////////////////////////////////////////////
+
+bool MemoryBuffer::Map( const string &path ) {
+#ifdef WIN32
+  File file( path );
+  if ( !file.Open( "rb", false ) || !Fill( file ) ) return false;
+#else
+  int fd = open( path.c_str(), O_RDONLY );
+  if ( fd == -1 ) return false;
+
+  struct stat st;
+  void *addr = MAP_FAILED;
+  if ( (fstat( fd, &st ) == 0) && (st.st_size >= PACK_HEADER_SIZE) )
+    addr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+
+  if ( addr == MAP_FAILED ) return false;
+
+  data = (unsigned char *)addr;
+  datalen = st.st_size;
+  mapped = true;
+  mem = data;
+  size = datalen;
+  pos = 0;
+#endif
+
+  if ( (Read32() == FID_PACK) && (Read16() == PACK_VERSION) ) {
+    unsigned short sections = Read16();
+
+    for ( int i = 0; i < sections; ++i ) {
+      unsigned long id = Read32();
+      unsigned long offset = Read32();
+      unsigned long len = Read32();
+
+      if ( (id == PACK_SECT_DATA) && (len > 0) &&
+           (offset <= datalen) && (len <= datalen - offset) ) {
+        mem = data + offset;
+        size = len;
+        pos = 0;
+        return true;
+      }
+    }
+  }
+
+  cerr << "Warning: Ignoring invalid asset pack " << path << endl;
+  Close();
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : PackFile::Open
+// DESCRIPTION: Create the file for writing and reserve space for the
+//              pack header.
+// PARAMETERS : -
+// RETURNS    : TRUE on success, FALSE on error
+////////////////////////////////////////////////////////////////////////
+
+bool PackFile::Open( void ) {
+  if ( !pack ) return File::Open( "wb" );
+  if ( !File::Open( "wb", false ) ) return false;
+
+  // the section size is filled in when the pack is closed
+  int rc = Write32( FID_PACK );
+  if ( !rc ) rc = Write16( PACK_VERSION );
+  if ( !rc ) rc = Write16( 1 );
+  if ( !rc ) rc = Write32( PACK_SECT_DATA );
+  if ( !rc ) rc = Write32( PACK_HEADER_SIZE );
+  if ( !rc ) rc = Write32( 0 );
+
+  for ( int i = Tell(); (rc == 0) && (i < PACK_HEADER_SIZE); ++i )
+    rc = Write8( 0 );
+
+  return rc == 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : PackFile::Close
+// DESCRIPTION: Finish the pack header and close the file.
+// PARAMETERS : -
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int PackFile::Close( void ) {
+  int rc = 0;
+
+  if ( pack ) {
+    long end = Tell();
+    rc = -1;
+    if ( (end > PACK_HEADER_SIZE) && (Seek( 16 ) == 16) )
+      rc = Write32( end - PACK_HEADER_SIZE );
+  }
+
+  File::Close();
+  return rc;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemoryBuffer::Read
+// DESCRIPTION: Read a number of bytes from the buffer.
+// PARAMETERS : buffer - buffer to read into
+//              size   - amount of data to read
+// RETURNS    : number of bytes read
+////////////////////////////////////////////////////////////////////////
+
+int MemoryBuffer::Read( void *buffer, int size ) {
+  if ( size < 0 ) return 0;
+  if ( (unsigned long)size > this->size - pos ) size = this->size - pos;
+
+  memcpy( buffer, &mem[pos], size );
+  pos += size;
+  return size;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : MemBuffer::ReadS
 // DESCRIPTION: Read a string from the buffer.
@@ -323,6 +612,223 @@ int MemBuffer::WriteS( string value, int len /* = 0 */ ) {
   return rc;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemBuffer::ReadVar
+// DESCRIPTION: Read a variable length number from the buffer. Numbers
+//              are stored in groups of seven bits, least significant
+//              group first. The high bit of each byte is set if more
+//              bytes follow.
+// PARAMETERS : -
+// RETURNS    : number read
+////////////////////////////////////////////////////////////////////////
+
+unsigned long MemBuffer::ReadVar( void ) {
+  unsigned long value = 0;
+  unsigned char c;
+  int shift = 0;
+
+  do {
+    c = Read8();
+    if ( shift < 32 ) value |= (unsigned long)(c & 0x7F) << shift;
+    shift += 7;
+  } while ( c & 0x80 );
+
+  return value & 0xFFFFFFFF;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemBuffer::ReadSVar
+// DESCRIPTION: Read a signed variable length number from the buffer.
+//              The sign is kept in the lowest bit so that numbers
+//              close to 0 remain short (0, -1, 1, -2, ... are stored
+//              as 0, 1, 2, 3, ...).
+// PARAMETERS : -
+// RETURNS    : number read
+////////////////////////////////////////////////////////////////////////
+
+long MemBuffer::ReadSVar( void ) {
+  unsigned long value = ReadVar();
+  if ( value & 1 ) return -(long)(value >> 1) - 1;
+  return value >> 1;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemBuffer::WriteVar
+// DESCRIPTION: Write a variable length number to the buffer. Values up
+//              to 127 only take up a single byte.
+// PARAMETERS : value - number to write (32 bits at most)
+// RETURNS    : -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int MemBuffer::WriteVar( unsigned long value ) {
+  int rc;
+
+  value &= 0xFFFFFFFF;
+  while ( value >= 0x80 ) {
+    rc = Write8( (value & 0x7F) | 0x80 );
+    if ( rc ) return rc;
+    value >>= 7;
+  }
+  return Write8( value );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MemBuffer::WriteSVar
+// DESCRIPTION: Write a signed variable length number to the buffer.
+// PARAMETERS : value - number to write (32 bits at most)
+// RETURNS    : -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int MemBuffer::WriteSVar( long value ) {
+  if ( value < 0 ) return WriteVar( ((unsigned long)(-(value + 1)) << 1) | 1 );
+  return WriteVar( (unsigned long)value << 1 );
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DynBuffer::DynBuffer
+// DESCRIPTION: Create a new dynamic buffer with the default capacity in
+//              memory. When using the Write*() methods defined for this
+//              class, the buffer will grow dynamically as required.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+DynBuffer::DynBuffer( void ) : mem(0), size(0), capacity(0), pos(0) {
+  Init( DYNBUFFER_CAPACITY );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DynBuffer::DynBuffer
+// DESCRIPTION: Create a new buffer in memory.
+// PARAMETERS : capacity - desired initial buffer size
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+DynBuffer::DynBuffer( unsigned long capacity ) : mem(0), size(0), capacity(0), pos(0) {
+  Init( capacity );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DynBuffer::~DynBuffer
+// DESCRIPTION: Free the buffer.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+DynBuffer::~DynBuffer( void ) {
+  if (mem) free( mem );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DynBuffer::Init
+// DESCRIPTION: Initialize a new buffer in memory.
+// PARAMETERS : len - desired initial buffer size
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int DynBuffer::Init( unsigned long len ) {
+  mem = (char *)malloc( len );
+
+  if (mem) {
+    capacity = len;
+    return 0;
+  }
+
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DynBuffer::CheckResize
+// DESCRIPTION: Check whether a given amount of data fits into the
+//              currently allocated buffer. If it doesn't, resize the
+//              buffer.
+// PARAMETERS : len - total amount of data that the buffer must be able
+//                    to hold
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int DynBuffer::CheckResize( unsigned long len ) {
+  int rc = 0;
+
+  if (len > capacity)  {
+    unsigned long new_capacity = MAX( len, capacity * 2 );
+    char *new_mem = (char *)realloc( mem, new_capacity );
+
+    if (new_mem) {
+      mem = new_mem;
+      capacity = new_capacity;
+    } else
+      rc = -1;
+  }
+
+  return rc;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DynBuffer::SetSize
+// DESCRIPTION: Set buffer to a given size. Current position inside the
+//              buffer is not modified, unless the buffer size is
+//              reduced and the position is outside the valid buffer
+//              after the resize. In that case, position is moved to the
+//              end of the buffer.
+// PARAMETERS : size - size to set
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int DynBuffer::SetSize( unsigned long size ) {
+  int rc;
+
+  if (size > capacity) {
+    rc = CheckResize( size );
+  } else {
+    // buffer reduction will always succeed
+    rc = 0;
+    pos = MIN( size, pos );
+  }
+
+  this->size = size;
+  return rc;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DynBuffer::Read
+// DESCRIPTION: Read a number of bytes from the buffer.
+// PARAMETERS : buffer - buffer to read into
+//              size   - amount of data to read
+// RETURNS    : number of bytes read, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int DynBuffer::Read( void *buffer, int size ) {
+  if (pos + size > this->size)
+    return -1;
+
+  memcpy( buffer, &mem[pos], size );
+  pos += size;
+
+  return size;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : DynBuffer::Write
+// DESCRIPTION: Write a number of bytes to the buffer.
+// PARAMETERS : buffer - buffer to read from
+//              size   - amount of data to write
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int DynBuffer::Write( const void *buffer, int size ) {
+  if (CheckResize( pos + size ) != 0) {
+    return -1;
+  }
+
+  memcpy( &mem[pos], buffer, size );
+  pos += size;
+  if (pos > this->size) this->size = pos;
+
+  return 0;
+}
+
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : append_path_delim
@@ -603,3 +1109,45 @@ void append_path( string &path, const string &sub ) {
   path.append( sub );
 }
 
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : find_data_file
+// DESCRIPTION: Locate a data file without opening it. The search order
+//              is the same as for File::OpenData() and
+//              MemoryBuffer::OpenData(), and asset packs are taken into
+//              account.
+// PARAMETERS : name   - file name relative to the data (sub)directory
+//              subdir - data subdirectory to look in
+// RETURNS    : full path to the file (excluding the pack suffix) or an
+//              empty string if it does not exist
+////////////////////////////////////////////////////////////////////////
+
+string find_data_file( const string &name, const string &subdir /* = "" */ ) {
+  string path( get_home_dir() );
+
+  if ( !path.empty() ) {
+    append_path( path, subdir );
+    append_path( path, name );
+    if ( File::Exists( path + PACK_SUFFIX ) || File::Exists( path ) )
+      return path;
+  }
+
+  path = get_data_subdir( subdir );
+  append_path( path, name );
+  if ( File::Exists( path + PACK_SUFFIX ) || File::Exists( path ) )
+    return path;
+
+  return "";
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : data_file_time
+// DESCRIPTION: Get the time of the last modification of a data file or
+//              its asset pack, whichever is newer.
+// PARAMETERS : path - full path to the file
+// RETURNS    : modification time or 0 if not available
+////////////////////////////////////////////////////////////////////////
+
+long data_file_time( const string &path ) {
+  return MAX( file_time( path ), file_time( path + PACK_SUFFIX ) );
+}
@@ -95,12 +95,19 @@ public:
   virtual unsigned short Read16( void ) = 0;
   virtual unsigned long Read32( void ) = 0;
   string ReadS( int size );
+  unsigned long ReadVar( void );
+  long ReadSVar( void );
 
   virtual int Write( const void *values, int size ) = 0;
   virtual int Write8( unsigned char value ) = 0;
   virtual int Write16( unsigned short value ) = 0;
   virtual int Write32( unsigned long value ) = 0;
   int WriteS( string value, int len = 0 );
+  int WriteVar( unsigned long value );
+  int WriteSVar( long value );
+
+  // number of bytes left to read, or -1 if not known
+  virtual long Remaining( void ) const { return -1; }
 };
 
 // file abstraction to encapsulate SDL file access layer
@@ -127,6 +134,8 @@ public:
   bool Open( const char *mode, bool compressed = true );
   bool OpenData( const char *mode, const string &subdir = "", bool compressed = true );
   void Close( void );
+  int Seek( long offset ) { return SDL_RWseek(fh, offset, SEEK_SET); }
+  long Tell( void ) const { return SDL_RWtell(fh); }
   static bool Exists( const string &name );
   const string &Name( void ) const { return name; }
 
@@ -135,6 +144,119 @@ private:
   string name;
 };
 
+// growing buffer in memory
+class DynBuffer : public MemBuffer {
+public:
+  DynBuffer( void );
+  DynBuffer( unsigned long capacity );
+  ~DynBuffer( void );
+
+  unsigned long Size( void ) const { return size; }
+  int SetSize( unsigned long size );
+  void Clear( void ) { size = pos = 0; }
+  void Rewind( void ) { pos = 0; }
+  long Remaining( void ) const { return size - pos; }
+
+  int Read( void *buffer, int size );
+  unsigned char Read8( void ) { return mem[pos++]; }
+  unsigned short Read16( void )
+    { unsigned short v = SDL_SwapLE16( *((Uint16 *)&mem[pos]) ); pos += 2; return v; }
+  unsigned long Read32( void )
+    { unsigned long v = SDL_SwapLE32( *((Uint32 *)&mem[pos]) ); pos += 4; return v; }
+
+  int Write( const void *values, int size );
+  int Write8( unsigned char value ) { return Write( &value, 1 ); }
+  int Write16( unsigned short value )
+    { value = SDL_SwapLE16( value ); return Write( &value, 2 ); }
+  int Write32( unsigned long value )
+    { value = SDL_SwapLE32( value ); return Write( &value, 4 ); }
+
+  char *GetData( void ) const { return mem; }
+
+private:
+  int Init( unsigned long len );
+  int CheckResize( unsigned long len );
+
+  char *mem;
+  unsigned long size;
+  unsigned long capacity;
+  unsigned long pos;
+};
+
+// read-only buffer holding the complete contents of a file. The file
+// is read (and inflated if necessary) in one go when it is opened, so
+// parsing lots of small values does not result in lots of tiny reads
+// from the underlying file. If an uncompressed asset pack (see
+// PackFile) for the file is available it is used instead, and mapped
+// into memory where supported.
+class MemoryBuffer : public MemBuffer {
+public:
+  MemoryBuffer( void ) :
+    data(0), datalen(0), mapped(false), mem(0), size(0), pos(0) {}
+  MemoryBuffer( const string &path ) :
+    data(0), datalen(0), mapped(false), mem(0), size(0), pos(0), name(path) {}
+  ~MemoryBuffer( void ) { Close(); }
+
+  // bounds-checked readers; reading beyond the end of the buffer
+  // yields 0 and leaves the read position at the end
+  int Read( void *buffer, int size );
+  unsigned char Read8( void )
+      { return (pos < size) ? mem[pos++] : 0; }
+  unsigned short Read16( void ) {
+      if ( size - pos < 2 ) { pos = size; return 0; }
+      unsigned short v = mem[pos] | (mem[pos+1] << 8);
+      pos += 2;
+      return v; }
+  unsigned long Read32( void ) {
+      if ( size - pos < 4 ) { pos = size; return 0; }
+      unsigned long v = mem[pos] | (mem[pos+1] << 8) |
+                        (mem[pos+2] << 16) | ((unsigned long)mem[pos+3] << 24);
+      pos += 4;
+      return v; }
+
+  int Write( const void *values, int size ) { return -1; }
+  int Write8( unsigned char value ) { return -1; }
+  int Write16( unsigned short value ) { return -1; }
+  int Write32( unsigned long value ) { return -1; }
+
+  bool Open( void );
+  bool OpenData( const string &subdir = "" );
+  void Assign( unsigned char *buf, unsigned long len );
+  void Close( void );
+  const string &Name( void ) const { return name; }
+
+  unsigned long Size( void ) const { return size; }
+  long Remaining( void ) const { return size - pos; }
+  const unsigned char *GetData( void ) const { return mem; }
+
+private:
+  bool Fill( File &file );
+  bool Map( const string &path );
+
+  unsigned char *data;       // file contents or mapping
+  unsigned long datalen;
+  bool mapped;
+  const unsigned char *mem;  // start of the data to parse
+  unsigned long size;
+  unsigned long pos;
+  string name;
+};
+
+// writer for asset packs. A pack contains a single data section which
+// holds exactly what would otherwise be written to a compressed data
+// file. If pack is FALSE a standard compressed file is created. Note
+// that the pack is only valid after PackFile::Close() has been called.
+class PackFile : public File {
+public:
+  PackFile( const string &path, bool pack = true ) : File(path), pack(pack) {}
+
+  bool Open( void );
+  int Close( void );
+
+private:
+  bool pack;
+};
+
 string get_config_dir( void );
 string get_home_dir( void );
 string get_save_dir( void );
@@ -147,6 +269,9 @@ string get_locale_dir( void );
 string get_home_levels_dir( void );
 void create_config_dir( void );
 
+string find_data_file( const string &name, const string &subdir = "" );
+long data_file_time( const string &path );
+
 string file_part( const string &path );
 void append_path( string &path, const string &sub );
 void append_path_delim( string &path );
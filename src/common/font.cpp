@@ -30,9 +30,24 @@
 ////////////////////////////////////////////////////////////////////////
 
 Font::~Font( void ) {
+  Flush();
   if ( f ) TTF_CloseFont( f );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Font::Flush
+// DESCRIPTION: Discard all cached lines and widths.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Font::Flush( void ) {
+  for ( list<CachedLine>::iterator i = lines.begin(); i != lines.end(); ++i )
+    SDL_FreeSurface( i->s );
+  lines.clear();
+  widths.clear();
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Font::Load
 // DESCRIPTION: Load a font from a data file.
@@ -45,6 +60,8 @@ int Font::Load( const char *file, int size ) {
   // SDL_ttf segfaults if the font is not present...
   if ( File::Exists( file ) ) {
 
+    Flush();
+    if ( f ) TTF_CloseFont( f );
     f = TTF_OpenFont( file, size );
 
     if ( f ) {
@@ -92,11 +109,8 @@ unsigned short Font::TextWidth( const char *str ) const {
 
   do {
     pos = buf.find( '\n', prev );
-    int w;
-
-    string sub( buf.substr( prev, pos - prev ) );
 
-    TTF_SizeUTF8( f, sub.c_str(), &w, 0 );
+    unsigned short w = LineWidth( buf.substr( prev, pos - prev ) );
 
     if ( w > maxw ) maxw = w;
     prev = pos + 1;
@@ -104,6 +118,27 @@ unsigned short Font::TextWidth( const char *str ) const {
   return maxw;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Font::LineWidth
+// DESCRIPTION: Calculate the length of a single line of text in
+//              pixels. Results are cached.
+// PARAMETERS : line - string without newlines
+// RETURNS    : length of line in pixels
+////////////////////////////////////////////////////////////////////////
+
+unsigned short Font::LineWidth( const string &line ) const {
+  map<string, unsigned short>::const_iterator i = widths.find( line );
+  if ( i != widths.end() ) return i->second;
+
+  int w = 0;
+  TTF_SizeUTF8( f, line.c_str(), &w, 0 );
+
+  // no need to be clever, just start over when the cache is full
+  if ( widths.size() >= FONT_WIDTH_CACHE ) widths.clear();
+  widths[line] = w;
+  return w;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Font::TextHeight
 // DESCRIPTION: Calculate the height of a string in pixels.
@@ -197,18 +232,63 @@ void Font::SetColor( const Color &fcol ) {
 ////////////////////////////////////////////////////////////////////////
 
 int Font::Write( const char *str, Surface *dest, short x, short y ) const {
-  SDL_Color scol = { col.r, col.g, col.b };
-  SDL_Surface *s = TTF_RenderUTF8_Blended( f, str, scol );
+  SDL_Surface *s = RenderLine( str );
   if ( s ) {
     SDL_Rect src = { 0, 0, s->w, s->h };
     SDL_Rect dst = { x, y, s->w, s->h };
     SDL_BlitSurface( s, &src, dest->s_surface, &dst );
-    SDL_FreeSurface( s );
     return src.w;
   }
   return 0;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Font::RenderLine
+// DESCRIPTION: Get a rendered string in the current font colour. The
+//              surface is taken from the line cache if possible.
+//              Otherwise the string is rendered and added to the
+//              cache, replacing the line which has not been used for
+//              the longest time if the cache is full.
+// PARAMETERS : str - string
+// RETURNS    : rendered string or NULL on error; the surface is owned
+//              by the font and must not be freed by the caller
+////////////////////////////////////////////////////////////////////////
+
+SDL_Surface *Font::RenderLine( const char *str ) const {
+  for ( list<CachedLine>::iterator i = lines.begin(); i != lines.end(); ++i ) {
+    if ( (i->col == col) && (i->text == str) ) {
+      lines.splice( lines.begin(), lines, i );
+      return i->s;
+    }
+  }
+
+  SDL_Color scol = { col.r, col.g, col.b };
+  SDL_Surface *s = TTF_RenderUTF8_Blended( f, str, scol );
+  if ( !s ) return NULL;
+
+  // convert to the display format so that blits don't need to
+  // convert the pixels each time
+  if ( SDL_WasInit( SDL_INIT_VIDEO ) && SDL_GetVideoSurface() ) {
+    SDL_Surface *conv = SDL_DisplayFormatAlpha( s );
+    if ( conv ) {
+      SDL_FreeSurface( s );
+      s = conv;
+    }
+  }
+
+  if ( lines.size() >= FONT_LINE_CACHE ) {
+    SDL_FreeSurface( lines.back().s );
+    lines.pop_back();
+  }
+
+  CachedLine line;
+  line.text = str;
+  line.col = col;
+  line.s = s;
+  lines.push_front( line );
+  return s;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Font::Write
 // DESCRIPTION: Print a string to a surface with clipping.
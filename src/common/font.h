@@ -23,9 +23,20 @@
 #ifndef _INCLUDE_FONT_H
 #define _INCLUDE_FONT_H
 
+#include <list>
+#include <map>
+#include <string>
+using namespace std;
+
 #include "SDL_ttf.h"
 #include "surface.h"
 
+// Rendering and measuring text with SDL_ttf is expensive, and most
+// strings are drawn over and over again. Each font keeps the most
+// recently rendered lines and the widths of recently measured strings.
+#define FONT_LINE_CACHE   48    // number of rendered lines kept
+#define FONT_WIDTH_CACHE  1024  // number of string widths kept
+
 class Font {
 public:
   Font( void ) { f = 0; }
@@ -51,11 +62,24 @@ public:
   int WriteEllipsis( const char *str, Surface *dest, short x, short y, const Rect &clip ) const;
 
 private:
+  struct CachedLine {
+    string text;
+    Color col;
+    SDL_Surface *s;
+  };
+
+  SDL_Surface *RenderLine( const char *str ) const;
+  unsigned short LineWidth( const string &line ) const;
+  void Flush( void );
+
   TTF_Font *f;
   unsigned char width;
   unsigned char height;
 
   Color col;
+
+  mutable list<CachedLine> lines;   // most recently used first
+  mutable map<string, unsigned short> widths;
 };
 
 #endif	/* _INCLUDE_FONT_H */
@@ -27,16 +27,15 @@
 // NAME       : UnitInfoWindow::UnitInfoWindow
 // DESCRIPTION: Pop up a window with information about the given unit
 //              type.
-// PARAMETERS : utype - unit type ID
+// PARAMETERS : type  - unit type
 //              map   - map
 //              view  - view the window will be attached to
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
 
-UnitInfoWindow::UnitInfoWindow( unsigned short utype, const Map &map,
-        View *view ) : Window(WIN_CENTER, view), unit(utype),
+UnitInfoWindow::UnitInfoWindow( const UnitType *type, const Map &map,
+        View *view ) : Window(WIN_CENTER, view), unit(type),
                        uset(map.GetUnitSet()), tset(map.GetTerrainSet()) {
-  const UnitType *type = uset->GetUnitInfo( utype );
   unsigned short width = MAX( sfont->Width() * 24, uset->TileWidth() * 4) + 20,
                  height = uset->TileHeight() + uset->TileShiftY() +
                           ICON_HEIGHT * 2 + sfont->Height() + 30;
@@ -111,20 +110,18 @@ GUI_Status UnitInfoWindow::HandleEvent( const SDL_Event &event ) {
 ////////////////////////////////////////////////////////////////////////
 // NAME       : UnitInfoWindow::DrawUnitInfo
 // DESCRIPTION: Display unit type information.
-// PARAMETERS : uid  - unit ID (may be <0 to clear the rect area)
-//              uset - unit set (may be NULL if uid < 0)
-//              tset - terrain set (may be NULL if uid < 0)
+// PARAMETERS : type - unit type (may be NULL to clear the rect area)
+//              uset - unit set (may be NULL if type is NULL)
+//              tset - terrain set (may be NULL if type is NULL)
 //              dest - destination window
 //              rect - rectangle in which to display
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
 
-void UnitInfoWindow::DrawUnitInfo( short uid, const UnitSet *uset,
+void UnitInfoWindow::DrawUnitInfo( const UnitType *type, const UnitSet *uset,
      const TerrainSet *tset, Window *dest, const Rect &rect ) {
-  const UnitType *type;
-
   dest->DrawBox( rect, BOX_CARVED );
-  if ( (uid < 0) || ((type = uset->GetUnitInfo(uid)) == NULL) ) return;
+  if ( !type ) return;
 
   char buf[12];
   short xpos, ypos, xspacing, yspacing, terbreak;
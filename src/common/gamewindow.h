@@ -30,19 +30,19 @@
 // unit type information window
 class UnitInfoWindow : public Window {
 public:
-  UnitInfoWindow( unsigned short utype, const Map &map,
+  UnitInfoWindow( const UnitType *type, const Map &map,
                   View *view );
 
   void Draw( void );
   GUI_Status HandleEvent( const SDL_Event &event );
 
-  static void DrawUnitInfo( short uid, const UnitSet *uset,
+  static void DrawUnitInfo( const UnitType *type, const UnitSet *uset,
                             const TerrainSet *tset,
                             Window *dest, const Rect &rect );
 private:
   Rect image;
   Rect info;
-  unsigned short unit;
+  const UnitType *unit;
   const UnitSet *uset;
   const TerrainSet *tset;
   Surface *portrait;
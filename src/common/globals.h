@@ -50,9 +50,19 @@
 #define CF_MUSIC_DEFAULT	"default"
 #define CF_MUSIC_FADE_TIME	2000
 
-#define FILE_VERSION  13
+#define FILE_VERSION  14
+#define FILE_VERSION_MONOLITHIC  13    /* last version without sections */
 #define FID_MISSION   MakeID('M','S','S','N')  /* mission file identifier */
 
+/* mission file sections */
+#define SECT_HEADER   MakeID('H','E','A','D')  /* game info, players, messages */
+#define SECT_MAP      MakeID('M','A','P',' ')
+#define SECT_SETS     MakeID('S','E','T','S')  /* unit and terrain set names */
+#define SECT_OBJECTS  MakeID('O','B','J','S')  /* shops, units, battles, events */
+#define SECT_TEXT     MakeID('T','E','X','T')  /* internal messages */
+#define SECT_HISTORY  MakeID('H','I','S','T')  /* turn history (saves only) */
+#define SECT_HISTDELTA MakeID('H','D','L','T') /* compact turn history */
+
 #define DISPLAY_BPP	16	/* display depth */
 
 #define MIN_XRES	240
@@ -36,5 +36,14 @@ int Distance( const Point &s, const Point &t );
 Direction Hex2Dir( const Point &src, const Point &dest );
 bool NextTo( const Point &p1, const Point &p2 );
 
+// interface for objects which need to know when the contents of a
+// hex change, e.g. to update the display
+class HexObserver {
+public:
+  virtual ~HexObserver( void ) {}
+  virtual void HexChanged( const Point &hex ) = 0;
+  virtual void TerrainChanged( const Point &hex ) { HexChanged( hex ); }
+};
+
 #endif	/* _INCLUDE_HEXSUP_H */
 
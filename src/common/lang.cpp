@@ -33,10 +33,10 @@
 ////////////////////////////////////////////////////////////////////////
 
 int Language::ReadCatalog( const char *catalog ) {
-  File file( catalog );
+  MemoryBuffer file( catalog );
   int rc = -1;
 
-  if ( file.Open( "rb" ) &&
+  if ( file.Open() &&
        (file.Read32() == FID_CATALOG) &&
        (file.Read8() == CF_CATALOG_VERSION) ) {
     unsigned char len = file.Read8();
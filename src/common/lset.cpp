@@ -24,9 +24,19 @@
 #include "fileio.h"
 #include "misc.h"
 
-#define FOG_ALPHA 128
 #define IMG_FOG   1
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : TileSet::~TileSet
+// DESCRIPTION: Destroy the tile set and all its reduced copies.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+TileSet::~TileSet( void ) {
+  for ( unsigned int i = 0; i < zoomed.size(); ++i ) delete zoomed[i];
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TileSet::Load
 // DESCRIPTION: Load a tile set from a file. This only reads the image
@@ -42,13 +52,72 @@ int TileSet::Load( MemBuffer &file, const char *setname ) {
 
   int rc = tiles.LoadImageData( file, true );
   if ( !rc ) {
-    tiles.DisplayFormat();
+    InitTiles();
     name.assign( setname );
   }
 
   return rc;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : TileSet::InitTiles
+// DESCRIPTION: Prepare the image sheet for drawing. The sheet is
+//              converted to the display format so that blits need not
+//              convert the pixels. If the display has not been
+//              initialized the sheet is left unchanged. The source
+//              rectangles of all images are calculated here as well.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void TileSet::InitTiles( void ) {
+  tiles.DisplayFormat();
+
+  unsigned short gfx_per_line = tiles.Width() / TileWidth();
+  unsigned short lines = tiles.Height() / TileHeight();
+
+  tile_rects.clear();
+  tile_rects.reserve( gfx_per_line * lines );
+  for ( unsigned short y = 0; y < lines; ++y ) {
+    for ( unsigned short x = 0; x < gfx_per_line; ++x )
+      tile_rects.push_back( Rect( x * TileWidth(), y * TileHeight(),
+                                  TileWidth(), TileHeight() ) );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : TileSet::Zoomed
+// DESCRIPTION: Get a reduced copy of the tile set. The copy is created
+//              when it is first requested.
+// PARAMETERS : level - zoom level (0 .. TILE_ZOOM_LEVELS - 1)
+// RETURNS    : tile set for the given zoom level; if the level is
+//              invalid or the copy could not be created the set itself
+//              is returned, so check Zoom() on the result
+////////////////////////////////////////////////////////////////////////
+
+const TileSet *TileSet::Zoomed( unsigned char level ) const {
+  if ( (level == zoom) || (zoom != 0) || (level >= TILE_ZOOM_LEVELS) )
+    return this;
+
+  if ( zoomed.empty() ) zoomed.assign( TILE_ZOOM_LEVELS, NULL );
+
+  if ( !zoomed[level] ) {
+    TileSet *set = new TileSet;
+    if ( tiles.ScaleDown( set->tiles, 1 << level ) ) {
+      delete set;
+      return this;
+    }
+
+    set->zoom = level;
+    set->num_tiles = num_tiles;
+    set->name = name;
+    set->InitTiles();
+    zoomed[level] = set;
+  }
+
+  return zoomed[level];
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TileSet::DrawTile
 // DESCRIPTION: Draw a tile image to a surface.
@@ -62,26 +131,59 @@ int TileSet::Load( MemBuffer &file, const char *setname ) {
 
 void TileSet::DrawTile( unsigned short n, Surface *dest,
                         short px, short py, const Rect &clip ) const {
+  if ( n >= tile_rects.size() ) return;
+
+  const Rect &src = tile_rects[n];
+
+  // images which are completely visible need not be clipped
+  if ( (px >= clip.x) && (py >= clip.y) &&
+       (px + src.w <= clip.x + clip.w) && (py + src.h <= clip.y + clip.h) ) {
+    tiles.LowerBlit( dest, src, px, py );
+    return;
+  }
+
   // set up destination
-  Rect dstrect( px, py, TileWidth(), TileHeight() );
+  Rect dstrect( px, py, src.w, src.h );
   if ( dstrect.x + dstrect.w < clip.x ) return;
   if ( dstrect.y + dstrect.h < clip.y ) return;
   if ( dstrect.x >= clip.x + clip.w ) return;
   if ( dstrect.y >= clip.y + clip.h ) return;
 
-  // set up source
-  Rect srcrect;
-  unsigned short gfx_per_line = tiles.Width() / TileWidth();
-  srcrect.x = (n % gfx_per_line) * TileWidth();
-  srcrect.y = (n / gfx_per_line) * TileHeight();
-  srcrect.w = dstrect.w;
-  srcrect.h = dstrect.h;
-
   // clip and blit to surface
+  Rect srcrect( src );
   dstrect.ClipBlit( srcrect, clip );
   tiles.LowerBlit( dest, srcrect, dstrect.x, dstrect.y );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : TileSet::DrawTiles
+// DESCRIPTION: Draw a number of tile images to a surface. This is
+//              faster than calling DrawTile() for each of them, since
+//              for most tiles it is sufficient to check whether they
+//              start inside the area in which tiles are visible as a
+//              whole.
+// PARAMETERS : blits - images and positions
+//              count - number of entries in blits
+//              dest  - destination surface
+//              clip  - clipping rectangle
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void TileSet::DrawTiles( const TileBlit *blits, unsigned int count,
+                         Surface *dest, const Rect &clip ) const {
+  const short x1 = clip.x, y1 = clip.y;
+  const short x2 = clip.x + clip.w - TileWidth();
+  const short y2 = clip.y + clip.h - TileHeight();
+  const unsigned int images = tile_rects.size();
+
+  for ( const TileBlit *b = blits; b < blits + count; ++b ) {
+    if ( (b->x >= x1) && (b->x <= x2) && (b->y >= y1) && (b->y <= y2) &&
+         (b->n < images) )
+      tiles.LowerBlit( dest, tile_rects[b->n], b->x, b->y );
+    else DrawTile( b->n, dest, b->x, b->y, clip );
+  }
+}
+
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : UnitSet::UnitSet
@@ -105,6 +207,9 @@ UnitSet::UnitSet( void ) {
 ////////////////////////////////////////////////////////////////////////
 
 UnitSet::~UnitSet( void ) {
+  for ( map<string, UnitType *>::iterator it = localized.begin();
+        it != localized.end(); ++it )
+    delete [] it->second;
   delete [] ut;
   if ( sfx ) {
     for ( int i = 0; i < num_sfx; ++i ) delete sfx[i];
@@ -125,6 +230,34 @@ const UnitType *UnitSet::GetUnitInfo( unsigned short utid ) const {
   return NULL;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : UnitSet::GetUnitTypes
+// DESCRIPTION: Get the unit types with their names in a certain
+//              language. Sets are shared between missions, so the
+//              names of the set itself are never changed. Instead,
+//              each language gets a copy of the type definitions,
+//              which is kept until the set is destroyed.
+// PARAMETERS : lang - locale identifier
+// RETURNS    : array of unit types, indexed by type ID; if the
+//              language is not available the default names are used
+////////////////////////////////////////////////////////////////////////
+
+const UnitType *UnitSet::GetUnitTypes( const string &lang ) const {
+  const Language *l = unit_names.GetLanguage( lang );
+  if ( !l || (lang == CF_LANG_DEFAULT) ) return ut;
+
+  map<string, UnitType *>::const_iterator it = localized.find( lang );
+  if ( it != localized.end() ) return it->second;
+
+  UnitType *types = new UnitType [num_tiles];
+  for ( int i = 0; i < num_tiles; ++i ) {
+    types[i] = ut[i];
+    types[i].SetName( l->GetMsg( i ) );
+  }
+  localized[lang] = types;
+  return types;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : UnitSet::GetSound
 // DESCRIPTION: Get a sound effect by its ID.
@@ -204,7 +337,9 @@ int UnitSet::LoadUnitTypes( MemBuffer &file ) {
       return -1;
   }
 
-  SetLocale( CF_LANG_DEFAULT );
+  unit_names.SetDefaultLanguage( CF_LANG_DEFAULT );
+  for ( int i = 0; i < num_tiles; ++i )
+    ut[i].SetName( unit_names.GetMsg( i ) );
   return 0;
 }
 
@@ -233,20 +368,6 @@ int UnitSet::LoadSfx( MemBuffer &file ) {
   return 0;
 }
 
-////////////////////////////////////////////////////////////////////////
-// NAME       : UnitSet::SetLocale
-// DESCRIPTION: Set the language to use.
-// PARAMETERS : lang - locale identifier
-// RETURNS    : -
-////////////////////////////////////////////////////////////////////////
-
-void UnitSet::SetLocale( const string &lang ) {
-  unit_names.SetDefaultLanguage( lang );
-
-  for ( int i = 0; i < num_tiles; ++i )
-    ut[i].SetName( unit_names.GetMsg( i ) );
-}
-
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : TerrainType::Load
@@ -296,7 +417,7 @@ int TerrainSet::Load( MemBuffer &file, const char *setname ) {
     for ( int i = 0; i < 10; ++i )
       classid[i] = file.Read16();
 
-    if ( !LoadTerrainTypes( file ) && !TileSet::Load( file, setname ) )
+    if ( !LoadTerrainTypes( file ) && !TileSet::Load( file, setname ) ) {
       // create the fog surface. This is kept separate from the tiles
       // surface so that we don't need to modify the alpha value each
       // time we want fog
@@ -306,8 +427,10 @@ int TerrainSet::Load( MemBuffer &file, const char *setname ) {
       fog.DisplayFormat();
       fog.Flood( Color(CF_COLOR_WHITE) );
       DrawTile( IMG_FOG, &fog, 0, 0, fog );
+      InitFogRuns();
 
       rc = 0;
+    }
   }
 
   return rc;
@@ -358,7 +481,54 @@ int TerrainSet::LoadTerrainTypes( MemBuffer &file ) {
 ////////////////////////////////////////////////////////////////////////
 
 void TerrainSet::DrawFog( Surface *dest, short px, short py, const Rect &clip ) const {
-  fog.Blit( dest, fog, px, py );
+  // blending the runs directly needs at least 16 bpp
+  if ( fog_runs.empty() ||
+       dest->FillRunsAlpha( fog_runs, px, py, clip, fog_col, FOG_ALPHA ) )
+    fog.Blit( dest, fog, px, py );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : TerrainSet::InitFogRuns
+// DESCRIPTION: If the fog image consists of a single colour, record
+//              its shape so that DrawFog() can blend the colour
+//              directly instead of doing an alpha blit.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void TerrainSet::InitFogRuns( void ) {
+  Color key = fog.GetColorKey();
+  bool first = true;
+
+  fog_runs.clear();
+
+  for ( short y = 0; y < fog.Height(); ++y ) {
+    short x = 0;
+    while ( x < fog.Width() ) {
+      if ( fog.GetPixel( x, y ) == key ) {
+        ++x;
+        continue;
+      }
+
+      PixelRun run;
+      run.x = x;
+      run.y = y;
+
+      for ( ; (x < fog.Width()) && (fog.GetPixel( x, y ) != key); ++x ) {
+        Color col = fog.GetPixel( x, y );
+        if ( first ) {
+          fog_col = col;
+          first = false;
+        } else if ( col != fog_col ) {
+          fog_runs.clear();
+          return;
+        }
+      }
+
+      run.w = x - run.x;
+      fog_runs.push_back( run );
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////
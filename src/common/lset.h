@@ -25,6 +25,7 @@
 #ifndef _INCLUDE_LSET_H
 #define _INCLUDE_LSET_H
 
+#include <map>
 #include <string>
 
 #include "gamedefs.h"
@@ -105,31 +106,69 @@ protected:
 };
 
 
+#define FOG_ALPHA             128
+
 #define DEFAULT_TILE_WIDTH    32
 #define DEFAULT_TILE_HEIGHT   28
+#define DEFAULT_TILE_SHIFT_X  9
+#define DEFAULT_TILE_SHIFT_Y  14
+
+// zoom level n shows tiles at 1/2^n of their original size
+#define TILE_ZOOM_LEVELS      3
+
+// a tile to be drawn with TileSet::DrawTiles()
+struct TileBlit {
+  unsigned short n;     // image number
+  short x;
+  short y;
+};
 
-// generic set of images
+// Generic set of images. The image sheet is converted to the display
+// format when loaded. It is not run-length encoded because SDL would
+// encode it again every time the destination surface changes, and
+// tiles are drawn to the display, the terrain cache and various
+// windows in turn.
+//
+// Zoomed() gives access to reduced copies of the set. Each one is
+// created from the image sheet the first time it is requested and
+// then kept until the set is destroyed. The horizontal overlap of
+// the hexes is rounded up in the reduced sets so that no gaps appear
+// between neighbouring tiles.
 class TileSet {
 public:
-  TileSet( void ) : num_tiles(0) {}
-  virtual ~TileSet( void ) {}
+  TileSet( void ) : num_tiles(0), zoom(0) {}
+  virtual ~TileSet( void );
 
   virtual int Load( MemBuffer &file, const char *setname );
 
-  unsigned short TileWidth( void ) const { return DEFAULT_TILE_WIDTH; }
-  unsigned short TileHeight( void ) const { return DEFAULT_TILE_HEIGHT; }
-  unsigned short TileShiftX( void ) const { return 9; }
-  unsigned short TileShiftY( void ) const { return 14; }
+  unsigned short TileWidth( void ) const { return DEFAULT_TILE_WIDTH >> zoom; }
+  unsigned short TileHeight( void ) const { return DEFAULT_TILE_HEIGHT >> zoom; }
+  unsigned short TileShiftX( void ) const
+                 { return (DEFAULT_TILE_SHIFT_X + (1 << zoom) - 1) >> zoom; }
+  unsigned short TileShiftY( void ) const { return DEFAULT_TILE_SHIFT_Y >> zoom; }
+  unsigned char Zoom( void ) const { return zoom; }
+  const TileSet *Zoomed( unsigned char level ) const;
 
   void DrawTile( unsigned short n, Surface *dest,
                  short px, short py, const Rect &clip ) const;
+  void DrawTiles( const TileBlit *blits, unsigned int count, Surface *dest,
+                  const Rect &clip ) const;
+  void DrawTiles( const vector<TileBlit> &blits, Surface *dest,
+                  const Rect &clip ) const
+                { if ( !blits.empty() ) DrawTiles( &blits[0], blits.size(), dest, clip ); }
   const string &GetName( void ) const { return name; }
   unsigned short NumTiles( void ) const { return num_tiles; }
 
 protected:
+  void InitTiles( void );
+
   unsigned short num_tiles;
+  unsigned char zoom;
   Surface tiles;
+  vector<Rect> tile_rects;    // source rectangles of the images on the sheet
   string name;
+
+  mutable vector<TileSet *> zoomed;   // reduced copies, indexed by level
 };
 
 class UnitSet : public TileSet {
@@ -140,12 +179,12 @@ public:
   int Load( MemBuffer &file, const char *setname );
 
   const UnitType *GetUnitInfo( unsigned short utid ) const;
+  const UnitType *GetUnitTypes( const string &lang ) const;
   SoundEffect *GetSound( unsigned short sfxid ) const;
   Surface *GetPortrait( unsigned char ptid ) const { return &portraits[ptid]; }
   const char *UnitName( unsigned short utid ) const
              { return unit_names.GetMsg( utid ); }
 
-  void SetLocale( const string &lang );
 
 protected:
   int LoadUnitTypes( MemBuffer &file );
@@ -158,6 +197,10 @@ protected:
   Surface *portraits;
 
   Locale unit_names;
+
+  // copies of the unit types with the names translated, for each
+  // language requested; the set itself uses CF_LANG_DEFAULT
+  mutable map<string, UnitType *> localized;
 };
 
 class TerrainSet : public TileSet {
@@ -172,12 +215,17 @@ public:
 
   void DrawFog( Surface *dest, short px, short py, const Rect &clip ) const;
   const Surface &HexMask( void ) const { return fog; }
+  const vector<PixelRun> &FogRuns( void ) const { return fog_runs; }
+  const Color &FogColor( void ) const { return fog_col; }
 
 protected:
   int LoadTerrainTypes( MemBuffer &file );
+  void InitFogRuns( void );
 
   TerrainType *tt;
   Surface fog;
+  vector<PixelRun> fog_runs;  // shape of the fog hex if it is drawn
+  Color fog_col;              // in a single colour
   unsigned short classid[10]; // IDs of the 10 most important terrain classes;
                               // determines which images are shown in unit info dialog
 };
@@ -38,6 +38,9 @@ MapView::MapView( Surface *display, const Rect &bounds, unsigned short flags ) :
 
   map = NULL;
   shader_map = NULL;
+  zoom = 0;
+  chunk_cols = chunk_count = 0;
+  chunk_clock = 0;
 
   SetFlags( flags );
 }
@@ -55,6 +58,53 @@ void MapView::InitOffsets( void ) {
   maxy = MAX( 0, map->Height() * TileHeight() + TileShiftY() - h );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::InitMetrics
+// DESCRIPTION: Set up everything that depends on the tile size. Call
+//              after the map or the zoom level has changed. This
+//              discards the terrain cache and the fog overlay.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::InitMetrics( void ) {
+  const TerrainSet *ts = map->GetTerrainSet();
+
+  InitOffsets();
+  FlushTerrain();
+
+  // at the original scale use the shape of the fog image, otherwise
+  // just a hex of the right size
+  fog_runs.clear();
+  if ( zoom == 0 ) fog_runs = ts->FogRuns();
+  else {
+    for ( short y = 0; y < TileHeight(); ++y ) {
+      PixelRun run;
+      run.x = TileShiftX() * ABS(2 * y + 1 - TileHeight()) / TileHeight();
+      run.y = y;
+      run.w = TileWidth() - 2 * run.x;
+      fog_runs.push_back( run );
+    }
+
+    if ( !ts->HexMask().ScaleDown( fog_image, 1 << zoom ) ) {
+      fog_image.SetAlpha( FOG_ALPHA, SDL_SRCALPHA );
+      fog_image.DisplayFormat();
+    }
+  }
+
+  if ( !ts->FogRuns().empty() ) fog_col = ts->FogColor();
+  else fog_col = Color(CF_COLOR_SHADOW);
+
+  overlay_runs.clear();
+  overlay_rows.assign( MapPixelHeight() + 1, 0 );
+  overlay_fog.assign( map->Width() * map->Height(), false );
+
+  chunk_cols = (MapPixelWidth() + MV_CHUNK_SIZE - 1) / MV_CHUNK_SIZE;
+  unsigned short rows = (MapPixelHeight() + MV_CHUNK_SIZE - 1) / MV_CHUNK_SIZE;
+  chunks.assign( chunk_cols * rows, NULL );
+  chunk_used.assign( chunk_cols * rows, 0 );
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : MapView::Resize
 // DESCRIPTION: Set a new viewport size and position.
@@ -86,13 +136,53 @@ void MapView::Resize( const Rect &bounds ) {
 
 void MapView::SetMap( Map *map ) {
   if ( shader_map ) delete [] shader_map;
+  FlushTerrain();
 
   cursor = Point( -1, -1 );
   cursor_image = IMG_CURSOR_IDLE;
   this->map = map;
 
-  InitOffsets();
+  // keep the zoom level unless the sets of the new map can't be reduced
+  if ( (TerrainTiles()->Zoom() != zoom) || (UnitTiles()->Zoom() != zoom) )
+    zoom = 0;
+
+  InitMetrics();
   shader_map = new signed char [map->Width() * map->Height()];
+
+  damage.clear();
+  dirty.assign( map->Width() * map->Height(), false );
+  fog_shown.assign( map->Width() * map->Height(), false );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::SetZoom
+// DESCRIPTION: Change the scale of the map display. The view is
+//              centered on the cursor (or the hex which was in the
+//              center before) and redrawn.
+// PARAMETERS : level - zoom level (0 .. TILE_ZOOM_LEVELS - 1)
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int MapView::SetZoom( unsigned char level ) {
+  if ( !map || (level >= TILE_ZOOM_LEVELS) ) return -1;
+  if ( level == zoom ) return 0;
+
+  // make sure both tile sets are available at the new size
+  if ( (map->GetTerrainSet()->Zoomed( level )->Zoom() != level) ||
+       (map->GetUnitSet()->Zoomed( level )->Zoom() != level) ) return -1;
+
+  Point center( cursor );
+  if ( center.x == -1 ) Pixel2Hex( x + w / 2, y + h / 2, center );
+
+  zoom = level;
+  InitMetrics();
+
+  if ( center.x != -1 ) CenterOnHex( center );
+  else {
+    curx = cury = 0;
+    Draw();
+  }
+  return 0;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -118,6 +208,26 @@ void MapView::Disable( void ) {
   SetFlags( MV_DISABLE );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::Draw
+// DESCRIPTION: Draw the entire viewport. This also repairs all damage.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::Draw( void ) {
+  Draw( 0, 0, w, h );
+
+  if ( map ) {
+    for ( vector<Point>::iterator i = damage.begin(); i != damage.end(); ++i )
+      dirty[map->Hex2Index( *i )] = false;
+    damage.clear();
+
+    for ( int i = map->Width() * map->Height() - 1; i >= 0; --i )
+      fog_shown[i] = ShowFog( i );
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : MapView::Draw
 // DESCRIPTION: Draw a part of the map onto the window surface.
@@ -128,8 +238,12 @@ void MapView::Disable( void ) {
 // RETURNS    : -
 ////////////////////////////////////////////////////////////////////////
 
-void MapView::Draw( short x, short y, unsigned short w, unsigned short h ) const {
-  surface->FillRect( *this, Color(CF_COLOR_SHADOW) );
+void MapView::Draw( short x, short y, unsigned short w, unsigned short h ) {
+  // cached terrain already includes the background
+  if ( !Enabled() || !FlagSet(MV_TERRAIN_CACHE) ||
+       (curx + x + w > MapPixelWidth()) || (cury + y + h > MapPixelHeight()) )
+    surface->FillRect( Rect( x + this->x, y + this->y, w, h ), Color(CF_COLOR_SHADOW) );
+
   if ( Enabled() ) {
     DrawMap( curx + x, cury + y, w, h, surface, x + this->x, y + this->y );
   }
@@ -149,7 +263,7 @@ void MapView::Draw( short x, short y, unsigned short w, unsigned short h ) const
 ////////////////////////////////////////////////////////////////////////
 
 void MapView::DrawMap( short x, short y, unsigned short w,
-              unsigned short h, Surface *dest, short dx, short dy ) const {
+              unsigned short h, Surface *dest, short dx, short dy ) {
   int hx1 = MinXHex( x );
   int hy1 = MinYHex( y );
   int hx2 = MaxXHex( x, w );
@@ -159,39 +273,376 @@ void MapView::DrawMap( short x, short y, unsigned short w,
   int sx, sy, tx, ty, yoff;
   Point hex;
 
+  // with a single-coloured fog image or when zoomed out, fog is
+  // blended for the whole area at once after the units have been drawn.
+  // Blending runs needs at least 16 bpp, otherwise we do it hex by hex.
+  bool overlay = FogEnabled() && !fog_runs.empty() &&
+                 (dest->s_surface->format->BytesPerPixel >= 2);
+
+  // draw the terrain images
+  if ( FlagSet(MV_TERRAIN_CACHE) ) BlitTerrain( x, y, w, h, dest, dx, dy );
+  else RenderTerrain( x, y, w, h, dest, dx, dy );
+
   for ( tx = hx1; tx <= hx2; ++tx ) {
-    sx = tx * (TileWidth() - TileShiftX()) - x + this->x;
+    sx = tx * (TileWidth() - TileShiftX()) - x + dx;
 
     if ( tx & 1 ) yoff = TileShiftY() - y;
     else yoff = -y;
-    yoff += this->y;
+    yoff += dy;
 
     for ( ty = hy1; ty <= hy2; ++ty ) {
       sy = ty * TileHeight() + yoff;
       hex = Point( tx, ty );
 
-      // draw the terrain image
-      DrawTerrain( map->HexImage( hex ), dest, sx, sy, clip );
-
       // draw unit
       if ( Unit *u = map->GetUnit( hex ) ) {
         DrawUnit( u->Image(), dest, sx, sy, clip );
         if ( !u->IsReady() ) DrawTerrain( IMG_NOT_AVAILABLE, dest, sx, sy, clip );
 
-        // draw unit health
-        if ( UnitStatsEnabled() )
+        // draw unit health; the bars would be unreadable when zoomed out
+        if ( UnitStatsEnabled() && (zoom == 0) )
           DrawUnitHealth( u->GroupSize(), dest, sx, sy, clip );
       }
 
       // draw fog
-      if ( FogEnabled() && (shader_map[map->Hex2Index(hex)] == -1) )
+      if ( !overlay && ShowFog( map->Hex2Index(hex) ) )
         DrawFog( dest, sx, sy, clip );
+    }
+  }
+
+  if ( overlay ) DrawFogOverlay( x, y, w, h, dest, dx, dy );
+
+  // draw cursor
+  if ( CursorEnabled() && (cursor.x >= hx1) && (cursor.x <= hx2) &&
+       (cursor.y >= hy1) && (cursor.y <= hy2) ) {
+    sx = cursor.x * (TileWidth() - TileShiftX()) - x + dx;
+    sy = cursor.y * TileHeight() + (cursor.x & 1) * TileShiftY() - y + dy;
+    DrawTerrain( cursor_image, dest, sx, sy, clip );
+  }
+}
 
-      // draw cursor
-      if ( CursorEnabled() && (hex == cursor) )
-        DrawTerrain( cursor_image, dest, sx, sy, clip );
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::DrawFogOverlay
+// DESCRIPTION: Shade the fogged hexes of a part of the map. The fog
+//              overlay is rebuilt first if the fog in that part has
+//              changed.
+// PARAMETERS : x    - leftmost pixel of the map (!) to paint
+//              y    - topmost pixel to paint
+//              w    - width of the map part to draw
+//              h    - height of the map part
+//              dest - destination surface
+//              dx   - where to start drawing on the surface
+//              dy   - where to start drawing vertically
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::DrawFogOverlay( short x, short y, unsigned short w,
+              unsigned short h, Surface *dest, short dx, short dy ) {
+  int hx1 = MinXHex( x );
+  int hy1 = MinYHex( y );
+  int hx2 = MaxXHex( x, w );
+  int hy2 = MaxYHex( y, h );
+  bool stale = false;
+
+  for ( int tx = hx1; (tx <= hx2) && !stale; ++tx ) {
+    for ( int ty = hy1; (ty <= hy2) && !stale; ++ty ) {
+      int index = map->Hex2Index( Point(tx, ty) );
+      stale = (overlay_fog[index] != ShowFog( index ));
     }
   }
+  if ( stale ) BuildFogOverlay();
+
+  int y1 = MAX( y, 0 );
+  int y2 = MIN( y + h, MapPixelHeight() );
+  if ( y1 >= y2 ) return;
+
+  unsigned int first = overlay_rows[y1], last = overlay_rows[y2];
+  if ( first < last ) {
+    dest->FillRunsAlpha( &overlay_runs[first], last - first,
+                         dx - x, dy - y, Rect( dx, dy, w, h ),
+                         fog_col, FOG_ALPHA );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::BuildFogOverlay
+// DESCRIPTION: Create the fog overlay for the entire map from the fog
+//              buffer. Runs of neighbouring hexes are joined, so that
+//              a row of fogged hexes can be blended in one go.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::BuildFogOverlay( void ) {
+  const vector<PixelRun> &hexruns = fog_runs;
+  unsigned short rows = MapPixelHeight();
+  vector<PixelRun>::const_iterator r;
+  int tx, ty, index;
+
+  // count the runs for each row...
+  overlay_rows.assign( rows + 1, 0 );
+
+  for ( tx = 0; tx < map->Width(); ++tx ) {
+    for ( ty = 0; ty < map->Height(); ++ty ) {
+      index = map->Hex2Index( Point(tx, ty) );
+      overlay_fog[index] = ShowFog( index );
+
+      if ( overlay_fog[index] ) {
+        short sy = ty * TileHeight() + (tx & 1) * TileShiftY();
+        for ( r = hexruns.begin(); r != hexruns.end(); ++r )
+          ++overlay_rows[sy + r->y + 1];
+      }
+    }
+  }
+
+  // ...to find out where each row starts...
+  for ( int i = 0; i < rows; ++i )
+    overlay_rows[i + 1] += overlay_rows[i];
+
+  // ...and put the runs there. We go from left to right, so the runs
+  // in each row are ordered
+  vector<unsigned int> next( overlay_rows.begin(), overlay_rows.end() - 1 );
+  overlay_runs.resize( overlay_rows[rows] );
+
+  for ( tx = 0; tx < map->Width(); ++tx ) {
+    short sx = tx * (TileWidth() - TileShiftX());
+
+    for ( ty = 0; ty < map->Height(); ++ty ) {
+      if ( overlay_fog[map->Hex2Index( Point(tx, ty) )] ) {
+        short sy = ty * TileHeight() + (tx & 1) * TileShiftY();
+
+        for ( r = hexruns.begin(); r != hexruns.end(); ++r ) {
+          PixelRun &run = overlay_runs[next[sy + r->y]++];
+          run.x = sx + r->x;
+          run.y = sy + r->y;
+          run.w = r->w;
+        }
+      }
+    }
+  }
+
+  // join touching or overlapping runs
+  unsigned int out = 0;
+  for ( int i = 0; i < rows; ++i ) {
+    unsigned int start = overlay_rows[i], end = overlay_rows[i + 1];
+    overlay_rows[i] = out;
+
+    for ( unsigned int k = start; k < end; ++k ) {
+      PixelRun run = overlay_runs[k];
+
+      if ( out > overlay_rows[i] ) {
+        PixelRun &prev = overlay_runs[out - 1];
+        if ( run.x <= prev.x + prev.w ) {
+          prev.w = MAX( prev.x + prev.w, run.x + run.w ) - prev.x;
+          continue;
+        }
+      }
+      overlay_runs[out++] = run;
+    }
+  }
+  overlay_rows[rows] = out;
+  overlay_runs.resize( out );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::RenderTerrain
+// DESCRIPTION: Draw the terrain images for a part of the map. Areas
+//              not covered by any hex are left untouched.
+// PARAMETERS : x    - leftmost pixel of the map (!) to paint
+//              y    - topmost pixel to paint
+//              w    - width of the map part to draw
+//              h    - height of the map part
+//              dest - destination surface
+//              dx   - where to start drawing on the surface
+//              dy   - where to start drawing vertically
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::RenderTerrain( short x, short y, unsigned short w,
+              unsigned short h, Surface *dest, short dx, short dy ) const {
+  int hx1 = MinXHex( x );
+  int hy1 = MinYHex( y );
+  int hx2 = MaxXHex( x, w );
+  int hy2 = MaxYHex( y, h );
+
+  Rect clip( dx, dy, w, h );
+  int sx, yoff;
+
+  vector<TileBlit> blits;
+  if ( (hx2 >= hx1) && (hy2 >= hy1) )
+    blits.reserve( (hx2 - hx1 + 1) * (hy2 - hy1 + 1) );
+
+  for ( int tx = hx1; tx <= hx2; ++tx ) {
+    sx = tx * (TileWidth() - TileShiftX()) - x + dx;
+
+    if ( tx & 1 ) yoff = TileShiftY() - y;
+    else yoff = -y;
+    yoff += dy;
+
+    for ( int ty = hy1; ty <= hy2; ++ty ) {
+      TileBlit b;
+      b.n = map->HexImage( Point(tx, ty) );
+      b.x = sx;
+      b.y = ty * TileHeight() + yoff;
+      blits.push_back( b );
+    }
+  }
+
+  TerrainTiles()->DrawTiles( blits, dest, clip );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::BlitTerrain
+// DESCRIPTION: Copy a part of the map from the terrain cache to a
+//              surface. Chunks are rendered as needed. Unlike
+//              RenderTerrain() this also paints the background.
+// PARAMETERS : x    - leftmost pixel of the map (!) to paint
+//              y    - topmost pixel to paint
+//              w    - width of the map part to draw
+//              h    - height of the map part
+//              dest - destination surface
+//              dx   - where to start drawing on the surface
+//              dy   - where to start drawing vertically
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::BlitTerrain( short x, short y, unsigned short w,
+              unsigned short h, Surface *dest, short dx, short dy ) {
+  Rect area( x, y, w, h );
+  area.Clip( Rect( 0, 0, MapPixelWidth(), MapPixelHeight() ) );
+  if ( area.IsEmpty() ) return;
+
+  unsigned short cx1 = area.x / MV_CHUNK_SIZE;
+  unsigned short cy1 = area.y / MV_CHUNK_SIZE;
+  unsigned short cx2 = (area.x + area.w - 1) / MV_CHUNK_SIZE;
+  unsigned short cy2 = (area.y + area.h - 1) / MV_CHUNK_SIZE;
+
+  for ( unsigned short cy = cy1; cy <= cy2; ++cy ) {
+    for ( unsigned short cx = cx1; cx <= cx2; ++cx ) {
+      unsigned short index = cy * chunk_cols + cx;
+      Rect chunk = ChunkRect( index );
+      Rect part( area );
+      part.Clip( chunk );
+
+      Surface *s = TerrainChunk( index );
+      if ( s ) {
+        s->Blit( dest, Rect( part.x - chunk.x, part.y - chunk.y, part.w, part.h ),
+                 dx + part.x - x, dy + part.y - y );
+      } else {
+        // out of memory, do it the slow way
+        dest->FillRect( dx + part.x - x, dy + part.y - y, part.w, part.h,
+                        Color(CF_COLOR_SHADOW) );
+        RenderTerrain( part.x, part.y, part.w, part.h,
+                       dest, dx + part.x - x, dy + part.y - y );
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::ChunkRect
+// DESCRIPTION: Get the map area covered by a terrain chunk.
+// PARAMETERS : index - chunk index
+// RETURNS    : area in map pixels
+////////////////////////////////////////////////////////////////////////
+
+Rect MapView::ChunkRect( unsigned short index ) const {
+  short cx = (index % chunk_cols) * MV_CHUNK_SIZE;
+  short cy = (index / chunk_cols) * MV_CHUNK_SIZE;
+  return Rect( cx, cy, MIN( MV_CHUNK_SIZE, MapPixelWidth() - cx ),
+                       MIN( MV_CHUNK_SIZE, MapPixelHeight() - cy ) );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::TerrainChunk
+// DESCRIPTION: Get a terrain chunk, rendering it if necessary. If the
+//              cache is full, the chunk which has not been used for
+//              the longest time is discarded.
+// PARAMETERS : index - chunk index
+// RETURNS    : chunk surface or NULL on error
+////////////////////////////////////////////////////////////////////////
+
+Surface *MapView::TerrainChunk( unsigned short index ) {
+  if ( !chunks[index] ) {
+    // the budget shrinks if the viewport does
+    while ( chunk_count >= ChunkBudget() ) {
+      int oldest = -1;
+      for ( int i = chunks.size() - 1; i >= 0; --i ) {
+        if ( chunks[i] && ((oldest == -1) || (chunk_used[i] < chunk_used[oldest])) )
+          oldest = i;
+      }
+      delete chunks[oldest];
+      chunks[oldest] = NULL;
+      --chunk_count;
+    }
+
+    Rect area = ChunkRect( index );
+    Surface *s = new Surface;
+    if ( s->Create( area.w, area.h, surface->s_surface->format->BitsPerPixel,
+                    SDL_SWSURFACE ) ) {
+      delete s;
+      return NULL;
+    }
+    s->DisplayFormat();
+
+    s->Flood( Color(CF_COLOR_SHADOW) );
+    RenderTerrain( area.x, area.y, area.w, area.h, s, 0, 0 );
+
+    chunks[index] = s;
+    ++chunk_count;
+  }
+
+  chunk_used[index] = ++chunk_clock;
+  return chunks[index];
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::FlushTerrain
+// DESCRIPTION: Discard the terrain cache.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::FlushTerrain( void ) {
+  for ( unsigned int i = 0; i < chunks.size(); ++i ) {
+    delete chunks[i];
+    chunks[i] = NULL;
+  }
+  chunk_count = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::TerrainChanged
+// DESCRIPTION: The terrain type of a hex has changed. Update the
+//              terrain cache and mark the hex for redrawing.
+// PARAMETERS : hex - hex which has changed
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::TerrainChanged( const Point &hex ) {
+  if ( map && map->Contains( hex ) && FlagSet(MV_TERRAIN_CACHE) ) {
+    Rect area( hex.x * (TileWidth() - TileShiftX()),
+               hex.y * TileHeight() + (hex.x & 1) * TileShiftY(),
+               TileWidth(), TileHeight() );
+
+    for ( unsigned short i = 0; i < chunks.size(); ++i ) {
+      if ( !chunks[i] ) continue;
+
+      Rect chunk = ChunkRect( i );
+      Rect part( area );
+      part.Clip( chunk );
+
+      if ( !part.IsEmpty() ) {
+        part.x -= chunk.x;
+        part.y -= chunk.y;
+        chunks[i]->FillRect( part, Color(CF_COLOR_SHADOW) );
+        RenderTerrain( part.x + chunk.x, part.y + chunk.y, part.w, part.h,
+                       chunks[i], part.x, part.y );
+      }
+    }
+  }
+
+  Damage( hex );
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -216,8 +667,11 @@ int MapView::Pixel2Hex( short px, short py, Point &hex ) const {
     hx %= TileWidth() - TileShiftX();
     hy -= hex.y * TileHeight() + (hex.x & 1) * TileShiftY();
 
-    const Surface &mask = map->GetTerrainSet()->HexMask();
-    if ( mask.GetPixel( hx, hy ) == mask.GetColorKey() ) {
+    // the mask is only available at the original size
+    const TerrainSet *ts = map->GetTerrainSet();
+    const Surface &mask = ts->HexMask();
+    if ( mask.GetPixel( hx * ts->TileWidth() / TileWidth(),
+                        hy * ts->TileHeight() / TileHeight() ) == mask.GetColorKey() ) {
       if ( hx < (TileWidth() / 2) ) --hex.x;
       else ++hex.x;
 
@@ -265,42 +719,116 @@ bool MapView::HexVisible( const Point &hex ) const {
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : MapView::UpdateHex
-// DESCRIPTION: Redraw a single hex.
+// DESCRIPTION: Redraw a single hex, along with any other damage.
 // PARAMETERS : hex - hex to update
 // RETURNS    : Rect describing the surface area that has been updated
 //              and needs to be refreshed
 ////////////////////////////////////////////////////////////////////////
 
 Rect MapView::UpdateHex( const Point &hex ) {
-  if ( !Enabled() ) return Rect(0,0,0,0);
+  Damage( hex );
+  return Repair();
+}
 
-  Point p = Hex2Pixel( hex );  // get absolute position
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::Damage
+// DESCRIPTION: Mark a hex for redrawing on the next call to Repair().
+// PARAMETERS : hex - hex which has changed
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
 
-  Rect clip( p.x, p.y, TileWidth(), TileHeight() );   // create clip rect
-  clip.Clip( *this );
+void MapView::Damage( const Point &hex ) {
+  if ( map && map->Contains( hex ) ) {
+    int index = map->Hex2Index( hex );
+    if ( !dirty[index] ) {
+      dirty[index] = true;
+      damage.push_back( hex );
+    }
+  }
+}
 
-  // draw the terrain image
-  DrawTerrain( map->HexImage( hex ), surface, p.x, p.y, clip );
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::DamageFog
+// DESCRIPTION: Compare the fog buffer to what is currently displayed
+//              and mark all hexes where it differs as damaged. Checking
+//              the buffer is much cheaper than drawing, so we don't
+//              bother with tracking the shaders.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
 
-  // draw unit
-  if ( Unit *u = map->GetUnit( hex ) ) {
-    DrawUnit( u->Image(), surface, p.x, p.y, clip );
-    if ( !u->IsReady() ) DrawTerrain( IMG_NOT_AVAILABLE, surface, p.x, p.y, clip );
+void MapView::DamageFog( void ) {
+  for ( int i = map->Width() * map->Height() - 1; i >= 0; --i ) {
+    if ( fog_shown[i] != ShowFog( i ) ) Damage( map->Index2Hex( i ) );
+  }
+}
 
-    // draw unit health
-    if ( UnitStatsEnabled() )
-      DrawUnitHealth( u->GroupSize(), surface, p.x, p.y, clip );
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::Repair
+// DESCRIPTION: Redraw all damaged hexes. Hexes overlap their neighbours
+//              at the edges so we redraw the entire area covered by a
+//              hex, not just the hex itself.
+// PARAMETERS : -
+// RETURNS    : Rect describing the surface area that has been updated
+//              and needs to be refreshed
+////////////////////////////////////////////////////////////////////////
+
+Rect MapView::Repair( void ) {
+  Rect update( 0, 0, 0, 0 );
+
+  if ( !map ) return update;
+
+  DamageFog();
+
+  if ( Enabled() && !damage.empty() ) {
+    unsigned int visible = 0;
+    for ( vector<Point>::iterator i = damage.begin(); i != damage.end(); ++i ) {
+      if ( HexVisible( *i ) ) ++visible;
+    }
+
+    unsigned int hexes = (w / (TileWidth() - TileShiftX()) + 1) *
+                         (h / TileHeight() + 1);
+    if ( visible * MV_REPAIR_FULL > hexes ) {
+      Draw();
+      return *this;
+    }
   }
 
-  // draw fog
-  if ( FogEnabled() && (shader_map[map->Hex2Index(hex)] == -1) )
-    DrawFog( surface, p.x, p.y, clip );
+  for ( vector<Point>::iterator i = damage.begin(); i != damage.end(); ++i ) {
+    int index = map->Hex2Index( *i );
+    dirty[index] = false;
+    fog_shown[index] = ShowFog( index );
 
-  // draw cursor
-  if ( CursorEnabled() && (hex == cursor) )
-    DrawTerrain( cursor_image, surface, p.x, p.y, clip );
+    if ( Enabled() ) {
+      Point p = Hex2Pixel( *i );
+      Rect area( p.x, p.y, TileWidth(), TileHeight() );
+      area.Clip( *this );
+
+      if ( !area.IsEmpty() ) {
+        Draw( area.x - x, area.y - y, area.w, area.h );
+        update.Union( area );
+      }
+    }
+  }
+  damage.clear();
 
-  return clip;
+  return update;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapView::DrawFog
+// DESCRIPTION: Draw the fog hex to a surface.
+// PARAMETERS : dest - destination surface
+//              px   - horizontal offset on surface
+//              py   - vertical offset on surface
+//              clip - clipping rectangle
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapView::DrawFog( Surface *dest, short px, short py, const Rect &clip ) const {
+  if ( zoom == 0 ) map->GetTerrainSet()->DrawFog( dest, px, py, clip );
+  else if ( dest->FillRunsAlpha( fog_runs, px, py, clip, fog_col, FOG_ALPHA ) )
+    fog_image.Blit( dest, fog_image, px, py );
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -462,6 +990,11 @@ bool MapView::CheckScroll( void ) {
 ////////////////////////////////////////////////////////////////////////
 
 void MapView::Scroll( short px, short py ) {
+#ifdef CF_SDL_LOCAL_BLIT
+  // the part we keep must be up to date
+  Repair();
+#endif
+
   if ( curx + px < 0 ) px = -curx;
   else if ( curx + px > maxx ) px = maxx - curx;
   curx += px;
@@ -531,19 +1064,20 @@ Rect MapView::SetCursor( const Point &hex ) {
 
   if ( (hex.x == -1) && (hex.y == -1) ) {  // remove cursor
     if ( CursorEnabled() ) {
-      Point old = cursor;
+      Damage( cursor );
       cursor = Point( -1, -1 );
+      SetFlags(MV_DISABLE_CURSOR);
 
       // update old cursor position
-      update = UpdateHex( old );
-      SetFlags(MV_DISABLE_CURSOR);
+      update = Repair();
     }
   } else {
+    if ( CursorEnabled() ) Damage( cursor );
     UnsetFlags(MV_DISABLE_CURSOR);
     cursor = hex;
-    update = UpdateHex( hex );
+    Damage( hex );
+    update = Repair();
     if ( FlagSet(MV_AUTOSCROLL) && CheckScroll() ) update = *this;
   }
   return update;
 }
-
@@ -23,6 +23,9 @@
 #ifndef _INCLUDE_MAPVIEW_H
 #define _INCLUDE_MAPVIEW_H
 
+#include <vector>
+using namespace std;
+
 #include "rect.h"
 #include "map.h"
 #include "surface.h"
@@ -42,12 +45,39 @@
 #define MV_DISABLE_FOG		0x0004	// don't show fog
 #define MV_DISABLE_CURSOR	0x0008	// don't show cursor
 #define MV_ENABLE_UNIT_STATS	0x0010  // overlay units with stats (health, xp)
+#define MV_TERRAIN_CACHE	0x0020	// keep pre-rendered terrain in memory; terrain
+					// changes must be reported via TerrainChanged()
 #define MV_DIRTY		0x8000  // must be redrawn
 
-class MapView : public Rect {
+// The view keeps track of the hexes which need to be redrawn. Changes
+// are reported via Damage() (the map does this automatically if the
+// view has been registered as its HexObserver) and Repair() redraws
+// only the damaged hexes. Changes to the fog buffer are detected
+// automatically.
+//
+// With MV_TERRAIN_CACHE the terrain is rendered to offscreen chunks
+// of MV_CHUNK_SIZE pixels when it is first shown. Drawing the map
+// then only takes one blit per chunk plus units, fog, and cursor.
+// The cache holds enough chunks to cover the viewport at any offset
+// plus one spare row and column for scrolling, but at least
+// MV_CHUNK_BUDGET, so memory use stays within bounds on large maps.
+#define MV_CHUNK_SIZE    256
+#define MV_CHUNK_BUDGET  48
+
+// Repair() redraws the whole view instead of single hexes if more
+// than one in MV_REPAIR_FULL visible hexes is damaged
+#define MV_REPAIR_FULL   4
+
+// The map can be shown at any of the TILE_ZOOM_LEVELS of the tile
+// sets. All metrics are taken from the reduced sets then. Zoomed out
+// views do not show unit stats, and fog is always blended as a plain
+// hex shape, so they are never more expensive to draw than the
+// original scale.
+
+class MapView : public Rect, public HexObserver {
 public:
   MapView( Surface *display, const Rect &bounds, unsigned short flags );
-  ~MapView( void ) { delete [] shader_map; }
+  ~MapView( void ) { delete [] shader_map; FlushTerrain(); }
 
   void Resize( const Rect &bounds );
   void SetMap( Map *map );
@@ -71,19 +101,18 @@ public:
   void UnsetFlags( unsigned short flags ) { this->flags &= (~flags); }
   bool FlagSet( unsigned short flag ) const { return (flags & flag) == flag; }
 
-  void Draw( void ) const { Draw( 0, 0, w, h ); }
-  void Draw( short x, short y, unsigned short w, unsigned short h ) const;
+  void Draw( void );
+  void Draw( short x, short y, unsigned short w, unsigned short h );
   void DrawMap( short x, short y, unsigned short w, unsigned short h,
-                Surface *dest, short dx, short dy ) const;
+                Surface *dest, short dx, short dy );
 
   void DrawUnit( unsigned short n, Surface *dest,
                  short px, short py, const Rect &clip ) const
-               { map->GetUnitSet()->DrawTile( n, dest, px, py, clip ); }
+               { UnitTiles()->DrawTile( n, dest, px, py, clip ); }
   void DrawTerrain( unsigned short n, Surface *dest,
                  short px, short py, const Rect &clip ) const
-               { map->GetTerrainSet()->DrawTile( n, dest, px, py, clip ); }
-  void DrawFog( Surface *dest, short px, short py, const Rect &clip ) const
-               { map->GetTerrainSet()->DrawFog( dest, px, py, clip ); }
+               { TerrainTiles()->DrawTile( n, dest, px, py, clip ); }
+  void DrawFog( Surface *dest, short px, short py, const Rect &clip ) const;
   void DrawUnitHealth( unsigned char health, Surface *dest,
                        short px, short py, const Rect &clip ) const;
 
@@ -94,6 +123,10 @@ public:
   Point GetOffsets( void ) const { return Point(curx,cury); }
 
   Rect UpdateHex( const Point &hex );
+  void Damage( const Point &hex );
+  Rect Repair( void );
+  void HexChanged( const Point &hex ) { Damage( hex ); }
+  void TerrainChanged( const Point &hex );
   void CenterOnHex( const Point &hex );
   Rect SetCursor( const Point &hex );
   Point Cursor( void ) const { return cursor; }
@@ -105,14 +138,42 @@ public:
   unsigned short MaxXHex( short x, unsigned short w ) const;
   unsigned short MaxYHex( short y, unsigned short h ) const;
 
-  unsigned short TileWidth( void ) const { return map->GetTerrainSet()->TileWidth(); }
-  unsigned short TileHeight( void ) const { return map->GetTerrainSet()->TileHeight(); }
-  unsigned short TileShiftX( void ) const { return map->GetTerrainSet()->TileShiftX(); }
-  unsigned short TileShiftY( void ) const { return map->GetTerrainSet()->TileShiftY(); }
+  int SetZoom( unsigned char level );
+  unsigned char Zoom( void ) const { return zoom; }
+  const TileSet *TerrainTiles( void ) const
+                { return map->GetTerrainSet()->Zoomed( zoom ); }
+  const TileSet *UnitTiles( void ) const
+                { return map->GetUnitSet()->Zoomed( zoom ); }
+
+  unsigned short TileWidth( void ) const { return TerrainTiles()->TileWidth(); }
+  unsigned short TileHeight( void ) const { return TerrainTiles()->TileHeight(); }
+  unsigned short TileShiftX( void ) const { return TerrainTiles()->TileShiftX(); }
+  unsigned short TileShiftY( void ) const { return TerrainTiles()->TileShiftY(); }
 
 private:
   void InitOffsets( void );
+  void InitMetrics( void );
   bool CheckScroll( void );
+  void DamageFog( void );
+
+  void RenderTerrain( short x, short y, unsigned short w, unsigned short h,
+                      Surface *dest, short dx, short dy ) const;
+  void BlitTerrain( short x, short y, unsigned short w, unsigned short h,
+                    Surface *dest, short dx, short dy );
+  Surface *TerrainChunk( unsigned short index );
+  Rect ChunkRect( unsigned short index ) const;
+  unsigned short ChunkBudget( void ) const
+       { return MAX( MV_CHUNK_BUDGET, (w / MV_CHUNK_SIZE + 3) * (h / MV_CHUNK_SIZE + 3) ); }
+  void FlushTerrain( void );
+  void DrawFogOverlay( short x, short y, unsigned short w, unsigned short h,
+                       Surface *dest, short dx, short dy );
+  void BuildFogOverlay( void );
+  unsigned short MapPixelWidth( void ) const
+       { return map->Width() * (TileWidth() - TileShiftX()) + TileShiftX(); }
+  unsigned short MapPixelHeight( void ) const
+       { return map->Height() * TileHeight() + TileShiftY(); }
+  bool ShowFog( int index ) const
+       { return FogEnabled() && (shader_map[index] == -1); }
 
   Point cursor;
   unsigned short cursor_image;
@@ -127,6 +188,30 @@ private:
 
   unsigned short flags;
   signed char *shader_map;
+  unsigned char zoom;
+
+  vector<PixelRun> fog_runs;  // shape of a fogged hex at the current zoom
+                              // level, empty if fog is an image
+  Color fog_col;              // colour to blend fog_runs with
+  Surface fog_image;          // fogged hex when zoomed out, for displays
+                              // which fog_runs can't be blended on
+
+  vector<Point> damage;     // hexes to be redrawn
+  vector<bool> dirty;       // same, indexed by hex
+  vector<bool> fog_shown;   // fog as currently displayed
+
+  // fog for the entire map as pixel runs sorted by row. overlay_rows
+  // holds the index of the first run of each row (plus one entry for
+  // the end), overlay_fog the fog state the runs were created from
+  vector<PixelRun> overlay_runs;
+  vector<unsigned int> overlay_rows;
+  vector<bool> overlay_fog;
+
+  vector<Surface *> chunks; // pre-rendered terrain, NULL if not cached
+  vector<unsigned long> chunk_used;  // for discarding old chunks
+  unsigned short chunk_cols;
+  unsigned short chunk_count;
+  unsigned long chunk_clock;
 };
 
 #endif	/* _INCLUDE_MAPVIEW_H */
@@ -23,6 +23,200 @@
 #include "mapwidget.h"
 #include "globals.h"
 
+#define OVERVIEW_SHADE  96    // alpha used to darken the area outside the viewport
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapOverview::SetMap
+// DESCRIPTION: Set the map to show. If it is the same map with the same
+//              magnification as before the image is kept and only
+//              updated for the hexes which have changed in the
+//              meantime.
+// PARAMETERS : map     - map to show (may be NULL)
+//              magnify - size of a hex in pixels (> 0)
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int MapOverview::SetMap( const Map *map, unsigned char magnify ) {
+  if ( (map == this->map) && (magnify == this->magnify) ) return 0;
+
+  this->map = NULL;
+  this->magnify = 0;
+  full = true;
+  changed.clear();
+  pending.clear();
+
+  if ( !map ) return 0;
+
+  unsigned short w = map->Width() * magnify,
+                 h = map->Height() * magnify + magnify/2;
+  if ( (magnify == 0) || image.Create( w, h, DISPLAY_BPP, 0 ) ||
+       shaded.Create( w, h, DISPLAY_BPP, 0 ) ) return -1;
+
+  this->map = map;
+  this->magnify = magnify;
+  pending.resize( map->Width() * map->Height(), false );
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapOverview::SetPlayerColors
+// DESCRIPTION: Set the colors for units and buildings.
+// PARAMETERS : p1 - color for the first player
+//              p2 - color for the second player
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapOverview::SetPlayerColors( const Color &p1, const Color &p2 ) {
+  if ( (p1 != player_col[0]) || (p2 != player_col[1]) ) {
+    player_col[0] = p1;
+    player_col[1] = p2;
+    full = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapOverview::HexChanged
+// DESCRIPTION: Mark a hex for repainting on the next Update().
+// PARAMETERS : hex - hex which has changed
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapOverview::HexChanged( const Point &hex ) {
+  if ( map && !full && map->Contains( hex ) ) {
+    int index = map->Hex2Index( hex );
+    if ( !pending[index] ) {
+      pending[index] = true;
+      changed.push_back( hex );
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapOverview::Update
+// DESCRIPTION: Bring the image up to date.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapOverview::Update( void ) {
+  if ( !map ) return;
+
+  if ( full ) DrawMap();
+  else {
+    for ( vector<Point>::iterator it = changed.begin(); it != changed.end(); ++it ) {
+      DrawHex( *it );
+      pending[map->Hex2Index( *it )] = false;
+    }
+  }
+  changed.clear();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapOverview::HexRect
+// DESCRIPTION: Get the area covered by a hex in the image.
+// PARAMETERS : hex - hex position
+// RETURNS    : hex area
+////////////////////////////////////////////////////////////////////////
+
+Rect MapOverview::HexRect( const Point &hex ) const {
+  return Rect( magnify * hex.x,
+               magnify * hex.y + ((hex.x & 1) ? magnify / 2 : 0),
+               magnify, magnify );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapOverview::HexPixel
+// DESCRIPTION: Get the pixel value for a hex, i.e. the color of the
+//              owner of the unit or building on the hex, or the
+//              terrain color if there is none.
+// PARAMETERS : hex - hex position
+// RETURNS    : pixel value in the format of the image
+////////////////////////////////////////////////////////////////////////
+
+unsigned long MapOverview::HexPixel( const Point &hex ) {
+  MapObject *obj = map->GetMapObject( hex );
+  if ( obj && obj->Owner() ) return player_pix[obj->Owner()->ID()];
+
+  // neighbouring hexes usually share the same terrain color
+  unsigned long rgb = map->HexColor( map->Hex2Index( hex ) );
+  if ( rgb != last_rgb ) {
+    last_rgb = rgb;
+    last_pix = image.MapRGB( Color(rgb) );
+  }
+  return last_pix;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapOverview::DrawHex
+// DESCRIPTION: Repaint a single hex in both images.
+// PARAMETERS : hex - hex position
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapOverview::DrawHex( const Point &hex ) {
+  Rect r( HexRect( hex ) );
+  image.FillRect( r, HexPixel( hex ) );
+  image.Blit( &shaded, r, r.x, r.y );
+  shaded.FillRectAlpha( r, Color(CF_COLOR_BLACK), OVERVIEW_SHADE );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapOverview::DrawMap
+// DESCRIPTION: Repaint the complete map. For the common pixel formats
+//              the hexes are written to the image directly instead of
+//              using one FillRect() per hex.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapOverview::DrawMap( void ) {
+  SDL_Surface *s = image.s_surface;
+  const unsigned char bpp = s->format->BytesPerPixel;
+
+  player_pix[0] = image.MapRGB( player_col[0] );
+  player_pix[1] = image.MapRGB( player_col[1] );
+  last_rgb = map->HexColor( 0 );
+  last_pix = image.MapRGB( Color(last_rgb) );
+
+  image.Flood( Color(CF_COLOR_BACKGROUND) );
+
+  if ( ((bpp == 2) || (bpp == 4)) && (SDL_LockSurface( s ) == 0) ) {
+    for ( int py = 0; py < map->Height(); ++py ) {
+      for ( int px = 0; px < map->Width(); ++px ) {
+        Point hex( px, py );
+        Rect r( HexRect( hex ) );
+        unsigned long pix = HexPixel( hex );
+        Uint8 *row = (Uint8 *)s->pixels + r.y * s->pitch + r.x * bpp;
+
+        for ( int i = 0; i < magnify; ++i, row += s->pitch ) {
+          if ( bpp == 2 ) {
+            Uint16 *p = (Uint16 *)row;
+            for ( int j = 0; j < magnify; ++j ) p[j] = (Uint16)pix;
+          } else {
+            Uint32 *p = (Uint32 *)row;
+            for ( int j = 0; j < magnify; ++j ) p[j] = (Uint32)pix;
+          }
+        }
+      }
+    }
+    SDL_UnlockSurface( s );
+  } else {
+    for ( int py = 0; py < map->Height(); ++py ) {
+      for ( int px = 0; px < map->Width(); ++px ) {
+        Point hex( px, py );
+        image.FillRect( HexRect( hex ), HexPixel( hex ) );
+      }
+    }
+  }
+
+  image.Blit( &shaded, image, 0, 0 );
+  shaded.FillRectAlpha( shaded, Color(CF_COLOR_BLACK), OVERVIEW_SHADE );
+
+  pending.assign( pending.size(), false );
+  full = false;
+}
+
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : MapWidget::MapWidget
 // DESCRIPTION: Create a new map widget. This widget displays a small
@@ -41,7 +235,8 @@
 
 MapWidget::MapWidget( short id, short x, short y, unsigned short w,
            unsigned short h, unsigned short flags, Window *window ) :
-   Widget( id, x, y, w, h, flags, NULL, window ), magnify(0), draw_vp(false) {
+   Widget( id, x, y, w, h, flags, NULL, window ), overview(&own),
+   magnify(0), draw_vp(false) {
   Surface *icons = window->GetView()->GetSystemIcons();
   bumper[0] = Image( icons, 157, 46, 11, 7 ); // up
   bumper[1] = Image( icons, 157, 53, 11, 7 ); // down
@@ -60,24 +255,31 @@ void MapWidget::Draw( void ) {
   surface->DrawBox( *this, BOX_RECESSED );
 
   if ( magnify != 0 ) {
-    // blit mapbuffer to window surface
-    mapbuffer.Blit( surface, mp, x + 1, y + 1 );
+    const Surface &image = overview->GetImage();
 
     if ( draw_vp ) {
-      // darken the entire map, then light up the visible part
-      surface->FillRectAlpha( Rect(x+1,y+1,w-2,h-2), Color(CF_COLOR_BLACK), 96 );
-      mapbuffer.Blit( surface, vp, x + 1 + (vp.x - mp.x),
-                                   y + 1 + (vp.y - mp.y) );
-    }
+      // show the darkened map, then light up the visible part
+      overview->GetShadedImage().Blit( surface, mp, x + 1, y + 1 );
+      image.Blit( surface, vp, x + 1 + (vp.x - mp.x),
+                               y + 1 + (vp.y - mp.y) );
+
+      // darken the widget area not covered by the map as well
+      if ( mp.w < w - 2 )
+        surface->FillRectAlpha( x + 1 + mp.w, y + 1, w - 2 - mp.w, h - 2,
+                                Color(CF_COLOR_BLACK), OVERVIEW_SHADE );
+      if ( mp.h < h - 2 )
+        surface->FillRectAlpha( x + 1, y + 1 + mp.h, mp.w, h - 2 - mp.h,
+                                Color(CF_COLOR_BLACK), OVERVIEW_SHADE );
+    } else image.Blit( surface, mp, x + 1, y + 1 );
 
     if ( mp.x > 0 )
       bumper[2].Draw( surface, x + 3, y + (h - bumper[2].Height()) / 2 );
-    if ( mp.x + mp.w < mapbuffer.w )
+    if ( mp.x + mp.w < image.w )
       bumper[3].Draw( surface, x + w - 3 - bumper[3].Width(), y + (h - bumper[3].Height()) / 2 );
 
     if ( mp.y > 0 )
       bumper[0].Draw( surface, x + (w - bumper[0].Width()) / 2, y + 3 );
-    if ( mp.y + mp.h < mapbuffer.h )
+    if ( mp.y + mp.h < image.h )
       bumper[1].Draw( surface, x + (w - bumper[1].Width()) / 2, y + h - 3 - bumper[1].Height() );
   }
 }
@@ -94,19 +296,37 @@ void MapWidget::Draw( void ) {
 ////////////////////////////////////////////////////////////////////////
 
 void MapWidget::SetMap( const Map *map, const Rect &viewport, unsigned char magnify ) {
-  this->magnify = 0;
+  // the map object may have been reused for a different map, so
+  // always paint everything
+  own.Invalidate();
+  if ( own.SetMap( map, magnify ) ) own.SetMap( NULL, 0 );
+  SetOverview( &own, viewport );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : MapWidget::SetOverview
+// DESCRIPTION: Display an overview which is kept outside the widget.
+//              This allows reusing the overview image for different
+//              widgets without repainting it every time.
+// PARAMETERS : overview - map overview
+//              viewport - visible part of the map in hexes. A box will
+//                         be drawn around this area if the viewport is
+//                         smaller than the map.
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void MapWidget::SetOverview( MapOverview *overview, const Rect &viewport ) {
+  const Map *map = overview->GetMap();
+
+  this->overview = overview;
+  magnify = 0;
 
   if ( map ) {
+    overview->Update();
     mapsize.x = map->Width();
     mapsize.y = map->Height();
-
-    if ( !mapbuffer.Create( map->Width() * magnify,
-                            map->Height() * magnify + magnify/2,
-                            DISPLAY_BPP, 0 ) ) {
-      this->magnify = magnify;
-      SetViewPort( viewport );
-      DrawMap( map );
-    }
+    magnify = overview->Magnify();
+    SetViewPort( viewport );
   }
 }
 
@@ -136,7 +356,7 @@ void MapWidget::SetViewPort( const Rect &viewport ) {
 
     if ( draw_vp ) {
       mp.Center( vp );
-      mp.Align( mapbuffer );
+      mp.Align( overview->GetImage() );
     }
 
     last_hex.x = viewport.x + viewport.w/2;
@@ -144,37 +364,6 @@ void MapWidget::SetViewPort( const Rect &viewport ) {
   }
 }
 
-////////////////////////////////////////////////////////////////////////
-// NAME       : MapWidget::DrawMap
-// DESCRIPTION: Draw the map into the internal buffer. From there it can
-//              be blitted as often as needed.
-// PARAMETERS : map - map to draw
-// RETURNS    : -
-////////////////////////////////////////////////////////////////////////
-
-void MapWidget::DrawMap( const Map *map ) const {
-  Color color;
-  unsigned short index = 0;
-  short yoff;
-
-  mapbuffer.Flood( Color(CF_COLOR_BACKGROUND) );
-
-  for ( int py = 0; py < map->Height(); ++py ) {
-    for ( int px = 0; px < map->Width(); ++px ) {
-      if ( px & 1 ) yoff = magnify / 2;
-      else yoff = 0;
-
-      MapObject *obj = map->GetMapObject( Point(px, py) );
-      if ( obj && obj->Owner() ) color = player_col[obj->Owner()->ID()];
-      else color = Color( map->HexColor( index ) );
-      ++index;
-      mapbuffer.FillRect(
-                magnify * px, magnify * py + yoff,
-                magnify, magnify, color );
-    }
-  }
-}
-
 ////////////////////////////////////////////////////////////////////////
 // NAME       : MapWidget::MouseDown
 // DESCRIPTION: Report the hex the user clicked on to the hook and let
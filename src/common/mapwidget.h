@@ -23,9 +23,52 @@
 #ifndef _INCLUDE_MAPWIDGET_H
 #define _INCLUDE_MAPWIDGET_H
 
+#include <vector>
+using namespace std;
+
 #include "widget.h"
 #include "map.h"
 
+// Small image of the map with one square of magnify x magnify pixels
+// per hex. When registered as an observer with the map, only the hexes
+// which have changed since the last Update() are repainted. Besides
+// the image itself a darkened copy is kept which the MapWidget uses to
+// mark the area outside the viewport.
+class MapOverview : public HexObserver {
+public:
+  MapOverview( void ) : map(0), magnify(0), full(true) {}
+
+  int SetMap( const Map *map, unsigned char magnify );
+  void SetPlayerColors( const Color &p1, const Color &p2 );
+  void Update( void );
+  void Invalidate( void ) { full = true; }
+
+  const Map *GetMap( void ) const { return map; }
+  unsigned char Magnify( void ) const { return magnify; }
+  const Surface &GetImage( void ) const { return image; }
+  const Surface &GetShadedImage( void ) const { return shaded; }
+
+  void HexChanged( const Point &hex );
+
+private:
+  void DrawMap( void );
+  void DrawHex( const Point &hex );
+  Rect HexRect( const Point &hex ) const;
+  unsigned long HexPixel( const Point &hex );
+
+  const Map *map;
+  unsigned char magnify;
+  bool full;                  // repaint everything on the next Update()
+  Surface image;
+  Surface shaded;
+  vector<Point> changed;      // hexes to repaint on the next Update()
+  vector<bool> pending;       // hexes already in the changed list
+  Color player_col[2];
+  unsigned long player_pix[2];
+  unsigned long last_rgb;     // last terrain color and its pixel value
+  unsigned long last_pix;
+};
+
 class MapWidget : public Widget {
 public:
   MapWidget( short id, short x, short y, unsigned short w,
@@ -35,8 +78,9 @@ public:
   void Draw( void );
 
   void SetMap( const Map *map, const Rect &viewport, unsigned char magnify );
+  void SetOverview( MapOverview *overview, const Rect &viewport );
   void SetPlayerColors( const Color &p1, const Color &p2 )
-                      { player_col[0] = p1; player_col[1] = p2; }
+                      { own.SetPlayerColors( p1, p2 ); }
   void SetViewPort( const Rect &viewport );
   const Point &GetLastHex( void ) const { return last_hex; }
 
@@ -44,16 +88,14 @@ public:
   GUI_Status KeyDown( const SDL_keysym &key );
 
 private:
-  void DrawMap( const Map *map ) const;
-
-  Surface mapbuffer;
+  MapOverview own;            // used if no overview was supplied
+  MapOverview *overview;
   unsigned char magnify;
   Point mapsize;    // map width and height
   Rect vp;
   Rect mp;
   bool draw_vp;
   Point last_hex;   // where the user last clicked
-  Color player_col[2];
   Image bumper[4];
 };
 
@@ -178,3 +178,25 @@ bool Rect::Contains( short x, short y ) const {
        && (y >= this->y) && (y < (this->y + h)) );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Rect::Union
+// DESCRIPTION: Grow the Rect so that it also covers another rectangle.
+//              Empty rectangles are ignored.
+// PARAMETERS : r - rectangle to add
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Rect::Union( const Rect &r ) {
+  if ( r.IsEmpty() ) return;
+
+  if ( IsEmpty() ) *this = r;
+  else {
+    short x2 = x + w, y2 = y + h;
+    if ( r.x + r.w > x2 ) x2 = r.x + r.w;
+    if ( r.y + r.h > y2 ) y2 = r.y + r.h;
+    if ( r.x < x ) x = r.x;
+    if ( r.y < y ) y = r.y;
+    w = x2 - x;
+    h = y2 - y;
+  }
+}
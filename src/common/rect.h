@@ -39,6 +39,8 @@ public:
   void Clip( const Rect &clip );
   void ClipBlit( Rect &src, const Rect &clip );
   bool Contains( short x, short y ) const;
+  void Union( const Rect &r );
+  bool IsEmpty( void ) const { return (w == 0) || (h == 0); }
 
   bool operator>=( const Rect &r ) const
                  { return (w >= r.w) && (h >= r.h); }
@@ -22,6 +22,262 @@
 
 #include "surface.h"
 #include "globals.h"
+#include "misc.h"
+
+// SIMD blend kernels need intrinsics and per-function target
+// attributes so that the rest of the program can still run on
+// processors without those extensions
+#if defined(__GNUC__) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))) && \
+    (defined(__i386__) || defined(__x86_64__))
+# define CF_BLEND_SIMD
+# include <immintrin.h>
+# define CF_TARGET(t) __attribute__((target(t)))
+#endif
+
+// Alpha blending with a constant colour. For every colour channel c of
+// a pixel the result is (c * (256 - alpha) + col * alpha) >> 8, computed
+// on 8 bit values. This is exactly what the generic loop in
+// Surface::BlendPixels() does, and it never exceeds 16 bits, so the
+// vector kernels can work on 16 bit lanes.
+struct BlendParams {
+  Uint32 mask[3];     // channel masks
+  Uint8 shift[3];
+  Uint8 loss[3];
+  Uint16 add[3];      // colour * alpha per channel
+  Uint16 inv;         // 256 - alpha
+  Uint32 fixed;       // other pixel bits (set like SDL_MapRGB() does)
+  Uint16 add8[4];     // 32 bit surfaces: add and inv for each byte
+  Uint16 inv8[4];     // of a pixel in memory order
+};
+
+typedef void (*BlendFunc16)( Uint16 *, int, const BlendParams & );
+typedef void (*BlendFunc32)( Uint32 *, int, const BlendParams & );
+
+static BlendKernel blend_kernel = BLEND_AUTO;   // resolved on first use
+static BlendFunc16 blend16 = NULL;
+static BlendFunc32 blend32 = NULL;
+
+template <class T>
+static void blend_scalar( T *pix, int n, const BlendParams &bp ) {
+  for ( int i = 0; i < n; ++i ) {
+    Uint32 p = pix[i], out = bp.fixed;
+
+    for ( int c = 0; c < 3; ++c ) {
+      Uint32 v = ((p & bp.mask[c]) >> bp.shift[c]) << bp.loss[c];
+      v = (v * bp.inv + bp.add[c]) >> 8;
+      out |= (v >> bp.loss[c]) << bp.shift[c];
+    }
+    pix[i] = out;
+  }
+}
+
+#ifdef CF_BLEND_SIMD
+CF_TARGET("sse2")
+static void blend16_sse2( Uint16 *pix, int n, const BlendParams &bp ) {
+  __m128i mask[3], shift[3], loss[3], add[3];
+  __m128i inv = _mm_set1_epi16( bp.inv );
+  __m128i fixed = _mm_set1_epi16( bp.fixed );
+  int i, c;
+
+  for ( c = 0; c < 3; ++c ) {
+    mask[c] = _mm_set1_epi16( bp.mask[c] );
+    shift[c] = _mm_cvtsi32_si128( bp.shift[c] );
+    loss[c] = _mm_cvtsi32_si128( bp.loss[c] );
+    add[c] = _mm_set1_epi16( bp.add[c] );
+  }
+
+  for ( i = 0; i + 8 <= n; i += 8 ) {
+    __m128i p = _mm_loadu_si128( (__m128i *)(pix + i) );
+    __m128i out = fixed;
+
+    for ( c = 0; c < 3; ++c ) {
+      __m128i v = _mm_srl_epi16( _mm_and_si128( p, mask[c] ), shift[c] );
+      v = _mm_sll_epi16( v, loss[c] );
+      v = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( v, inv ), add[c] ), 8 );
+      out = _mm_or_si128( out, _mm_sll_epi16( _mm_srl_epi16( v, loss[c] ), shift[c] ) );
+    }
+    _mm_storeu_si128( (__m128i *)(pix + i), out );
+  }
+
+  blend_scalar( pix + i, n - i, bp );
+}
+
+CF_TARGET("sse2")
+static void blend32_sse2( Uint32 *pix, int n, const BlendParams &bp ) {
+  const Uint16 *a = bp.add8, *v = bp.inv8;
+  __m128i add = _mm_setr_epi16( a[0], a[1], a[2], a[3], a[0], a[1], a[2], a[3] );
+  __m128i inv = _mm_setr_epi16( v[0], v[1], v[2], v[3], v[0], v[1], v[2], v[3] );
+  __m128i zero = _mm_setzero_si128();
+  int i;
+
+  for ( i = 0; i + 4 <= n; i += 4 ) {
+    __m128i p = _mm_loadu_si128( (__m128i *)(pix + i) );
+    __m128i lo = _mm_unpacklo_epi8( p, zero );
+    __m128i hi = _mm_unpackhi_epi8( p, zero );
+
+    lo = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( lo, inv ), add ), 8 );
+    hi = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( hi, inv ), add ), 8 );
+    _mm_storeu_si128( (__m128i *)(pix + i), _mm_packus_epi16( lo, hi ) );
+  }
+
+  blend_scalar( pix + i, n - i, bp );
+}
+
+CF_TARGET("avx2")
+static void blend16_avx2( Uint16 *pix, int n, const BlendParams &bp ) {
+  __m256i mask[3], add[3];
+  __m128i shift[3], loss[3];
+  __m256i inv = _mm256_set1_epi16( bp.inv );
+  __m256i fixed = _mm256_set1_epi16( bp.fixed );
+  int i, c;
+
+  for ( c = 0; c < 3; ++c ) {
+    mask[c] = _mm256_set1_epi16( bp.mask[c] );
+    shift[c] = _mm_cvtsi32_si128( bp.shift[c] );
+    loss[c] = _mm_cvtsi32_si128( bp.loss[c] );
+    add[c] = _mm256_set1_epi16( bp.add[c] );
+  }
+
+  for ( i = 0; i + 16 <= n; i += 16 ) {
+    __m256i p = _mm256_loadu_si256( (__m256i *)(pix + i) );
+    __m256i out = fixed;
+
+    for ( c = 0; c < 3; ++c ) {
+      __m256i v = _mm256_srl_epi16( _mm256_and_si256( p, mask[c] ), shift[c] );
+      v = _mm256_sll_epi16( v, loss[c] );
+      v = _mm256_srli_epi16( _mm256_add_epi16( _mm256_mullo_epi16( v, inv ), add[c] ), 8 );
+      out = _mm256_or_si256( out, _mm256_sll_epi16( _mm256_srl_epi16( v, loss[c] ), shift[c] ) );
+    }
+    _mm256_storeu_si256( (__m256i *)(pix + i), out );
+  }
+
+  // avoid the penalty for mixing AVX and SSE instructions
+  _mm256_zeroupper();
+  blend16_sse2( pix + i, n - i, bp );
+}
+
+CF_TARGET("avx2")
+static void blend32_avx2( Uint32 *pix, int n, const BlendParams &bp ) {
+  const Uint16 *a = bp.add8, *v = bp.inv8;
+  __m256i add = _mm256_setr_epi16( a[0], a[1], a[2], a[3], a[0], a[1], a[2], a[3],
+                                   a[0], a[1], a[2], a[3], a[0], a[1], a[2], a[3] );
+  __m256i inv = _mm256_setr_epi16( v[0], v[1], v[2], v[3], v[0], v[1], v[2], v[3],
+                                   v[0], v[1], v[2], v[3], v[0], v[1], v[2], v[3] );
+  __m256i zero = _mm256_setzero_si256();
+  int i;
+
+  // unpack and pack both work within 128 bit lanes, so the pixel
+  // order is preserved
+  for ( i = 0; i + 8 <= n; i += 8 ) {
+    __m256i p = _mm256_loadu_si256( (__m256i *)(pix + i) );
+    __m256i lo = _mm256_unpacklo_epi8( p, zero );
+    __m256i hi = _mm256_unpackhi_epi8( p, zero );
+
+    lo = _mm256_srli_epi16( _mm256_add_epi16( _mm256_mullo_epi16( lo, inv ), add ), 8 );
+    hi = _mm256_srli_epi16( _mm256_add_epi16( _mm256_mullo_epi16( hi, inv ), add ), 8 );
+    _mm256_storeu_si256( (__m256i *)(pix + i), _mm256_packus_epi16( lo, hi ) );
+  }
+
+  // avoid the penalty for mixing AVX and SSE instructions
+  _mm256_zeroupper();
+  blend32_sse2( pix + i, n - i, bp );
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : BlendSupported
+// DESCRIPTION: Check whether a blending implementation can be used on
+//              this machine.
+// PARAMETERS : kernel - blending implementation
+// RETURNS    : true if kernel is available, false otherwise
+////////////////////////////////////////////////////////////////////////
+
+static bool BlendSupported( BlendKernel kernel ) {
+  switch ( kernel ) {
+  case BLEND_GENERIC:
+  case BLEND_SCALAR:
+    return true;
+#ifdef CF_BLEND_SIMD
+  case BLEND_SSE2:
+    return SDL_HasSSE2() != 0;
+  case BLEND_AVX2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+  default:
+    return false;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : BlendSetup
+// DESCRIPTION: Prepare blending a colour into the pixels of a surface.
+// PARAMETERS : bp    - blending parameters to initialize
+//              fmt   - pixel format of the destination surface
+//              col   - colour to blend
+//              alpha - alpha value to use for blending
+// RETURNS    : true if one of the fast kernels can be used, false if
+//              the generic loop must be used
+////////////////////////////////////////////////////////////////////////
+
+static bool BlendSetup( BlendParams &bp, const SDL_PixelFormat *fmt,
+                        const Color &col, unsigned char alpha ) {
+  if ( blend_kernel == BLEND_AUTO ) Surface::SetBlendKernel( BLEND_AUTO );
+  if ( blend_kernel == BLEND_GENERIC ) return false;
+
+  const Uint32 masks[3] = { fmt->Rmask, fmt->Gmask, fmt->Bmask };
+  const Uint8 shifts[3] = { fmt->Rshift, fmt->Gshift, fmt->Bshift };
+  const Uint8 losses[3] = { fmt->Rloss, fmt->Gloss, fmt->Bloss };
+  const unsigned char cols[3] = { col.r, col.g, col.b };
+
+  if ( fmt->BytesPerPixel == 4 ) {
+    // 32 bit kernels expect one byte per channel
+    for ( int c = 0; c < 3; ++c ) {
+      if ( (losses[c] != 0) || (shifts[c] & 7) ) return false;
+    }
+  } else if ( fmt->BytesPerPixel != 2 ) return false;
+
+  bp.inv = 256 - alpha;
+  bp.fixed = fmt->Amask;
+  for ( int i = 0; i < 4; ++i ) {
+    // bytes outside the colour channels are replaced by the
+    // corresponding byte of fixed
+    int byte = (SDL_BYTEORDER == SDL_LIL_ENDIAN) ? i : 3 - i;
+    bp.add8[i] = ((fmt->Amask >> (byte * 8)) & 0xff) << 8;
+    bp.inv8[i] = 0;
+  }
+
+  for ( int c = 0; c < 3; ++c ) {
+    bp.mask[c] = masks[c];
+    bp.shift[c] = shifts[c];
+    bp.loss[c] = losses[c];
+    bp.add[c] = cols[c] * alpha;
+
+    int byte = shifts[c] / 8;
+    if ( SDL_BYTEORDER != SDL_LIL_ENDIAN ) byte = 3 - byte;
+    if ( byte < 4 ) {
+      bp.add8[byte] = bp.add[c];
+      bp.inv8[byte] = bp.inv;
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : BlendRow
+// DESCRIPTION: Blend a colour into a row of pixels.
+// PARAMETERS : bits - first pixel
+//              n    - number of pixels
+//              bpp  - bytes per pixel (2 or 4)
+//              bp   - blending parameters from BlendSetup()
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+static inline void BlendRow( Uint8 *bits, int n, Uint8 bpp, const BlendParams &bp ) {
+  if ( bpp == 2 ) blend16( (Uint16 *)bits, n, bp );
+  else blend32( (Uint32 *)bits, n, bp );
+}
 
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Surface::~Surface
@@ -65,6 +321,23 @@ int Surface::SetColorKey( const Color &col ) {
   return SDL_SetColorKey( s_surface, SDL_SRCCOLORKEY, MapRGB( col ) );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Surface::EnableRLE
+// DESCRIPTION: Run-length encode the transparent parts of a surface
+//              with a colour key. This makes blits from the surface a
+//              lot faster, but direct access to the pixels becomes
+//              expensive, so only use it for surfaces which are not
+//              modified anymore.
+// PARAMETERS : -
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int Surface::EnableRLE( void ) {
+  if ( (s_surface == 0) || !(s_surface->flags & SDL_SRCCOLORKEY) ) return -1;
+  return SDL_SetColorKey( s_surface, SDL_SRCCOLORKEY|SDL_RLEACCEL,
+                          s_surface->format->colorkey );
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Surface::GetColorKey
 // DESCRIPTION: Get transparent color for this surface.
@@ -88,35 +361,112 @@ Color Surface::GetColorKey( void ) const {
 
 Color Surface::GetPixel( unsigned short x, unsigned short y ) const {
   Uint8 r, g, b, bpp = s_surface->format->BytesPerPixel;
-  Uint32 col = 0;
+  Uint32 col;
 
   {
     SurfaceLock lck( this );
-    Uint8 *pixel = ((Uint8 *)s_surface->pixels) + y * s_surface->pitch + x * bpp;
-
-    switch ( bpp ) {
-    case 1: 
-      col = *pixel;
-      break;
-    case 2:
-      col = *((Uint16 *)pixel);
-      break;
-    case 3:
-      if ( SDL_BYTEORDER == SDL_LIL_ENDIAN )
-        col = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
-      else
-        col = (pixel[0] << 16) | (pixel[1] << 8) | pixel[2];
-      break;
-    case 4:
-      col = *((Uint32 *)pixel);
-      break;
-    }
+    col = ReadPixel( ((Uint8 *)s_surface->pixels) + y * s_surface->pitch + x * bpp, bpp );
   }
 
   SDL_GetRGB( col, s_surface->format, &r, &g, &b );
   return Color( r, g, b );
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Surface::ReadPixel
+// DESCRIPTION: Read a raw pixel value. The surface must be locked.
+// PARAMETERS : pixel - address of the pixel
+//              bpp   - bytes per pixel
+// RETURNS    : pixel value in the surface format
+////////////////////////////////////////////////////////////////////////
+
+Uint32 Surface::ReadPixel( const Uint8 *pixel, Uint8 bpp ) {
+  Uint32 col = 0;
+
+  switch ( bpp ) {
+  case 1:
+    col = *pixel;
+    break;
+  case 2:
+    col = *((const Uint16 *)pixel);
+    break;
+  case 3:
+    if ( SDL_BYTEORDER == SDL_LIL_ENDIAN )
+      col = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
+    else
+      col = (pixel[0] << 16) | (pixel[1] << 8) | pixel[2];
+    break;
+  case 4:
+    col = *((const Uint32 *)pixel);
+    break;
+  }
+  return col;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Surface::ScaleDown
+// DESCRIPTION: Create a reduced copy of the surface. Each pixel of the
+//              copy is the average of a square of factor x factor
+//              pixels of the original. If the surface has a colour key
+//              and most of the pixels in a square are transparent, the
+//              resulting pixel is transparent as well. The surface is
+//              locked only once, so this is also reasonably fast for
+//              RLE encoded surfaces.
+// PARAMETERS : dest   - surface to create the copy in
+//              factor - reduction factor
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
+
+int Surface::ScaleDown( Surface &dest, unsigned char factor ) const {
+  if ( (s_surface == 0) || (factor == 0) ) return -1;
+  if ( dest.Create( w / factor, h / factor, 32, SDL_SWSURFACE ) ) return -1;
+
+  const SDL_PixelFormat *fmt = s_surface->format;
+  bool keyed = (s_surface->flags & SDL_SRCCOLORKEY) != 0;
+  Color key( 0, 0, 0 );
+  if ( keyed ) {
+    key = GetColorKey();
+    dest.SetColorKey( key );
+  }
+
+  SurfaceLock slck( this );
+  SurfaceLock dlck( &dest );
+  Uint8 bpp = fmt->BytesPerPixel;
+
+  for ( short y = 0; y < dest.h; ++y ) {
+    for ( short x = 0; x < dest.w; ++x ) {
+      unsigned long r = 0, g = 0, b = 0;
+      unsigned short n = 0;
+
+      for ( short sy = y * factor; sy < (y + 1) * factor; ++sy ) {
+        const Uint8 *pixel = (Uint8 *)s_surface->pixels +
+                             sy * s_surface->pitch + x * factor * bpp;
+
+        for ( short sx = 0; sx < factor; ++sx, pixel += bpp ) {
+          Uint32 col = ReadPixel( pixel, bpp );
+          if ( keyed && (col == fmt->colorkey) ) continue;
+
+          Uint8 pr, pg, pb;
+          SDL_GetRGB( col, s_surface->format, &pr, &pg, &pb );
+          r += pr;
+          g += pg;
+          b += pb;
+          ++n;
+        }
+      }
+
+      if ( n * 2 < factor * factor ) dest.DrawPixel( x, y, key );
+      else {
+        Color col( r / n, g / n, b / n );
+        // don't let the average become transparent by accident
+        if ( keyed && (col == key) ) col.b ^= 1;
+        dest.DrawPixel( x, y, col );
+      }
+    }
+  }
+  return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Surface::DisplayFormat
 // DESCRIPTION: Convert surface format to display format.
@@ -261,56 +611,170 @@ int Surface::FillRect( short x, short y, unsigned short w, unsigned short h,
 
 int Surface::FillRectAlpha( short x, short y, unsigned short w, unsigned short h,
                             const Color &col, unsigned char alpha /* = 128 */ ) const {
-  Uint8 *bits, bpp;
-  SDL_PixelFormat *fmt = s_surface->format;
-
-  // get offset into surface buffer
-  bpp = fmt->BytesPerPixel;
+  Uint8 bpp = s_surface->format->BytesPerPixel;
   if ( bpp < 2 ) return FillRect( x, y, w, h, col );   // not supported
 
+  BlendParams bp;
+  bool fast = BlendSetup( bp, s_surface->format, col, alpha );
+
   SurfaceLock lck( this );
 
   for ( int py = y; py < y + h; ++py ) {
-    bits = ((Uint8 *)s_surface->pixels) + py * s_surface->pitch + x * bpp;
-
-    for ( int px = x; px < x + w; ++px ) {
-      unsigned char r, g, b;
-      Uint32 pixel = 0;
-
-      // get pixel from surface
-      switch ( bpp ) {
-        case 2:
-          pixel = *((Uint16 *)(bits));
-          break;
-        case 3:
-          if ( SDL_BYTEORDER == SDL_LIL_ENDIAN )
-            pixel = bits[0] + (bits[1] << 8) + (bits[2] << 16);
-          else
-            pixel = (bits[0] << 16) + (bits[1] << 8) + bits[2];
-          break;
-        case 4:
-          pixel = *((Uint32 *)(bits));
-          break;
-      }
+    if ( fast )
+      BlendRow( ((Uint8 *)s_surface->pixels) + py * s_surface->pitch + x * bpp,
+                w, bpp, bp );
+    else BlendPixels( x, py, w, col, alpha );
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Surface::FillRunsAlpha
+// DESCRIPTION: Draw a shape using alpha-blending.
+// PARAMETERS : runs  - pixel runs making up the shape
+//              count - number of runs
+//              x     - horizontal offset of the shape on the surface
+//              y     - vertical offset of the shape on the surface
+//              clip  - clipping rectangle
+//              col   - color of the shape
+//              alpha - alpha value to use for blending (default 128)
+// RETURNS    : 0 on success, -1 on error
+////////////////////////////////////////////////////////////////////////
 
-      // get RGB values from pixel
-      r = (((pixel&fmt->Rmask)>>fmt->Rshift)<<fmt->Rloss);
-      g = (((pixel&fmt->Gmask)>>fmt->Gshift)<<fmt->Gloss);
-      b = (((pixel&fmt->Bmask)>>fmt->Bshift)<<fmt->Bloss);
+int Surface::FillRunsAlpha( const PixelRun *runs, unsigned int count,
+                            short x, short y, const Rect &clip, const Color &col,
+                            unsigned char alpha /* = 128 */ ) const {
+  Uint8 bpp = s_surface->format->BytesPerPixel;
+  if ( bpp < 2 ) return -1;
 
-      // blend with alpha
-      r = (((col.r-r)*alpha)>>8) + r;
-      g = (((col.g-g)*alpha)>>8) + g;
-      b = (((col.b-b)*alpha)>>8) + b;
-      DrawPixel( px, py, Color( r, g, b ) );
+  // don't use Rect::Clip() here; some tools link without rect.cpp
+  const SDL_Rect &sclip = s_surface->clip_rect;
+  int cx1 = MAX( clip.x, sclip.x ), cy1 = MAX( clip.y, sclip.y );
+  int cx2 = MIN( clip.x + clip.w, sclip.x + sclip.w );
+  int cy2 = MIN( clip.y + clip.h, sclip.y + sclip.h );
+  if ( (cx1 >= cx2) || (cy1 >= cy2) ) return 0;
 
-      bits += bpp;
+  BlendParams bp;
+  bool fast = BlendSetup( bp, s_surface->format, col, alpha );
+
+  SurfaceLock lck( this );
+
+  for ( const PixelRun *it = runs; it < runs + count; ++it ) {
+    int py = y + it->y;
+    if ( (py < cy1) || (py >= cy2) ) continue;
+
+    int x1 = MAX( x + it->x, cx1 );
+    int x2 = MIN( x + it->x + it->w, cx2 );
+    if ( x1 >= x2 ) continue;
+
+    if ( fast )
+      BlendRow( ((Uint8 *)s_surface->pixels) + py * s_surface->pitch + x1 * bpp,
+                x2 - x1, bpp, bp );
+    else BlendPixels( x1, py, x2 - x1, col, alpha );
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Surface::BlendPixels
+// DESCRIPTION: Blend a colour into a row of pixels. This is the
+//              generic version which works for all pixel formats with
+//              at least 16 bits. Like DrawPixel() it does not lock the
+//              surface.
+// PARAMETERS : x     - leftmost pixel
+//              y     - row
+//              w     - number of pixels
+//              col   - colour to blend
+//              alpha - alpha value to use for blending
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void Surface::BlendPixels( short x, short y, unsigned short w,
+                           const Color &col, unsigned char alpha ) const {
+  SDL_PixelFormat *fmt = s_surface->format;
+  Uint8 bpp = fmt->BytesPerPixel;
+  Uint8 *bits = ((Uint8 *)s_surface->pixels) + y * s_surface->pitch + x * bpp;
+
+  for ( int px = x; px < x + w; ++px ) {
+    unsigned char r, g, b;
+    Uint32 pixel = 0;
+
+    // get pixel from surface
+    switch ( bpp ) {
+      case 2:
+        pixel = *((Uint16 *)(bits));
+        break;
+      case 3:
+        if ( SDL_BYTEORDER == SDL_LIL_ENDIAN )
+          pixel = bits[0] + (bits[1] << 8) + (bits[2] << 16);
+        else
+          pixel = (bits[0] << 16) + (bits[1] << 8) + bits[2];
+        break;
+      case 4:
+        pixel = *((Uint32 *)(bits));
+        break;
     }
+
+    // get RGB values from pixel
+    r = (((pixel&fmt->Rmask)>>fmt->Rshift)<<fmt->Rloss);
+    g = (((pixel&fmt->Gmask)>>fmt->Gshift)<<fmt->Gloss);
+    b = (((pixel&fmt->Bmask)>>fmt->Bshift)<<fmt->Bloss);
+
+    // blend with alpha
+    r = (((col.r-r)*alpha)>>8) + r;
+    g = (((col.g-g)*alpha)>>8) + g;
+    b = (((col.b-b)*alpha)>>8) + b;
+    DrawPixel( px, y, Color( r, g, b ) );
+
+    bits += bpp;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : Surface::SetBlendKernel
+// DESCRIPTION: Select the implementation used for alpha blending.
+// PARAMETERS : kernel - blending implementation
+// RETURNS    : 0 on success, -1 if kernel is not supported on this
+//              machine
+////////////////////////////////////////////////////////////////////////
+
+int Surface::SetBlendKernel( BlendKernel kernel ) {
+  if ( kernel == BLEND_AUTO ) {
+    kernel = BLEND_SCALAR;
+    if ( BlendSupported( BLEND_AVX2 ) ) kernel = BLEND_AVX2;
+    else if ( BlendSupported( BLEND_SSE2 ) ) kernel = BLEND_SSE2;
+  } else if ( !BlendSupported( kernel ) ) return -1;
+
+  blend16 = blend_scalar<Uint16>;
+  blend32 = blend_scalar<Uint32>;
+#ifdef CF_BLEND_SIMD
+  if ( kernel == BLEND_SSE2 ) {
+    blend16 = blend16_sse2;
+    blend32 = blend32_sse2;
+  } else if ( kernel == BLEND_AVX2 ) {
+    blend16 = blend16_avx2;
+    blend32 = blend32_avx2;
   }
+#endif
 
+  blend_kernel = kernel;
   return 0;
 }
 
+////////////////////////////////////////////////////////////////////////
+// NAME       : Surface::GetBlendKernel
+// DESCRIPTION: Get the implementation used for alpha blending.
+// PARAMETERS : -
+// RETURNS    : blending implementation
+////////////////////////////////////////////////////////////////////////
+
+BlendKernel Surface::GetBlendKernel( void ) {
+  if ( blend_kernel == BLEND_AUTO ) SetBlendKernel( BLEND_AUTO );
+  return blend_kernel;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // NAME       : Surface::FillPattern
 // DESCRIPTION: Fill an area of the surface with a graphical pattern.
@@ -434,7 +898,7 @@ void Surface::DrawPixel( short x, short y, const Color &col ) const {
       *((bits) + s_surface->format->Bshift / 8) = b;
       break;
     case 4:
-      *((Uint16 *)(bits)) = (Uint16)pixel;
+      *((Uint32 *)(bits)) = pixel;
   }
 }
 
@@ -497,9 +961,15 @@ int Surface::LoadImageData( MemBuffer &file, bool hwsurface /* = false */ ) {
   if ( Create( width, height, bpp, (hwsurface ? SDL_HWSURFACE : 0) ) ) return -1;
   if ( LoadPalette( file, colors ) ) return -1;
 
-  for ( int y = 0; y < height; ++y ) {
-    if ( file.Read( (Uint8 *)s_surface->pixels + y * s_surface->pitch, width ) != width ) {
+  if ( s_surface->pitch == width ) {
+    // no padding, so we can read the whole image at once
+    if ( file.Read( s_surface->pixels, width * height ) != width * height )
       return -1;
+  } else {
+    for ( int y = 0; y < height; ++y ) {
+      if ( file.Read( (Uint8 *)s_surface->pixels + y * s_surface->pitch, width ) != width ) {
+        return -1;
+      }
     }
   }
 
@@ -23,6 +23,9 @@
 #ifndef _INCLUDE_SURFACE_H
 #define _INCLUDE_SURFACE_H
 
+#include <vector>
+using namespace std;
+
 #include "SDL.h"
 
 #include "rect.h"
@@ -41,6 +44,26 @@
 #define BOX_CARVED    0x0004  // |
 #define BOX_SOLID     0x0010  // fill box with background color
 
+// alpha blending implementations. BLEND_AUTO selects the fastest one
+// supported by the processor. BLEND_GENERIC is the per-pixel loop
+// which handles all pixel formats; the others only work for 16 and
+// 32 bit surfaces and fall back to BLEND_GENERIC otherwise. All
+// implementations produce identical results.
+enum BlendKernel {
+  BLEND_AUTO,
+  BLEND_GENERIC,
+  BLEND_SCALAR,
+  BLEND_SSE2,
+  BLEND_AVX2
+};
+
+// a horizontal line of pixels, used to describe arbitrary shapes
+struct PixelRun {
+  short x;
+  short y;
+  unsigned short w;
+};
+
 class Surface : public Rect {
 public:
   Surface( void ) : Rect( 0, 0, 0, 0 ) { s_surface = 0; }
@@ -52,6 +75,8 @@ public:
   int SetAlpha( unsigned char alpha, unsigned long flags )
                 { return SDL_SetAlpha( s_surface, flags, alpha ); }
   int SetColorKey( const Color &col );
+  int EnableRLE( void );
+  int ScaleDown( Surface &dest, unsigned char factor ) const;
   Color GetColorKey( void ) const;
   Color GetPixel( unsigned short x, unsigned short y ) const;
   unsigned long MapRGB( const Color &col ) const
@@ -75,6 +100,14 @@ public:
                 const Color &col, unsigned char alpha = 128 ) const;
   int FillRectAlpha( const Rect &rect, const Color &col, unsigned char alpha = 128 ) const
               { return FillRectAlpha( rect.x, rect.y, rect.w, rect.h, col, alpha ); }
+  int FillRunsAlpha( const PixelRun *runs, unsigned int count,
+                     short x, short y, const Rect &clip, const Color &col,
+                     unsigned char alpha = 128 ) const;
+  int FillRunsAlpha( const vector<PixelRun> &runs, short x, short y,
+                     const Rect &clip, const Color &col,
+                     unsigned char alpha = 128 ) const
+              { return runs.empty() ? 0 : FillRunsAlpha( &runs[0], runs.size(),
+                                                         x, y, clip, col, alpha ); }
   void FillPattern( short x, short y, unsigned short w, unsigned short h,
                     const class Image &pattern, short dx, short dy );
   void FillPattern( const Rect &rect, const class Image &pattern, short dx, short dy )
@@ -89,12 +122,18 @@ public:
 
   SDL_Surface *s_surface;
 
+  static int SetBlendKernel( BlendKernel kernel );
+  static BlendKernel GetBlendKernel( void );
+
 protected:
   enum {
     RAW_DATA_TRANSPARENT = 0x01
   };
 
   void DrawPixel( short const x, short const y, const Color &col ) const;
+  static Uint32 ReadPixel( const Uint8 *pixel, Uint8 bpp );
+  void BlendPixels( short x, short y, unsigned short w,
+                    const Color &col, unsigned char alpha ) const;
 };
 
 class SurfaceLock {
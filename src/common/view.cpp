@@ -132,19 +132,7 @@ void View::Update( const Rect &rect ) {
 ////////////////////////////////////////////////////////////////////////
 
 void View::Refresh( void ) {
-  Window *win = static_cast<Window *>( windows.Tail() );
-
-  Flood( Color(CF_COLOR_WHITE) );
-  while ( win ) {
-    if ( !win->Closed() ) {
-      win->Blit( this, Rect( 0, 0, win->Width(), win->Height() ),
-                 win->LeftEdge(), win->TopEdge() );
-    }
-    win = static_cast<Window *>( win->Prev() );
-  }
-
-  // now update the display
-  Update();
+  Refresh( *this );
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -155,23 +143,112 @@ void View::Refresh( void ) {
 ////////////////////////////////////////////////////////////////////////
 
 void View::Refresh( const Rect &refresh ) {
-  Window *window = static_cast<Window *>( windows.Tail() );
-  Rect v( refresh );
-  v.Clip( *this );
+  Damage( refresh );
+  Composite();
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : View::Damage
+// DESCRIPTION: Mark part of the display for recomposition. The area is
+//              merged with all areas it overlaps.
+// PARAMETERS : rect - damaged area
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void View::Damage( const Rect &rect ) {
+  Rect d( rect );
+  d.Clip( *this );
+
+  // SDL would interpret an empty area as the entire screen
+  if ( d.IsEmpty() ) return;
+
+  bool merged;
+  do {
+    merged = false;
+    for ( vector<Rect>::iterator it = damage.begin(); it != damage.end(); ++it ) {
+      if ( (it->x < d.x + d.w) && (d.x < it->x + it->w) &&
+           (it->y < d.y + d.h) && (d.y < it->y + it->h) ) {
+        // the merged area may overlap others, so start over
+        d.Union( *it );
+        damage.erase( it );
+        merged = true;
+        break;
+      }
+    }
+  } while ( merged );
+
+  if ( damage.size() >= VIEW_MAX_DAMAGE ) {
+    for ( vector<Rect>::iterator it = damage.begin(); it != damage.end(); ++it )
+      d.Union( *it );
+    damage.clear();
+  }
+
+  damage.push_back( d );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : View::Composite
+// DESCRIPTION: Copy the window surfaces to all damaged areas and update
+//              them on the display. If updates are disabled nothing
+//              happens.
+// PARAMETERS : -
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void View::Composite( void ) {
+  if ( !allow_updates || damage.empty() ) return;
+
+  vector<SDL_Rect> rects( damage.size() );
+  for ( unsigned int i = 0; i < damage.size(); ++i ) {
+    const Rect &d = damage[i];
+    CompositeRect( d );
+    rects[i].x = d.x;
+    rects[i].y = d.y;
+    rects[i].w = d.w;
+    rects[i].h = d.h;
+  }
+  damage.clear();
+
+  SDL_UpdateRects( s_surface, rects.size(), &rects[0] );
+}
+
+////////////////////////////////////////////////////////////////////////
+// NAME       : View::CompositeRect
+// DESCRIPTION: Copy the window surfaces to an area of the display
+//              surface. The windows are painted back to front, starting
+//              with the topmost window covering the whole area since
+//              nothing below it can be visible.
+// PARAMETERS : rect - area to compose
+// RETURNS    : -
+////////////////////////////////////////////////////////////////////////
+
+void View::CompositeRect( const Rect &rect ) {
+  Window *window;
+
+  for ( window = static_cast<Window *>( windows.Head() ); window;
+        window = static_cast<Window *>( window->Next() ) ) {
+    if ( !window->Closed() &&
+         (window->x <= rect.x) && (window->y <= rect.y) &&
+         (window->x + window->w >= rect.x + rect.w) &&
+         (window->y + window->h >= rect.y + rect.h) ) break;
+  }
+
+  if ( !window ) {
+    FillRect( rect, Color(CF_COLOR_WHITE) );
+    window = static_cast<Window *>( windows.Tail() );
+  }
 
-  FillRect( v, Color(CF_COLOR_WHITE) );
   while ( window ) {
     if ( !window->Closed() ) {
       // clip the window to the refresh area
       Rect win = *window;
       Rect src( 0, 0, window->Width(), window->Height() );
-      win.ClipBlit( src, v );
+      win.ClipBlit( src, rect );
       if ( win.Width() && win.Height() )
         window->Blit( this, src, win.LeftEdge(), win.TopEdge() );
     }
     window = static_cast<Window *>( window->Prev() );
   }
-  Update( v );
 }
 
 ////////////////////////////////////////////////////////////////////////
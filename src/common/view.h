@@ -23,11 +23,26 @@
 #ifndef _INCLUDE_VIEW_H
 #define _INCLUDE_VIEW_H
 
+#include <vector>
+using namespace std;
+
 #include "SDL.h"
 #include "window.h"
 
+// maximum number of separate damaged areas; if there are more they
+// are combined into one
+#define VIEW_MAX_DAMAGE  16
+
 typedef GUI_Status (*GUIEventFilter)( SDL_Event &event, Window *window );
 
+// The view composes the display from the window surfaces. Changed
+// areas are collected with Damage(), with overlapping areas merged,
+// and Composite() copies the windows to these areas and updates the
+// display with a single call. Windows which are completely hidden by
+// other windows in a damaged area are skipped. While updates are
+// disabled, damage is only collected. EnableUpdates() does not update
+// the display, the next Composite() or Refresh() takes care of the
+// damage collected in the meantime.
 class View : public Surface {
 public:
   View( unsigned short w, unsigned short h, short bpp, unsigned long flags );
@@ -39,6 +54,8 @@ public:
   void Update( const Rect &rect );
   void Refresh( void );
   void Refresh( const Rect &refresh );
+  void Damage( const Rect &rect );
+  void Composite( void );
   void AddWindow( Window *window );
   void SelectWindow( Window *window );
   Window *CloseWindow( Window *window );
@@ -68,8 +85,10 @@ public:
 
 private:
   GUI_Status SystemFilter( const SDL_Event &event );
+  void CompositeRect( const Rect &rect );
 
   List windows;
+  vector<Rect> damage;  // areas to be recomposed
   Font *sfont, *lfont;  // small and large fonts
   bool allow_updates;
 
@@ -0,0 +1,219 @@
+/* blendbench -- measure the alpha blending kernels of Crimson Fields
+   Copyright (C) 2000-2007 Jens Granseuer
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* shades a screen sized surface with every blending kernel the
+   processor supports and prints the average time for
+
+   rect  - Surface::FillRectAlpha() covering the whole surface, like
+           dialog shading and widget highlights
+   hex   - Surface::FillRunsAlpha() with a hex shaped mask tiled over
+           the surface, like the fog overlay on the map
+
+   for 16 and 32 bit surfaces. "generic" is the per-pixel loop which
+   was used for all surfaces before the kernels were introduced. The
+   results of all kernels are compared with the generic loop.
+*/
+
+#ifdef WIN32
+# include <windows.h>
+#else
+# include <sys/time.h>
+#endif
+
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+
+#include "SDL.h"
+
+#include "surface.h"
+#include "misc.h"
+
+#ifdef _MSC_VER
+// SDL_Main linkage destroys the command line in VS8
+#undef main
+#endif
+
+#define DEFAULT_RUNS  100
+#define BENCH_WIDTH   800
+#define BENCH_HEIGHT  600
+
+#define HEX_WIDTH     32
+#define HEX_HEIGHT    28
+#define HEX_SHIFT     9
+
+enum { BENCH_RECT, BENCH_HEX };
+
+static unsigned long ticks( void ) {
+#ifdef WIN32
+  LARGE_INTEGER freq, now;
+  if ( QueryPerformanceFrequency( &freq ) && QueryPerformanceCounter( &now ) )
+    return (unsigned long)(now.QuadPart * 1000000 / freq.QuadPart);
+  return GetTickCount() * 1000;
+#else
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/* build a hex shape of the size used by the map tiles */
+static void make_hex( vector<PixelRun> &runs ) {
+  int half = HEX_HEIGHT / 2;
+
+  for ( int y = 0; y < HEX_HEIGHT; ++y ) {
+    int dist = (y < half) ? half - 1 - y : y - half;
+    PixelRun run;
+    run.x = dist * HEX_SHIFT / half;
+    run.y = y;
+    run.w = HEX_WIDTH - 2 * run.x;
+    runs.push_back( run );
+  }
+}
+
+/* fill the surface with the same noise before every test */
+static void fill( Surface &s ) {
+  SDL_Surface *sf = s.s_surface;
+  unsigned long seed = 12345;
+
+  SDL_LockSurface( sf );
+  for ( int y = 0; y < sf->h; ++y ) {
+    Uint8 *row = (Uint8 *)sf->pixels + y * sf->pitch;
+    for ( int x = 0; x < sf->w * sf->format->BytesPerPixel; ++x ) {
+      seed = seed * 1103515245 + 12345;
+      row[x] = (seed >> 16) & 0xff;
+    }
+  }
+  SDL_UnlockSurface( sf );
+}
+
+static void shade( Surface &s, int mode, const vector<PixelRun> &hex ) {
+  if ( mode == BENCH_RECT ) {
+    s.FillRectAlpha( s, Color(CF_COLOR_SHADOW), 96 );
+  } else {
+    for ( int x = 0; x < s.Width(); x += HEX_WIDTH - HEX_SHIFT ) {
+      short yoff = (x / (HEX_WIDTH - HEX_SHIFT)) & 1 ? HEX_HEIGHT / 2 : 0;
+      for ( int y = -yoff; y < s.Height(); y += HEX_HEIGHT )
+        s.FillRunsAlpha( hex, x, y, s, Color(CF_COLOR_SHADOW), 128 );
+    }
+  }
+}
+
+/* returns the average time in microseconds */
+static unsigned long run( Surface &s, int mode, int runs,
+                          const vector<PixelRun> &hex ) {
+  unsigned long start = ticks();
+  for ( int i = 0; i < runs; ++i ) shade( s, mode, hex );
+  return MAX( 1, (ticks() - start) / runs );
+}
+
+static bool same( const Surface &a, const Surface &b ) {
+  SDL_Surface *sa = a.s_surface, *sb = b.s_surface;
+  int len = sa->w * sa->format->BytesPerPixel;
+
+  for ( int y = 0; y < sa->h; ++y ) {
+    if ( memcmp( (Uint8 *)sa->pixels + y * sa->pitch,
+                 (Uint8 *)sb->pixels + y * sb->pitch, len ) ) return false;
+  }
+  return true;
+}
+
+int main( int argc, char *argv[] ) {
+  int runs = DEFAULT_RUNS;
+
+  for ( int i = 1; i < argc; ++i ) {
+    if ( !strcmp( argv[i], "-n" ) && (i + 1 < argc) ) {
+      runs = atoi( argv[++i] );
+      if ( runs < 1 ) runs = 1;
+    } else {
+      cerr << "Usage: " << argv[0] << " [-n <runs>]" << endl;
+      exit(-1);
+    }
+  }
+
+  if ( SDL_Init(0) < 0 ) {
+    cerr << "Couldn't init SDL: " << SDL_GetError() << endl;
+    exit(-1);
+  }
+  atexit(SDL_Quit);
+
+  static const struct {
+    const char *name;
+    BlendKernel kernel;
+  } kernels[] = {
+    { "generic", BLEND_GENERIC },
+    { "scalar",  BLEND_SCALAR },
+    { "sse2",    BLEND_SSE2 },
+    { "avx2",    BLEND_AVX2 }
+  };
+
+  static const int depths[] = { 16, 32 };
+
+  vector<PixelRun> hex;
+  make_hex( hex );
+
+  cout << runs << " runs, " << BENCH_WIDTH << "x" << BENCH_HEIGHT
+       << " pixels" << endl << endl
+       << "kernel   16/rect 16/hex  32/rect 32/hex  (us)" << endl;
+
+  Surface ref[2][2], test;
+  for ( int d = 0; d < 2; ++d ) {
+    for ( int m = BENCH_RECT; m <= BENCH_HEX; ++m ) {
+      if ( ref[d][m].Create( BENCH_WIDTH, BENCH_HEIGHT, depths[d], SDL_SWSURFACE ) ) {
+        cerr << "Couldn't create surface: " << SDL_GetError() << endl;
+        exit(-1);
+      }
+    }
+  }
+
+  for ( int k = 0; k < 4; ++k ) {
+    cout << setw(9) << left << kernels[k].name << right;
+
+    if ( Surface::SetBlendKernel( kernels[k].kernel ) ) {
+      cout << "not supported" << endl;
+      continue;
+    }
+
+    for ( int d = 0; d < 2; ++d ) {
+      for ( int m = BENCH_RECT; m <= BENCH_HEX; ++m ) {
+        unsigned long us;
+        bool ok = true;
+
+        if ( kernels[k].kernel == BLEND_GENERIC ) {
+          us = run( ref[d][m], m, runs, hex );
+          fill( ref[d][m] );
+          shade( ref[d][m], m, hex );
+        } else {
+          test.Create( BENCH_WIDTH, BENCH_HEIGHT, depths[d], SDL_SWSURFACE );
+          fill( test );
+          shade( test, m, hex );
+          ok = same( ref[d][m], test );
+          us = run( test, m, runs, hex );
+        }
+
+        if ( ok ) cout << setw(8) << left << us << right;
+        else cout << setw(8) << left << "differs" << right;
+      }
+    }
+    cout << endl;
+  }
+
+  return 0;
+}
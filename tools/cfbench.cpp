@@ -0,0 +1,199 @@
+/* cfbench -- compare compression methods for Crimson Fields levels
+   Copyright (C) 2000-2007 Jens Granseuer
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* takes a number of compiled level or save files
+
+   Each file is decoded and then repeatedly written to and read back
+   from memory with every available compression method. For each
+   method the total size and the average save and load times over all
+   files are printed. Loading includes decoding of all sections.
+*/
+
+#ifdef WIN32
+# include <windows.h>
+#else
+# include <sys/time.h>
+#endif
+
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+
+#include "SDL.h"
+
+#include "fileio.h"
+#include "chunkfile.h"
+#include "codec.h"
+#include "misc.h"
+#include "globals.h"
+
+#ifdef _MSC_VER
+// SDL_Main linkage destroys the command line in VS8
+#undef main
+#endif
+
+#define DEFAULT_RUNS  20
+
+static unsigned long ticks( void ) {
+#ifdef WIN32
+  LARGE_INTEGER freq, now;
+  if ( QueryPerformanceFrequency( &freq ) && QueryPerformanceCounter( &now ) )
+    return (unsigned long)(now.QuadPart * 1000000 / freq.QuadPart);
+  return GetTickCount() * 1000;
+#else
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+struct Result {
+  unsigned long size;
+  unsigned long save;     // microseconds, summed over all files
+  unsigned long load;
+};
+
+/* read a level and copy all sections into the writer */
+static int read_level( const char *name, ChunkWriter &out, unsigned long &raw ) {
+  MemoryBuffer file( name );
+  if ( !file.Open() ) {
+    cerr << "Couldn't open " << name << endl;
+    return -1;
+  }
+
+  if ( (file.Read32() != FID_MISSION) || (file.Read8() != FILE_VERSION) ) {
+    cerr << name << " is not a current level file" << endl;
+    return -1;
+  }
+
+  ChunkReader in;
+  if ( in.Load( file ) ) return -1;
+
+  raw = 0;
+  for ( unsigned short i = 0; i < in.NumSections(); ++i ) {
+    unsigned long id = in.GetSectionID( i );
+    MemoryBuffer *sect = in.GetSection( id );
+    if ( !sect ) return -1;
+
+    MemBuffer &copy = out.AddSection( id );
+    if ( sect->Size() > 0 )
+      copy.Write( sect->GetData(), sect->Size() );
+    raw += sect->Size();
+  }
+  return 0;
+}
+
+/* decode all sections of an encoded level */
+static int load_level( const DynBuffer &data ) {
+  unsigned char *buf = (unsigned char *)malloc( data.Size() );
+  if ( !buf ) return -1;
+  memcpy( buf, data.GetData(), data.Size() );
+
+  MemoryBuffer file;
+  file.Assign( buf, data.Size() );
+
+  ChunkReader in;
+  if ( in.Load( file ) ) return -1;
+
+  for ( unsigned short i = 0; i < in.NumSections(); ++i ) {
+    if ( !in.GetSection( in.GetSectionID( i ) ) ) return -1;
+  }
+  return 0;
+}
+
+int main( int argc, char *argv[] ) {
+  Result res[CODEC_COUNT];
+  unsigned long raw = 0;
+  int runs = DEFAULT_RUNS, first = 1, files = 0, i, c;
+
+  if ( (argc > 2) && !strcmp( argv[1], "-n" ) ) {
+    runs = atoi( argv[2] );
+    if ( runs < 1 ) runs = 1;
+    first = 3;
+  }
+
+  if ( first >= argc ) {
+    cerr << "Usage: " << argv[0] << " [-n <runs>] <level>..." << endl;
+    exit(-1);
+  }
+
+  if ( SDL_Init(0) < 0 ) {
+    cerr << "Couldn't init SDL: " << SDL_GetError() << endl;
+    exit(-1);
+  }
+  atexit(SDL_Quit);
+
+  memset( res, 0, sizeof(res) );
+
+  for ( i = first; i < argc; ++i ) {
+    ChunkWriter level;
+    unsigned long size;
+
+    if ( read_level( argv[i], level, size ) ) continue;
+    raw += size;
+    ++files;
+
+    for ( c = 0; c < CODEC_COUNT; ++c ) {
+      if ( !Codec::Get( c ) ) continue;
+
+      level.SetCodec( c );
+
+      unsigned long start = ticks();
+      for ( int r = 0; r < runs; ++r ) {
+        DynBuffer out;
+        level.Write( out );
+      }
+      res[c].save += (ticks() - start) / runs;
+
+      DynBuffer enc;
+      level.Write( enc );
+      res[c].size += enc.Size();
+
+      start = ticks();
+      for ( int r = 0; r < runs; ++r ) {
+        if ( load_level( enc ) ) {
+          cerr << "Error: " << argv[i] << " could not be decoded with codec "
+               << Codec::Get( c )->Name() << endl;
+          exit(-1);
+        }
+      }
+      res[c].load += (ticks() - start) / runs;
+    }
+  }
+
+  if ( files == 0 ) return -1;
+
+  cout << files << " files, " << raw << " bytes uncompressed, "
+       << runs << " runs" << endl << endl
+       << "method      size  ratio  save (us)  load (us)" << endl;
+
+  for ( c = 0; c < CODEC_COUNT; ++c ) {
+    const Codec *codec = Codec::Get( c );
+    if ( !codec ) continue;
+
+    cout << setw(6) << left << codec->Name() << right
+         << setw(10) << res[c].size
+         << setw(6) << fixed << setprecision(1)
+         << (raw ? 100.0 * res[c].size / raw : 0.0) << '%'
+         << setw(11) << res[c].save
+         << setw(11) << res[c].load << endl;
+  }
+  return 0;
+}
@@ -28,6 +28,7 @@
 #include "gamedefs.h"
 #include "strutil.h"
 #include "globals.h"
+#include "codec.h"
 
 #ifdef _MSC_VER
 // SDL_Main linkage destroys the command line in VS8
@@ -976,6 +977,14 @@ int main( int argc, char **argv ) {
       else if (strcmp(argv[i-1], "--units") == 0) uset = argv[i];
       else if (strcmp(argv[i-1], "--tiles") == 0) tset = argv[i];
       else if (strcmp(argv[i-1], "-o") == 0) outname = argv[i];
+      else if (strcmp(argv[i-1], "--compress") == 0) {
+        int codec = Codec::Find( argv[i] );
+        if ( codec != -1 ) Codec::SetDefault( codec );
+        else {
+          cerr << "Unknown compression method " << argv[i] << endl;
+          show_help = 1;
+        }
+      }
     }
   }
 
@@ -983,6 +992,7 @@ int main( int argc, char **argv ) {
 
   if ( show_help ) {
     cout << "Usage: " << argv[0] << " file --tiles <tileset> --units <unitset> [-o <outfile>]" << endl
+              << "       [--compress <none|fast|best>]" << endl
               << "  --help     display this help and exit" << endl
               << "  --version  output version information and exit" << endl;
     return 0;
@@ -1807,8 +1817,8 @@ int MissionParser::load_unit_set( const char *set ) {
 
   size_t pos = setshort.find( ".units" );
   if ( pos != string::npos ) setshort.erase( pos );
-  File file( set );
-  if ( !file.Open("rb") ) return -1;
+  MemoryBuffer file( set );
+  if ( !file.Open() ) return -1;
 
   unit_set = new UnitSet();
   if ( unit_set->Load( file, setshort.c_str() ) == -1 ) {
@@ -1831,8 +1841,8 @@ int MissionParser::load_tile_set( const char *set ) {
 
   size_t pos = setshort.find( ".tiles" );
   if ( pos != string::npos ) setshort.erase( pos );
-  File file( set );
-  if ( !file.Open("rb") ) return -1;
+  MemoryBuffer file( set );
+  if ( !file.Open() ) return -1;
 
   terrain_set = new TerrainSet();
   if ( terrain_set->Load( file, setshort.c_str() ) == -1 ) {
@@ -0,0 +1,945 @@
+/* cfrelay -- relay Crimson Fields network games to spectators
+   Copyright (C) 2000-2007 Jens Granseuer
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* The relay sits between the two players of a network game and lets
+   any number of spectators watch.
+
+   The hosting player sets up the game as usual and waits for the
+   second player. Instead, the relay connects to the host and receives
+   the game data. The second player and the spectators then connect to
+   the relay. The first client becomes the second player, everybody
+   else is a spectator.
+
+   Packets are forwarded as they come in, without being decoded. Each
+   packet is read into a single buffer which is then sent to all
+   recipients. Spectators share these buffers, which are reference
+   counted and freed when everyone has received them. All packets
+   following the game data are kept in a backlog. Clients joining late get the game data and the backlog in
+   one go and can then follow the game live. Spectators receive a copy
+   of the game data in which the player ID has been replaced by
+   CF_NET_SPECTATOR, which makes the game treat both sides as remote.
+
+   SDL_net only offers blocking sends, so each spectator gets a thread
+   which sends the packets queued for it. This way a slow spectator
+   cannot stall the players. Spectators which fall more than
+   SPECTATOR_LAG bytes behind are dropped. When the relay closes, the
+   threads of spectators which are still stuck after CLOSE_TRIES are
+   killed. The backlog is limited as
+   well. Once it is full (and the second player has joined) it is
+   discarded, and new spectators are turned away.
+
+   With -t the relay tests itself on the local machine. Scripted
+   headless clients act as the two players and the spectators, half of
+   which only join in the middle of the game. The test fails unless
+   every client receives every packet in the correct order.
+*/
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+
+#include "SDL.h"
+
+#include "../src/cf/network.h"
+#include "codec.h"
+#include "misc.h"
+
+#ifdef _MSC_VER
+// SDL_Main linkage destroys the command line in VS8
+#undef main
+#endif
+
+#define DEFAULT_HOST_PORT   9999    /* same as the game */
+#define DEFAULT_PORT        10000
+#define DEFAULT_SPECTATORS  16
+#define DEFAULT_TURNS       6
+#define DEFAULT_BACKLOG     1024    /* KB kept for late spectators */
+
+#define SPECTATOR_LAG       (256 * 1024)
+
+#define CONNECT_TRIES       100     /* wait up to 10 seconds */
+#define CONNECT_DELAY       100
+#define CLOSE_TRIES         50      /* wait up to 5 seconds for spectators
+                                       to receive the rest of the game */
+
+#define TEST_ACTIONS        3       /* action packets per turn */
+#define TEST_SNAPSHOT       8192    /* size of the fake game data */
+#define TEST_PAYLOAD        600     /* size of the fake turn data */
+#define TEST_TIMEOUT        10000
+#define TEST_GUEST_ID       1       /* side of the second player */
+
+#ifdef DISABLE_NETWORK
+
+int main( int argc, char *argv[] ) {
+  cerr << "Network support has been disabled at compile time." << endl;
+  return -1;
+}
+
+#else
+
+/* packet tags, see game.cpp */
+enum {
+  NET_MSG_ACTIONS = 0,
+  NET_MSG_END_TURN
+};
+
+/* a packet shared by all the spectators it is queued for. Packets
+   are never modified after they have been created, and only the relay
+   thread touches the reference count. */
+class Packet {
+public:
+  static Packet *Create( const DynBuffer &buf );
+
+  void Ref( void ) { ++refs; }
+  void Unref( void ) { if ( --refs == 0 ) delete this; }
+  const char *Data( void ) const { return data.GetData(); }
+  unsigned long Size( void ) const { return data.Size(); }
+
+private:
+  Packet( void ) : refs(1) {}
+  ~Packet( void ) {}
+
+  DynBuffer data;
+  unsigned int refs;
+};
+
+/* a spectator; packets are queued by the relay and sent by a thread
+   of its own. The thread closes the socket when it exits. */
+class Watcher {
+public:
+  Watcher( TCPsocket sock ) : sock(sock), thread(0), lock(0), wake(0),
+           next(0), queued(0), sent(0), initial(0), stop(false),
+           flush(false), sending(false), failed(false), finished(false) {}
+  ~Watcher( void );
+
+  int Start( Packet *game, const vector<Packet *> &history );
+  bool Queue( Packet *packet );
+  void Stop( bool flush );
+  void Kill( void );
+  bool Finished( void );
+  TCPsocket Socket( void ) const { return sock; }
+
+private:
+  static int Sender( void *data );
+  void Release( void );
+
+  TCPsocket sock;
+  SDL_Thread *thread;
+  SDL_mutex *lock;
+  SDL_cond *wake;
+
+  vector<Packet *> queue; /* packets not yet released by the relay */
+  unsigned int next;      /* index of the next packet to send */
+  unsigned long queued;   /* bytes queued in total */
+  unsigned long sent;     /* bytes sent in total */
+  unsigned long initial;  /* size of the game data and the backlog */
+  bool stop;              /* the thread should exit... */
+  bool flush;             /* ...after sending what is queued */
+  bool sending;           /* the thread is blocked in a send */
+  bool failed;
+  bool finished;
+};
+
+class Relay {
+public:
+  Relay( void ) : listener(0), host(0), guest(0), set(0), watch(0),
+                  backlog_size(0), max_backlog(DEFAULT_BACKLOG * 1024),
+                  complete(true), packets(0), bytes(0) {}
+  ~Relay( void ) { Close(); }
+
+  int Open( const char *hostname, Uint16 hostport, Uint16 port,
+            unsigned int spectators, unsigned long backlog_size );
+  int Run( void );
+  void Close( void );
+
+private:
+  int ReadFrame( TCPsocket sock );
+  int MakeWatchFrame( void );
+  void Accept( void );
+  int Forward( TCPsocket from );
+  void Drop( unsigned int spectator );
+  void Reap( void );
+  void ClearBacklog( void );
+
+  TCPsocket listener;
+  TCPsocket host;
+  TCPsocket guest;
+  vector<Watcher *> spectators;
+  vector<Watcher *> leaving;  /* dropped, but still sending or blocked */
+  unsigned int max_spectators;
+  SDLNet_SocketSet set;
+
+  DynBuffer frame;      /* packet currently being relayed */
+  DynBuffer setup;      /* game data as sent by the host */
+  Packet *watch;        /* game data for spectators */
+  vector<Packet *> backlog; /* all packets received after the game data */
+  unsigned long backlog_size;
+  unsigned long max_backlog;
+  bool complete;        /* FALSE once the backlog has been discarded */
+  unsigned long packets;
+  unsigned long bytes;
+};
+
+/* blocking read of exactly size bytes */
+static bool recv_all( TCPsocket sock, char *buf, int size ) {
+  int read = 0;
+  while ( read < size ) {
+    int len = SDLNet_TCP_Recv( sock, buf + read, size - read );
+    if ( len <= 0 ) return false;
+    read += len;
+  }
+  return true;
+}
+
+static bool send_all( TCPsocket sock, const char *data, unsigned long size ) {
+  return (unsigned long)SDLNet_TCP_Send( sock, data, size ) == size;
+}
+
+static bool send_all( TCPsocket sock, const DynBuffer &buf ) {
+  return send_all( sock, buf.GetData(), buf.Size() );
+}
+
+/* copy a buffer into a new packet; returns NULL on error */
+Packet *Packet::Create( const DynBuffer &buf ) {
+  Packet *p = new Packet;
+  if ( p->data.Write( buf.GetData(), buf.Size() ) ) {
+    delete p;
+    return NULL;
+  }
+  return p;
+}
+
+Watcher::~Watcher( void ) {
+  /* only delete a watcher when its thread has finished or has
+     been killed */
+  if ( thread ) SDL_WaitThread( thread, NULL );
+  else SDLNet_TCP_Close( sock );
+
+  if ( wake ) SDL_DestroyCond( wake );
+  if ( lock ) SDL_DestroyMutex( lock );
+
+  for ( unsigned int i = 0; i < queue.size(); ++i ) queue[i]->Unref();
+}
+
+/* queue the game so far and start sending */
+int Watcher::Start( Packet *game, const vector<Packet *> &history ) {
+  lock = SDL_CreateMutex();
+  wake = SDL_CreateCond();
+  if ( !lock || !wake ) return -1;
+
+  game->Ref();
+  queue.push_back( game );
+  queued = game->Size();
+  for ( unsigned int i = 0; i < history.size(); ++i ) {
+    history[i]->Ref();
+    queue.push_back( history[i] );
+    queued += history[i]->Size();
+  }
+  initial = queued;
+
+  thread = SDL_CreateThread( Sender, this );
+  return thread ? 0 : -1;
+}
+
+/* drop our references to the packets which have been sent; the mutex
+   must be locked */
+void Watcher::Release( void ) {
+  for ( unsigned int i = 0; i < next; ++i ) queue[i]->Unref();
+  queue.erase( queue.begin(), queue.begin() + next );
+  next = 0;
+}
+
+/* returns FALSE if the connection failed or if more than
+   SPECTATOR_LAG bytes of live packets are waiting to be sent; the
+   game data and the backlog queued when the spectator joined don't
+   count */
+bool Watcher::Queue( Packet *packet ) {
+  SDL_LockMutex( lock );
+
+  Release();
+
+  bool ok = !failed;
+  if ( ok ) {
+    packet->Ref();
+    queue.push_back( packet );
+    queued += packet->Size();
+    ok = (queued - MAX( sent, initial ) <= SPECTATOR_LAG);
+    SDL_CondSignal( wake );
+  }
+
+  SDL_UnlockMutex( lock );
+  return ok;
+}
+
+/* tell the thread to exit; the socket must not be in the relay's
+   socket set anymore */
+void Watcher::Stop( bool flush ) {
+  SDL_LockMutex( lock );
+  stop = true;
+  this->flush = flush;
+  SDL_CondSignal( wake );
+  SDL_UnlockMutex( lock );
+}
+
+/* stop the thread without sending anything else. If it is stuck in a
+   send it is killed, and the socket is closed when the watcher is
+   deleted. */
+void Watcher::Kill( void ) {
+  SDL_LockMutex( lock );
+  stop = true;
+  flush = false;
+  SDL_CondSignal( wake );
+  if ( sending ) {
+    SDL_KillThread( thread );
+    thread = NULL;
+  }
+  SDL_UnlockMutex( lock );
+}
+
+bool Watcher::Finished( void ) {
+  SDL_LockMutex( lock );
+  bool done = finished;
+  SDL_UnlockMutex( lock );
+  return done;
+}
+
+/* the packets stay in the queue until the relay releases them, so
+   they can be sent without holding the lock */
+int Watcher::Sender( void *data ) {
+  Watcher *w = static_cast<Watcher *>( data );
+
+  SDL_LockMutex( w->lock );
+  while ( true ) {
+    while ( !w->stop && (w->failed || (w->next == w->queue.size())) )
+      SDL_CondWait( w->wake, w->lock );
+    if ( w->stop && (w->failed || !w->flush || (w->next == w->queue.size())) )
+      break;
+
+    const Packet *p = w->queue[w->next];
+    w->sending = true;
+    SDL_UnlockMutex( w->lock );
+
+    bool ok = send_all( w->sock, p->Data(), p->Size() );
+
+    SDL_LockMutex( w->lock );
+    w->sending = false;
+    if ( ok ) {
+      w->sent += p->Size();
+      ++w->next;
+    } else w->failed = true;
+  }
+  SDL_UnlockMutex( w->lock );
+
+  SDLNet_TCP_Close( w->sock );
+
+  SDL_LockMutex( w->lock );
+  w->finished = true;
+  SDL_UnlockMutex( w->lock );
+  return 0;
+}
+
+static TCPsocket open_host( const char *host, Uint16 port ) {
+  IPaddress ip;
+  TCPsocket sock = NULL;
+
+  if ( SDLNet_ResolveHost( &ip, host, port ) ) {
+    cerr << "Could not resolve " << host << ": " << SDLNet_GetError() << endl;
+    return NULL;
+  }
+
+  for ( int tries = 0; !sock && (tries < CONNECT_TRIES); ++tries ) {
+    sock = SDLNet_TCP_Open( &ip );
+    if ( !sock ) SDL_Delay( CONNECT_DELAY );
+  }
+  return sock;
+}
+
+/* open the relay; this connects to the host and waits for the game
+   data, so the host must already be waiting for a client */
+int Relay::Open( const char *hostname, Uint16 hostport, Uint16 port,
+                 unsigned int spectators, unsigned long backlog_size ) {
+  IPaddress ip;
+
+  max_spectators = spectators;
+  max_backlog = backlog_size;
+
+  /* listener, both players, and the spectators */
+  set = SDLNet_AllocSocketSet( spectators + 3 );
+  if ( !set ) {
+    cerr << "SDLNet_AllocSocketSet: " << SDLNet_GetError() << endl;
+    return -1;
+  }
+
+  host = open_host( hostname, hostport );
+  if ( !host ) {
+    cerr << "Could not connect to " << hostname << ':' << hostport << endl;
+    return -1;
+  }
+
+  if ( ReadFrame( host ) ) {
+    cerr << "Did not receive any game data from the host" << endl;
+    return -1;
+  }
+  setup.Write( frame.GetData(), frame.Size() );
+  if ( MakeWatchFrame() || !(watch = Packet::Create( frame )) ) {
+    cerr << "Could not decode game data" << endl;
+    return -1;
+  }
+
+  if ( SDLNet_ResolveHost( &ip, NULL, port ) ||
+       !(listener = SDLNet_TCP_Open( &ip )) ) {
+    cerr << "Could not listen on port " << port << ": "
+         << SDLNet_GetError() << endl;
+    return -1;
+  }
+
+  SDLNet_TCP_AddSocket( set, host );
+  SDLNet_TCP_AddSocket( set, listener );
+  return 0;
+}
+
+void Relay::Close( void ) {
+  if ( listener ) SDLNet_TCP_Close( listener );
+  if ( host ) SDLNet_TCP_Close( host );
+  if ( guest ) SDLNet_TCP_Close( guest );
+  if ( set ) SDLNet_FreeSocketSet( set );
+
+  /* let the spectators see the end of the game, but don't wait
+     forever for those which are stuck */
+  for ( unsigned int i = 0; i < spectators.size(); ++i ) {
+    spectators[i]->Stop( true );
+    leaving.push_back( spectators[i] );
+  }
+  for ( int tries = 0; !leaving.empty() && (tries < CLOSE_TRIES); ++tries ) {
+    Reap();
+    if ( !leaving.empty() ) SDL_Delay( CONNECT_DELAY );
+  }
+  for ( unsigned int i = 0; i < leaving.size(); ++i ) {
+    leaving[i]->Kill();
+    delete leaving[i];
+  }
+
+  ClearBacklog();
+  if ( watch ) watch->Unref();
+
+  listener = host = guest = NULL;
+  spectators.clear();
+  leaving.clear();
+  set = NULL;
+  watch = NULL;
+}
+
+/* relay packets until one of the players leaves */
+int Relay::Run( void ) {
+  char dummy[256];
+
+  while ( true ) {
+    if ( SDLNet_CheckSockets( set, (Uint32)-1 ) < 0 ) {
+      cerr << "SDLNet_CheckSockets: " << SDLNet_GetError() << endl;
+      return -1;
+    }
+
+    if ( SDLNet_SocketReady( host ) ) {
+      if ( ReadFrame( host ) ) break;
+      if ( Forward( host ) ) return -1;
+    }
+
+    if ( guest && SDLNet_SocketReady( guest ) ) {
+      if ( ReadFrame( guest ) ) break;
+      if ( Forward( guest ) ) return -1;
+    }
+
+    /* spectators are not supposed to send anything */
+    for ( unsigned int i = spectators.size(); i > 0; --i ) {
+      TCPsocket sock = spectators[i-1]->Socket();
+      if ( SDLNet_SocketReady( sock ) &&
+           (SDLNet_TCP_Recv( sock, dummy, sizeof(dummy) ) <= 0) )
+        Drop( i - 1 );
+    }
+
+    if ( SDLNet_SocketReady( listener ) ) Accept();
+
+    Reap();
+  }
+
+  cout << "Player left, " << packets << " packets (" << bytes
+       << " bytes) relayed" << endl;
+  return 0;
+}
+
+/* read a complete packet into the frame buffer */
+int Relay::ReadFrame( TCPsocket sock ) {
+  struct TCPPacketHeader hdr;
+
+  if ( !recv_all( sock, (char *)&hdr, CF_PACKET_HEADER ) ) return -1;
+
+  if ( (SDL_SwapLE32(hdr.id) != CF_PACKET_ID) ||
+       (hdr.version != CF_PACKET_VERSION) ) {
+    cerr << "Received invalid packet" << endl;
+    return -1;
+  }
+
+  Uint32 size = SDL_SwapLE32(hdr.size);
+  if ( size > CF_PACKET_MAX_SIZE ) {
+    cerr << "Received oversized packet" << endl;
+    return -1;
+  }
+
+  frame.Clear();
+  if ( frame.SetSize( CF_PACKET_HEADER + size ) ) return -1;
+  memcpy( frame.GetData(), &hdr, CF_PACKET_HEADER );
+
+  return recv_all( sock, frame.GetData() + CF_PACKET_HEADER, size ) ? 0 : -1;
+}
+
+/* create the spectator copy of the game data in the frame buffer; its
+   payload starts with the ID of the player receiving it, which we need
+   to replace */
+int Relay::MakeWatchFrame( void ) {
+  struct TCPPacketHeader hdr;
+  DynBuffer raw;
+
+  if ( setup.Size() <= CF_PACKET_HEADER ) return -1;
+
+  memcpy( &hdr, setup.GetData(), CF_PACKET_HEADER );
+  const unsigned char *payload =
+        (const unsigned char *)setup.GetData() + CF_PACKET_HEADER;
+  unsigned long len = setup.Size() - CF_PACKET_HEADER;
+  const Codec *c = Codec::Get( hdr.codec );
+
+  if ( hdr.codec == CODEC_STORE ) raw.Write( payload, len );
+  else {
+    Uint32 rawlen;
+
+    if ( !c || (len <= 4) ) return -1;
+    memcpy( &rawlen, payload, 4 );
+    rawlen = SDL_SwapLE32(rawlen);
+
+    if ( (rawlen == 0) || (rawlen > CF_PACKET_MAX_SIZE) ||
+         (rawlen / c->MaxRatio() > len - 4) || raw.SetSize( rawlen ) ||
+         c->Decode( payload + 4, len - 4,
+                    (unsigned char *)raw.GetData(), rawlen ) )
+      return -1;
+  }
+
+  raw.GetData()[0] = CF_NET_SPECTATOR;
+  len = raw.Size();
+
+  frame.Clear();
+  if ( hdr.codec != CODEC_STORE ) {
+    unsigned long enclen = c->Bound( len );
+
+    if ( (frame.SetSize( CF_PACKET_HEADER + 4 + enclen ) == 0) &&
+         (c->Encode( (const unsigned char *)raw.GetData(), len,
+            (unsigned char *)frame.GetData() + CF_PACKET_HEADER + 4,
+            enclen ) == 0) ) {
+      Uint32 rawlen = SDL_SwapLE32(len);
+      memcpy( frame.GetData() + CF_PACKET_HEADER, &rawlen, 4 );
+      frame.SetSize( CF_PACKET_HEADER + 4 + enclen );
+    } else hdr.codec = CODEC_STORE;
+  }
+
+  if ( hdr.codec == CODEC_STORE ) {
+    if ( frame.SetSize( CF_PACKET_HEADER + len ) ) return -1;
+    memcpy( frame.GetData() + CF_PACKET_HEADER, raw.GetData(), len );
+  }
+
+  hdr.size = SDL_SwapLE32(frame.Size() - CF_PACKET_HEADER);
+  memcpy( frame.GetData(), &hdr, CF_PACKET_HEADER );
+  return 0;
+}
+
+/* accept a new client and bring it up to date */
+void Relay::Accept( void ) {
+  TCPsocket sock = SDLNet_TCP_Accept( listener );
+  if ( !sock ) return;
+
+  bool player = (guest == NULL);
+
+  if ( player ) {
+    bool ok = send_all( sock, setup );
+    for ( unsigned int i = 0; ok && (i < backlog.size()); ++i )
+      ok = send_all( sock, backlog[i]->Data(), backlog[i]->Size() );
+    if ( !ok ) {
+      cout << "Lost new client" << endl;
+      SDLNet_TCP_Close( sock );
+      return;
+    }
+
+    guest = sock;
+    SDLNet_TCP_AddSocket( set, sock );
+    cout << "Second player joined" << endl;
+    return;
+  }
+
+  if ( spectators.size() >= max_spectators ) {
+    cout << "Spectator refused, relay is full" << endl;
+    SDLNet_TCP_Close( sock );
+    return;
+  }
+
+  if ( !complete ) {
+    cout << "Spectator refused, the backlog has been discarded" << endl;
+    SDLNet_TCP_Close( sock );
+    return;
+  }
+
+  Watcher *w = new Watcher( sock );
+  if ( w->Start( watch, backlog ) ) {
+    cout << "Lost new client" << endl;
+    delete w;
+    return;
+  }
+
+  spectators.push_back( w );
+  SDLNet_TCP_AddSocket( set, sock );
+  cout << "Spectator joined (" << spectators.size() << " watching)" << endl;
+}
+
+/* send the current frame to everyone but its sender */
+int Relay::Forward( TCPsocket from ) {
+  TCPsocket to = (from == host) ? guest : host;
+
+  /* the second player may not have joined yet, but it
+     will get the packet from the backlog when it does */
+  if ( to && !send_all( to, frame ) ) {
+    cerr << "Lost connection to player" << endl;
+    return -1;
+  }
+
+  ++packets;
+  bytes += frame.Size();
+
+  if ( spectators.empty() && !complete ) return 0;
+
+  Packet *p = Packet::Create( frame );
+  if ( !p ) {
+    cerr << "Out of memory" << endl;
+    return -1;
+  }
+
+  for ( unsigned int i = spectators.size(); i > 0; --i ) {
+    if ( !spectators[i-1]->Queue( p ) ) {
+      cout << "Spectator is too slow" << endl;
+      Drop( i - 1 );
+    }
+  }
+
+  if ( complete ) {
+    p->Ref();
+    backlog.push_back( p );
+    backlog_size += p->Size();
+
+    /* the second player needs everything from the beginning, but once
+       it has joined we can give up on late spectators */
+    if ( guest && (backlog_size > max_backlog) ) {
+      ClearBacklog();
+      complete = false;
+      cout << "Backlog full, no more spectators can join" << endl;
+    }
+  }
+
+  p->Unref();
+  return 0;
+}
+
+void Relay::Drop( unsigned int spectator ) {
+  Watcher *w = spectators[spectator];
+
+  SDLNet_TCP_DelSocket( set, w->Socket() );
+  w->Stop( false );
+  leaving.push_back( w );
+  spectators.erase( spectators.begin() + spectator );
+  cout << "Spectator left (" << spectators.size() << " watching)" << endl;
+}
+
+void Relay::ClearBacklog( void ) {
+  for ( unsigned int i = 0; i < backlog.size(); ++i ) backlog[i]->Unref();
+  backlog.clear();
+  backlog_size = 0;
+}
+
+/* get rid of dropped spectators whose threads have finished */
+void Relay::Reap( void ) {
+  for ( unsigned int i = leaving.size(); i > 0; --i ) {
+    if ( leaving[i-1]->Finished() ) {
+      delete leaving[i-1];
+      leaving.erase( leaving.begin() + i - 1 );
+    }
+  }
+}
+
+
+/* self test */
+
+struct Script {
+  Uint16 hostport;
+  Uint16 port;
+  int turns;
+  int spectators;
+  SDL_sem *joined;    /* second player is connected to the relay */
+  SDL_sem *halfway;   /* late spectators may connect */
+  SDL_sem *done;      /* a spectator has received everything */
+  SDL_sem *finished;  /* the host is leaving */
+};
+
+struct Client {
+  Script *script;
+  bool late;
+};
+
+class TimeoutHook : public UserActionHook {
+public:
+  TimeoutHook( void ) : start(SDL_GetTicks()) {}
+  bool Cancelled( void ) { return SDL_GetTicks() - start > TEST_TIMEOUT; }
+private:
+  Uint32 start;
+};
+
+static int connect_client( TCPConnection &con, Uint16 port ) {
+  int err = -1;
+  for ( int tries = 0; err && (tries < CONNECT_TRIES); ++tries ) {
+    err = con.Open( "localhost", port, NULL );
+    if ( err ) {
+      con.Close();
+      SDL_Delay( CONNECT_DELAY );
+    }
+  }
+  return err;
+}
+
+/* check that the next packet is the one with the given sequence number */
+static bool expect( TCPConnection &con, int seq, bool end ) {
+  TimeoutHook hook;
+  DynBuffer *buf = con.Receive( &hook );
+
+  if ( !buf || (buf->Size() != TEST_PAYLOAD) ) return false;
+
+  unsigned char msg = buf->Read8();
+  return (msg == (end ? NET_MSG_END_TURN : NET_MSG_ACTIONS)) &&
+         (buf->Read32() == (unsigned long)seq);
+}
+
+/* the players take turns; on each turn the active player sends some
+   action packets and a final end of turn packet */
+static bool play( TCPConnection &con, Script &s, int side ) {
+  for ( int turn = 0; turn < s.turns; ++turn ) {
+    if ( (side == 0) && (turn == s.turns / 2) ) {
+      for ( int i = 0; i < s.spectators; ++i ) SDL_SemPost( s.halfway );
+    }
+
+    for ( int i = 0; i <= TEST_ACTIONS; ++i ) {
+      int seq = turn * (TEST_ACTIONS + 1) + i;
+      bool end = (i == TEST_ACTIONS);
+
+      if ( (turn & 1) == side ) {
+        DynBuffer &buf = con.GetSendBuffer();
+        buf.Write8( end ? NET_MSG_END_TURN : NET_MSG_ACTIONS );
+        buf.Write32( seq );
+        while ( buf.Size() < CF_PACKET_HEADER + TEST_PAYLOAD )
+          buf.Write8( (buf.Size() / 32) & 0xff );
+        if ( !con.Send( buf ) ) return false;
+      } else if ( !expect( con, seq, end ) ) return false;
+    }
+  }
+  return true;
+}
+
+static int test_host( void *data ) {
+  Script *s = static_cast<Script *>( data );
+  TCPConnection con;
+  bool ok = false;
+
+  if ( con.Open( NULL, s->hostport, NULL ) == 0 ) {
+    DynBuffer &buf = con.GetSendBuffer();
+    buf.Write8( TEST_GUEST_ID );
+    for ( int i = 0; i < TEST_SNAPSHOT; ++i ) buf.Write8( (i / 64) & 0xff );
+
+    ok = con.Send( buf ) && play( con, *s, 0 );
+  }
+
+  /* stay around until all spectators have seen the game */
+  for ( int i = 0; i < s->spectators; ++i ) SDL_SemWait( s->done );
+  SDL_SemPost( s->finished );
+
+  if ( !ok ) cerr << "Host failed" << endl;
+  return ok ? 0 : -1;
+}
+
+/* returns the player ID from the game data, or -1 */
+static int join( TCPConnection &con, Uint16 port ) {
+  if ( connect_client( con, port ) ) return -1;
+
+  TimeoutHook hook;
+  DynBuffer *buf = con.Receive( &hook );
+  if ( !buf || (buf->Size() != TEST_SNAPSHOT + 1) ) return -1;
+  return buf->Read8();
+}
+
+static int test_guest( void *data ) {
+  Script *s = static_cast<Script *>( data );
+  TCPConnection con;
+  bool ok = false;
+
+  ok = (join( con, s->port ) == TEST_GUEST_ID);
+
+  /* now the spectators may connect without taking our seat */
+  for ( int i = 0; i < s->spectators; ++i ) SDL_SemPost( s->joined );
+
+  ok = ok && play( con, *s, 1 );
+
+  SDL_SemWait( s->finished );
+
+  if ( !ok ) cerr << "Second player failed" << endl;
+  return ok ? 0 : -1;
+}
+
+static int test_spectator( void *data ) {
+  Client *c = static_cast<Client *>( data );
+  Script *s = c->script;
+  TCPConnection con;
+  bool ok;
+
+  SDL_SemWait( s->joined );
+  if ( c->late ) SDL_SemWait( s->halfway );
+
+  ok = (join( con, s->port ) == CF_NET_SPECTATOR);
+
+  for ( int turn = 0; ok && (turn < s->turns); ++turn ) {
+    for ( int i = 0; ok && (i <= TEST_ACTIONS); ++i )
+      ok = expect( con, turn * (TEST_ACTIONS + 1) + i, i == TEST_ACTIONS );
+  }
+
+  SDL_SemPost( s->done );
+
+  if ( !ok ) cerr << (c->late ? "Late" : "Early") << " spectator failed" << endl;
+  return ok ? 0 : -1;
+}
+
+static int self_test( Uint16 port, int spectators, int turns ) {
+  Script s;
+  s.hostport = port + 1;
+  s.port = port;
+  s.turns = turns;
+  s.spectators = spectators;
+  s.joined = SDL_CreateSemaphore( 0 );
+  s.halfway = SDL_CreateSemaphore( 0 );
+  s.done = SDL_CreateSemaphore( 0 );
+  s.finished = SDL_CreateSemaphore( 0 );
+
+  vector<Client> clients( spectators );
+  vector<SDL_Thread *> threads;
+  int i, status, failed = 0;
+
+  threads.push_back( SDL_CreateThread( test_host, &s ) );
+
+  Relay relay;
+  if ( relay.Open( "localhost", s.hostport, s.port, spectators,
+                   DEFAULT_BACKLOG * 1024 ) == 0 ) {
+    threads.push_back( SDL_CreateThread( test_guest, &s ) );
+
+    for ( i = 0; i < spectators; ++i ) {
+      clients[i].script = &s;
+      clients[i].late = (i & 1);
+      threads.push_back( SDL_CreateThread( test_spectator, &clients[i] ) );
+    }
+
+    if ( relay.Run() ) ++failed;
+  } else {
+    /* nobody else is going to release the host */
+    for ( i = 0; i < spectators; ++i ) SDL_SemPost( s.done );
+    ++failed;
+  }
+  relay.Close();
+
+  for ( i = 0; i < (int)threads.size(); ++i ) {
+    SDL_WaitThread( threads[i], &status );
+    if ( status ) ++failed;
+  }
+
+  SDL_DestroySemaphore( s.joined );
+  SDL_DestroySemaphore( s.halfway );
+  SDL_DestroySemaphore( s.done );
+  SDL_DestroySemaphore( s.finished );
+
+  cout << (failed ? "FAILED" : "passed") << endl;
+  return failed ? -1 : 0;
+}
+
+static void usage( const char *prog ) {
+  cerr << "Usage: " << prog << " [-p <port>] [-m <spectators>] [-b <KB>] "
+          "<host> [<host port>]" << endl
+       << "       " << prog << " -t <spectators> [-n <turns>] [-p <port>]"
+       << endl;
+  exit(-1);
+}
+
+int main( int argc, char *argv[] ) {
+  const char *hostname = NULL;
+  Uint16 hostport = DEFAULT_HOST_PORT, port = DEFAULT_PORT;
+  int spectators = DEFAULT_SPECTATORS, turns = DEFAULT_TURNS;
+  unsigned long backlog = DEFAULT_BACKLOG;
+  bool test = false;
+
+  for ( int i = 1; i < argc; ++i ) {
+    if ( !strcmp( argv[i], "-p" ) && (i + 1 < argc) )
+      port = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-m" ) && (i + 1 < argc) )
+      spectators = MAX( 0, atoi( argv[++i] ) );
+    else if ( !strcmp( argv[i], "-b" ) && (i + 1 < argc) )
+      backlog = MAX( 0, atoi( argv[++i] ) );
+    else if ( !strcmp( argv[i], "-t" ) && (i + 1 < argc) ) {
+      spectators = MAX( 0, atoi( argv[++i] ) );
+      test = true;
+    } else if ( !strcmp( argv[i], "-n" ) && (i + 1 < argc) )
+      turns = MAX( 1, atoi( argv[++i] ) );
+    else if ( (argv[i][0] != '-') && !hostname )
+      hostname = argv[i];
+    else if ( (argv[i][0] != '-') && hostname )
+      hostport = atoi( argv[i] );
+    else usage( argv[0] );
+  }
+
+  if ( !test && !hostname ) usage( argv[0] );
+
+  if ( SDL_Init(0) < 0 ) {
+    cerr << "Couldn't init SDL: " << SDL_GetError() << endl;
+    exit(-1);
+  }
+  atexit(SDL_Quit);
+
+  if ( SDLNet_Init() < 0 ) {
+    cerr << "Couldn't init SDL_net: " << SDLNet_GetError() << endl;
+    exit(-1);
+  }
+  atexit(SDLNet_Quit);
+
+  if ( test ) return self_test( port, spectators, turns );
+
+  Relay relay;
+  if ( relay.Open( hostname, hostport, port, spectators, backlog * 1024 ) )
+    return -1;
+
+  cout << "Relaying game from " << hostname << ':' << hostport
+       << ", waiting for players on port " << port << endl;
+  return relay.Run();
+}
+
+#endif /* DISABLE_NETWORK */
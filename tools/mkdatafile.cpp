@@ -24,6 +24,7 @@
 */
 
 #include <iostream>
+#include <string.h>
 using namespace std;
 
 #include "SDL.h"
@@ -38,10 +39,19 @@ using namespace std;
 
 int main( int argc, char *argv[] ) {
   int status;
- 
+  bool pack = false;
+
+  if ( (argc > 1) && !strcmp( argv[1], "--pack" ) ) {
+    // create an uncompressed asset pack instead of a gzip file
+    pack = true;
+    argv[1] = argv[0];
+    ++argv;
+    --argc;
+  }
+
   if ( argc != 3 ) {
     cerr << "Invalid number of arguments" << endl
-         << "Usage: " << argv[0] << "<icons.bmp> <outfile>" << endl;
+         << "Usage: " << argv[0] << " [--pack] <icons.bmp> <outfile>" << endl;
     exit(-1);
   }
 
@@ -52,16 +62,16 @@ int main( int argc, char *argv[] ) {
   }
   atexit(SDL_Quit);
 
-  File out( argv[2] );
-  if ( !out.Open( "wb" ) ) {
-    cerr << "Couldn't open output file " << argv[5] << endl;
+  PackFile out( argv[2], pack );
+  if ( !out.Open() ) {
+    cerr << "Couldn't open output file " << argv[2] << endl;
     exit(-1);
   }
 
   // icons
   MkSurface img;
   status = img.SaveImageData( argv[1], out, true );
-  out.Close();
+  if ( out.Close() ) status = -1;
   return status;
 }
 
@@ -24,6 +24,8 @@
    graphics and/or terrain characteristics to their likes
 */
 
+#include <string.h>
+
 #include "SDL.h"
 
 #include "fileio.h"
@@ -82,10 +84,19 @@ public:
 
 int main( int argc, char *argv[] ) {
   int status, i;
+  bool pack = false;
+
+  if ( (argc > 1) && !strcmp( argv[1], "--pack" ) ) {
+    // create an uncompressed asset pack instead of a gzip file
+    pack = true;
+    argv[1] = argv[0];
+    ++argv;
+    --argc;
+  }
 
   if ( (argc < 3) || (argc > 4) ) {
     cerr << "Invalid number of arguments\n"
-            "Usage: " << argv[0] << " <datafile> <outfile> [<gfxdir>]" << endl;
+            "Usage: " << argv[0] << " [--pack] <datafile> <outfile> [<gfxdir>]" << endl;
     exit(-1);
   }
 
@@ -144,8 +155,8 @@ int main( int argc, char *argv[] ) {
   }
 
   if ( status == 0 ) {
-    File out( argv[2] );
-    if ( !out.Open( "wb" ) ) {
+    PackFile out( argv[2], pack );
+    if ( !out.Open() ) {
       cerr << "Couldn't open output file " << argv[2] << endl;
       status = -1;
     } else {
@@ -170,7 +181,7 @@ int main( int argc, char *argv[] ) {
       MkSurface img;
       status = img.SaveImageData( info.images, out, true );
 
-      out.Close();
+      if ( out.Close() ) status = -1;
     }
   }
 
@@ -25,6 +25,8 @@
 
 #include <algorithm>
 using namespace std;
+#include <string.h>
+
 #include "SDL.h"
 
 #include "fileio.h"
@@ -108,10 +110,19 @@ public:
 int main( int argc, char *argv[] ) {
   int status;
   unsigned short i;
+  bool pack = false;
+
+  if ( (argc > 1) && !strcmp( argv[1], "--pack" ) ) {
+    // create an uncompressed asset pack instead of a gzip file
+    pack = true;
+    argv[1] = argv[0];
+    ++argv;
+    --argc;
+  }
 
   if ( (argc < 3) || (argc > 4) ) {
     cerr << "Invalid number of arguments\n"
-            "Usage: " << argv[0] << " <datafile> <outfile> [<gfxdir>]" << endl;
+            "Usage: " << argv[0] << " [--pack] <datafile> <outfile> [<gfxdir>]" << endl;
     exit(-1);
   }
 
@@ -173,8 +184,8 @@ int main( int argc, char *argv[] ) {
   }
 
   if ( status == 0 ) {
-    File out( argv[2] );
-    if ( !out.Open( "wb" ) ) {
+    PackFile out( argv[2], pack );
+    if ( !out.Open() ) {
       cerr << "Couldn't open output file " << argv[2] << endl;
       status = -1;
     } else {
@@ -233,7 +244,7 @@ int main( int argc, char *argv[] ) {
         status = img.SaveImageData( info.portraits[i], out, false );
       }
 
-      out.Close();
+      if ( out.Close() ) status = -1;
     }
   }
   return status;
@@ -0,0 +1,273 @@
+/* netbench -- measure Crimson Fields network round trips over loopback
+   Copyright (C) 2000-2007 Jens Granseuer
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* bounces packets between a client and a server thread on the local
+   machine and prints the average round trip time for
+
+   split   - header and payload sent with separate calls, the way
+             packets were transmitted before framing was introduced
+   framed  - TCPConnection, uncompressed
+   lz      - TCPConnection, LZ compressed payload
+
+   The payload resembles a turn history, i.e. it is fairly repetitive.
+*/
+
+#ifdef WIN32
+# include <windows.h>
+#else
+# include <sys/time.h>
+#endif
+
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+
+#include "SDL.h"
+
+#include "../src/cf/network.h"
+#include "codec.h"
+#include "misc.h"
+
+#ifdef _MSC_VER
+// SDL_Main linkage destroys the command line in VS8
+#undef main
+#endif
+
+#define DEFAULT_RUNS  200
+#define DEFAULT_SIZE  2048
+#define DEFAULT_PORT  24101
+
+#define SPLIT_HEADER  12
+
+#ifdef DISABLE_NETWORK
+
+int main( int argc, char *argv[] ) {
+  cerr << "Network support has been disabled at compile time." << endl;
+  return -1;
+}
+
+#else
+
+struct Bench {
+  Uint16 port;
+  int runs;
+  unsigned long size;
+  unsigned char codec;
+  bool split;
+};
+
+static unsigned long ticks( void ) {
+#ifdef WIN32
+  LARGE_INTEGER freq, now;
+  if ( QueryPerformanceFrequency( &freq ) && QueryPerformanceCounter( &now ) )
+    return (unsigned long)(now.QuadPart * 1000000 / freq.QuadPart);
+  return GetTickCount() * 1000;
+#else
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/* blocking read of exactly size bytes */
+static bool recv_all( TCPsocket sock, char *buf, int size ) {
+  int read = 0;
+  while ( read < size ) {
+    int len = SDLNet_TCP_Recv( sock, buf + read, size - read );
+    if ( len <= 0 ) return false;
+    read += len;
+  }
+  return true;
+}
+
+/* send a packet the old way, header first */
+static bool split_send( TCPsocket sock, char *buf, int size ) {
+  char hdr[SPLIT_HEADER];
+  memset( hdr, 0, SPLIT_HEADER );
+  return (SDLNet_TCP_Send( sock, hdr, SPLIT_HEADER ) == SPLIT_HEADER) &&
+         (SDLNet_TCP_Send( sock, buf, size ) == size);
+}
+
+static bool split_recv( TCPsocket sock, char *buf, int size ) {
+  char hdr[SPLIT_HEADER];
+  return recv_all( sock, hdr, SPLIT_HEADER ) && recv_all( sock, buf, size );
+}
+
+static TCPsocket split_connect( const char *host, Uint16 port ) {
+  IPaddress ip;
+  if ( SDLNet_ResolveHost( &ip, host, port ) ) return NULL;
+  return SDLNet_TCP_Open( &ip );
+}
+
+static int split_server( void *data ) {
+  Bench *b = static_cast<Bench *>( data );
+  TCPsocket server = split_connect( NULL, b->port ), client = NULL;
+  if ( !server ) return -1;
+
+  while ( !(client = SDLNet_TCP_Accept( server )) ) SDL_Delay( 1 );
+
+  char *buf = new char [b->size];
+  for ( int i = 0; i < b->runs; ++i ) {
+    if ( !split_recv( client, buf, b->size ) ||
+         !split_send( client, buf, b->size ) ) break;
+  }
+  delete [] buf;
+
+  SDLNet_TCP_Close( client );
+  SDLNet_TCP_Close( server );
+  return 0;
+}
+
+static int framed_server( void *data ) {
+  Bench *b = static_cast<Bench *>( data );
+  TCPConnection con;
+  con.SetCodec( b->codec );
+  if ( con.Open( NULL, b->port, NULL ) ) return -1;
+
+  for ( int i = 0; i < b->runs; ++i ) {
+    DynBuffer *in = con.Receive( NULL );
+    if ( !in ) break;
+
+    DynBuffer &out = con.GetSendBuffer();
+    out.Write( in->GetData(), in->Size() );
+    if ( !con.Send( out ) ) break;
+  }
+  return 0;
+}
+
+/* returns the average round trip time in microseconds, 0 on error */
+static unsigned long run( Bench &b, const char *payload ) {
+  SDL_Thread *thread = SDL_CreateThread(
+                       b.split ? split_server : framed_server, &b );
+  if ( !thread ) return 0;
+
+  unsigned long start = 0, total = 0;
+  int i, tries;
+
+  if ( b.split ) {
+    TCPsocket sock = NULL;
+    for ( tries = 0; !sock && (tries < 100); ++tries ) {
+      sock = split_connect( "localhost", b.port );
+      if ( !sock ) SDL_Delay( 10 );
+    }
+
+    if ( sock ) {
+      char *buf = new char [b.size];
+      start = ticks();
+      for ( i = 0; i < b.runs; ++i ) {
+        if ( !split_send( sock, const_cast<char *>(payload), b.size ) ||
+             !split_recv( sock, buf, b.size ) ) break;
+      }
+      if ( i == b.runs ) total = ticks() - start;
+      delete [] buf;
+      SDLNet_TCP_Close( sock );
+    }
+
+  } else {
+    TCPConnection con;
+    con.SetCodec( b.codec );
+
+    int err = -1;
+    for ( tries = 0; err && (tries < 100); ++tries ) {
+      err = con.Open( "localhost", b.port, NULL );
+      if ( err ) SDL_Delay( 10 );
+    }
+
+    if ( !err ) {
+      start = ticks();
+      for ( i = 0; i < b.runs; ++i ) {
+        DynBuffer &out = con.GetSendBuffer();
+        out.Write( payload, b.size );
+        if ( !con.Send( out ) || !con.Receive( NULL ) ) break;
+      }
+      if ( i == b.runs ) total = ticks() - start;
+    }
+  }
+
+  SDL_WaitThread( thread, NULL );
+  return total / b.runs;
+}
+
+int main( int argc, char *argv[] ) {
+  Bench b;
+  b.port = DEFAULT_PORT;
+  b.runs = DEFAULT_RUNS;
+  b.size = DEFAULT_SIZE;
+
+  for ( int i = 1; i < argc; ++i ) {
+    if ( !strcmp( argv[i], "-n" ) && (i + 1 < argc) )
+      b.runs = MAX( 1, atoi( argv[++i] ) );
+    else if ( !strcmp( argv[i], "-s" ) && (i + 1 < argc) )
+      b.size = MAX( 1, atoi( argv[++i] ) );
+    else if ( !strcmp( argv[i], "-p" ) && (i + 1 < argc) )
+      b.port = atoi( argv[++i] );
+    else {
+      cerr << "Usage: " << argv[0] << " [-n <runs>] [-s <size>] [-p <port>]"
+           << endl;
+      exit(-1);
+    }
+  }
+
+  if ( SDL_Init(0) < 0 ) {
+    cerr << "Couldn't init SDL: " << SDL_GetError() << endl;
+    exit(-1);
+  }
+  atexit(SDL_Quit);
+
+  if ( SDLNet_Init() < 0 ) {
+    cerr << "Couldn't init SDL_net: " << SDLNet_GetError() << endl;
+    exit(-1);
+  }
+  atexit(SDLNet_Quit);
+
+  char *payload = new char [b.size];
+  for ( unsigned long i = 0; i < b.size; ++i )
+    payload[i] = (i % 7) ? (i / 64) & 0xff : i & 0xff;
+
+  static const struct {
+    const char *name;
+    bool split;
+    unsigned char codec;
+  } modes[] = {
+    { "split",  true,  CODEC_STORE },
+    { "framed", false, CODEC_STORE },
+    { "lz",     false, CODEC_LZ }
+  };
+
+  cout << b.runs << " round trips, " << b.size << " bytes payload" << endl
+       << endl << "mode    round trip (us)" << endl;
+
+  for ( int m = 0; m < 3; ++m ) {
+    b.split = modes[m].split;
+    b.codec = modes[m].codec;
+
+    unsigned long rtt = run( b, payload );
+    ++b.port;   // don't wait for the old socket to go away
+
+    cout << setw(8) << left << modes[m].name << right;
+    if ( rtt ) cout << rtt << endl;
+    else cout << "failed" << endl;
+  }
+
+  delete [] payload;
+  return 0;
+}
+
+#endif /* DISABLE_NETWORK */
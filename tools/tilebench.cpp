@@ -0,0 +1,290 @@
+/* tilebench -- measure tile drawing performance of Crimson Fields
+   Copyright (C) 2000-2007 Jens Granseuer
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* paints a screen full of hexes from a tile set and prints the number
+   of tiles drawn per second (in thousands) for
+
+   old   - the way TileSet::DrawTile() worked before the source
+           rectangles were precomputed
+   tile  - TileSet::DrawTile() for each hex
+   batch - TileSet::DrawTiles() for all hexes at once
+   alt   - TileSet::DrawTile() for each hex, drawing every tile to two
+           surfaces in turn like the game does when it updates the
+           display and the terrain cache or a window
+
+   with the image sheet in the three formats
+
+   8bit    - the palettized sheet as stored in the file; this is what
+             is used if the sheet is loaded before the display is set up
+   display - converted to the display format (the default)
+   rle     - converted to the display format with RLE encoded
+             transparency; SDL encodes the sheet again whenever the
+             destination surface changes, which the "alt" column shows
+
+   The results are compared with the "old" drawing of the 8 bit sheet.
+
+   Afterwards the time needed to fill the screen with hexes is printed
+   for each zoom level of the display sheet.
+
+   Unless SDL_VIDEODRIVER is set the dummy video driver is used, so no
+   window is opened.
+*/
+
+#ifdef WIN32
+# include <windows.h>
+#else
+# include <sys/time.h>
+#endif
+
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+
+#include "SDL.h"
+
+#include "lset.h"
+#include "misc.h"
+#include "fileio.h"
+
+#ifdef _MSC_VER
+// SDL_Main linkage destroys the command line in VS8
+#undef main
+#endif
+
+#define DEFAULT_RUNS  50
+#define BENCH_WIDTH   800
+#define BENCH_HEIGHT  600
+#define BENCH_BPP     16
+
+// gives access to the image sheet
+class BenchSet : public TerrainSet {
+public:
+  unsigned short Images( void ) const { return tile_rects.size(); }
+
+  void EnableRLE( void ) { tiles.EnableRLE(); }
+
+  // copy of the drawing code used before the source rectangles were
+  // precomputed
+  void DrawTileOld( unsigned short n, Surface *dest,
+                    short px, short py, const Rect &clip ) const {
+    Rect dstrect( px, py, TileWidth(), TileHeight() );
+    if ( dstrect.x + dstrect.w < clip.x ) return;
+    if ( dstrect.y + dstrect.h < clip.y ) return;
+    if ( dstrect.x >= clip.x + clip.w ) return;
+    if ( dstrect.y >= clip.y + clip.h ) return;
+
+    Rect srcrect;
+    unsigned short gfx_per_line = tiles.Width() / TileWidth();
+    srcrect.x = (n % gfx_per_line) * TileWidth();
+    srcrect.y = (n / gfx_per_line) * TileHeight();
+    srcrect.w = dstrect.w;
+    srcrect.h = dstrect.h;
+
+    dstrect.ClipBlit( srcrect, clip );
+    tiles.LowerBlit( dest, srcrect, dstrect.x, dstrect.y );
+  }
+};
+
+enum { BENCH_OLD, BENCH_TILE, BENCH_BATCH, BENCH_ALT };
+
+static unsigned long ticks( void ) {
+#ifdef WIN32
+  LARGE_INTEGER freq, now;
+  if ( QueryPerformanceFrequency( &freq ) && QueryPerformanceCounter( &now ) )
+    return (unsigned long)(now.QuadPart * 1000000 / freq.QuadPart);
+  return GetTickCount() * 1000;
+#else
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/* lay out hexes like the map view does, with partially visible
+   hexes at all edges */
+static void make_map( const TileSet &set, unsigned short images,
+                      vector<TileBlit> &blits ) {
+  short dx = set.TileWidth() - set.TileShiftX();
+  unsigned short n = 0;
+
+  for ( int x = -set.TileWidth() / 2; x < BENCH_WIDTH; x += dx ) {
+    short yoff = (((x + set.TileWidth() / 2) / dx) & 1) ? set.TileShiftY() : 0;
+    for ( int y = yoff - set.TileHeight() / 2; y < BENCH_HEIGHT;
+          y += set.TileHeight() ) {
+      TileBlit b;
+      b.n = n;
+      b.x = x;
+      b.y = y;
+      blits.push_back( b );
+      n = (n + 1) % images;
+    }
+  }
+}
+
+/* in BENCH_ALT mode every tile is drawn to s and alt */
+static void draw( const BenchSet &set, Surface &s, Surface &alt, int mode,
+                  const vector<TileBlit> &blits ) {
+  if ( mode == BENCH_BATCH ) set.DrawTiles( blits, &s, s );
+  else {
+    for ( vector<TileBlit>::const_iterator it = blits.begin();
+          it != blits.end(); ++it ) {
+      if ( mode == BENCH_OLD ) set.DrawTileOld( it->n, &s, it->x, it->y, s );
+      else {
+        set.DrawTile( it->n, &s, it->x, it->y, s );
+        if ( mode == BENCH_ALT ) set.DrawTile( it->n, &alt, it->x, it->y, alt );
+      }
+    }
+  }
+}
+
+/* returns thousands of tiles per second */
+static unsigned long run( const BenchSet &set, Surface &s, Surface &alt,
+                          int mode, int runs, const vector<TileBlit> &blits ) {
+  draw( set, s, alt, mode, blits );   // let SDL set up the blit
+
+  unsigned long start = ticks();
+  for ( int i = 0; i < runs; ++i ) draw( set, s, alt, mode, blits );
+  unsigned long us = ticks() - start;
+  if ( us == 0 ) us = 1;
+
+  double tiles = (double)blits.size() * runs;
+  if ( mode == BENCH_ALT ) tiles *= 2;
+  return (unsigned long)(tiles * 1000 / us);
+}
+
+/* returns the average time in microseconds to fill the surface */
+static unsigned long run_screen( const TileSet &set, Surface &s, int runs,
+                                 const vector<TileBlit> &blits ) {
+  set.DrawTiles( blits, &s, s );
+
+  unsigned long start = ticks();
+  for ( int i = 0; i < runs; ++i ) set.DrawTiles( blits, &s, s );
+  return MAX( 1, (ticks() - start) / runs );
+}
+
+static bool same( const Surface &a, const Surface &b ) {
+  SDL_Surface *sa = a.s_surface, *sb = b.s_surface;
+  int len = sa->w * sa->format->BytesPerPixel;
+
+  for ( int y = 0; y < sa->h; ++y ) {
+    if ( memcmp( (Uint8 *)sa->pixels + y * sa->pitch,
+                 (Uint8 *)sb->pixels + y * sb->pitch, len ) ) return false;
+  }
+  return true;
+}
+
+static int load( BenchSet &set, const char *file ) {
+  MemoryBuffer buf( file );
+  if ( !buf.Open() || set.Load( buf, "bench" ) ) {
+    cerr << "Couldn't load tile set " << file << endl;
+    return -1;
+  }
+  return 0;
+}
+
+int main( int argc, char *argv[] ) {
+  const char *file = "default.tiles";
+  int runs = DEFAULT_RUNS;
+
+  for ( int i = 1; i < argc; ++i ) {
+    if ( !strcmp( argv[i], "-n" ) && (i + 1 < argc) ) {
+      runs = atoi( argv[++i] );
+      if ( runs < 1 ) runs = 1;
+    } else if ( argv[i][0] != '-' ) {
+      file = argv[i];
+    } else {
+      cerr << "Usage: " << argv[0] << " [-n <runs>] [tileset]" << endl;
+      exit(-1);
+    }
+  }
+
+  if ( !getenv( "SDL_VIDEODRIVER" ) )
+    SDL_putenv( (char *)"SDL_VIDEODRIVER=dummy" );
+
+  if ( SDL_Init( SDL_INIT_VIDEO ) < 0 ) {
+    cerr << "Couldn't init SDL: " << SDL_GetError() << endl;
+    exit(-1);
+  }
+  atexit(SDL_Quit);
+
+  // without a video mode the sheet cannot be converted
+  BenchSet sets[3];
+  if ( load( sets[0], file ) ) exit(-1);
+
+  if ( !SDL_SetVideoMode( BENCH_WIDTH, BENCH_HEIGHT, BENCH_BPP, SDL_SWSURFACE ) ) {
+    cerr << "Couldn't set video mode: " << SDL_GetError() << endl;
+    exit(-1);
+  }
+
+  if ( load( sets[1], file ) || load( sets[2], file ) ) exit(-1);
+  sets[2].EnableRLE();
+
+  static const char *names[] = { "8bit", "display", "rle" };
+
+  vector<TileBlit> blits;
+  make_map( sets[0], sets[0].Images(), blits );
+
+  Surface ref, test, alt;
+  if ( ref.Create( BENCH_WIDTH, BENCH_HEIGHT, BENCH_BPP, SDL_SWSURFACE ) ||
+       test.Create( BENCH_WIDTH, BENCH_HEIGHT, BENCH_BPP, SDL_SWSURFACE ) ||
+       alt.Create( BENCH_WIDTH, BENCH_HEIGHT, BENCH_BPP, SDL_SWSURFACE ) ) {
+    cerr << "Couldn't create surface: " << SDL_GetError() << endl;
+    exit(-1);
+  }
+  ref.Flood( Color(CF_COLOR_BLACK) );
+  draw( sets[0], ref, alt, BENCH_OLD, blits );
+
+  cout << runs << " runs, " << blits.size() << " tiles, "
+       << BENCH_WIDTH << "x" << BENCH_HEIGHT << "x" << BENCH_BPP << endl << endl
+       << "sheet    old     tile    batch   alt     (k tiles/s)" << endl;
+
+  for ( int s = 0; s < 3; ++s ) {
+    cout << setw(9) << left << names[s] << right;
+
+    for ( int m = BENCH_OLD; m <= BENCH_ALT; ++m ) {
+      test.Flood( Color(CF_COLOR_BLACK) );
+      alt.Flood( Color(CF_COLOR_BLACK) );
+      draw( sets[s], test, alt, m, blits );
+
+      if ( same( ref, test ) && ((m != BENCH_ALT) || same( ref, alt )) )
+        cout << setw(8) << left << run( sets[s], test, alt, m, runs, blits ) << right;
+      else cout << setw(8) << left << "differs" << right;
+    }
+    cout << endl;
+  }
+
+  cout << endl << "zoom     tiles   screen  (us)" << endl;
+
+  for ( int z = 0; z < TILE_ZOOM_LEVELS; ++z ) {
+    const TileSet *set = sets[1].Zoomed( z );
+    if ( set->Zoom() != z ) {
+      cout << setw(9) << left << z << "not available" << endl;
+      continue;
+    }
+
+    vector<TileBlit> zblits;
+    make_map( *set, sets[1].Images(), zblits );
+    cout << setw(9) << left << z << setw(8) << zblits.size()
+         << run_screen( *set, test, runs, zblits )
+         << right << endl;
+  }
+
+  return 0;
+}